@@ -0,0 +1,157 @@
+/*!
+  * \addtogroup batched_gemm
+  * @{
+  */
+
+#include "batched_gemm.hpp"
+#include "program_cache.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view kernelBatchedSrc { R"CLC(
+// -D BM= -D BN= -D BK=
+// Один work-item - одна матрица пакета, операнды и результат в приватной памяти
+kernel void batchedGemmSmall(const int batch,
+                    const global float* A, const long strideA,
+                    const global float* B, const long strideB,
+                    global float* C, const long strideC) {
+    const int id = get_global_id(0);
+    if (id >= batch) {
+        return;
+    }
+    const global float* a = A + id * strideA;
+    const global float* b = B + id * strideB;
+    global float* c = C + id * strideC;
+
+    float pa[BM * BK];
+    float pb[BK * BN];
+    for (int i = 0; i < BM * BK; ++i) {
+        pa[i] = a[i];
+    }
+    for (int i = 0; i < BK * BN; ++i) {
+        pb[i] = b[i];
+    }
+    for (int n = 0; n < BN; ++n) {
+        for (int m = 0; m < BM; ++m) {
+            float acc = 0.0f;
+            for (int k = 0; k < BK; ++k) {
+                acc = fma(pa[k * BM + m], pb[n * BK + k], acc);
+            }
+            c[n * BM + m] = acc;
+        }
+    }
+}
+
+// Один work-item - один элемент C: измерение 0 - элемент, измерение 1 - номер матрицы
+kernel void batchedGemm(const int batch,
+                    const global float* A, const long strideA,
+                    const global float* B, const long strideB,
+                    global float* C, const long strideC) {
+    const int element = get_global_id(0);
+    const int id = get_global_id(1);
+    if (element >= BM * BN || id >= batch) {
+        return;
+    }
+    const int m = element % BM;
+    const int n = element / BM;
+    const global float* a = A + id * strideA;
+    const global float* b = B + id * strideB;
+    float acc = 0.0f;
+    for (int k = 0; k < BK; ++k) {
+        acc = fma(a[k * BM + m], b[n * BK + k], acc);
+    }
+    C[id * strideC + n * BM + m] = acc;
+}
+)CLC"sv };
+
+constexpr int SMALL_GROUP = 64;
+constexpr int ELEMENT_GROUP = 64;
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+BatchedGemm::BatchedGemm(const cl::Context& context, const cl::Device& device, int M, int N, int K)
+    : M { M }, N { N }, K { K }, small { M * K + K * N <= MAX_PRIVATE_ELEMENTS } {
+    if (M <= 0 || N <= 0 || K <= 0) {
+        throw std::invalid_argument { "batched GEMM dimensions must be positive" };
+    }
+    std::ostringstream options;
+    options << "-D BM=" << M << " -D BN=" << N << " -D BK=" << K;
+    program = buildProgramCached(context, device, std::string { kernelBatchedSrc }, options.str());
+    kernel = cl::Kernel { program, small ? "batchedGemmSmall" : "batchedGemm" };
+}
+
+cl::Event BatchedGemm::enqueue(cl::CommandQueue& queue, int batch,
+                               const cl::Buffer& a, size_t strideA,
+                               const cl::Buffer& b, size_t strideB,
+                               const cl::Buffer& c, size_t strideC,
+                               const std::vector<cl::Event>* events) {
+    if (batch <= 0) {
+        throw std::invalid_argument { "batch size must be positive" };
+    }
+    if (strideA < static_cast<size_t>(M) * K || strideB < static_cast<size_t>(K) * N
+            || strideC < static_cast<size_t>(M) * N) {
+        throw std::invalid_argument { "batched GEMM strides must not be smaller than the matrices" };
+    }
+    kernel.setArg(0, batch);
+    kernel.setArg(1, a);
+    kernel.setArg(2, static_cast<cl_long>(strideA));
+    kernel.setArg(3, b);
+    kernel.setArg(4, static_cast<cl_long>(strideB));
+    kernel.setArg(5, c);
+    kernel.setArg(6, static_cast<cl_long>(strideC));
+
+    cl::Event event;
+    if (small) {
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                   cl::NDRange (roundUp(batch, SMALL_GROUP)), cl::NDRange (SMALL_GROUP),
+                                   events, &event);
+    } else {
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                   cl::NDRange (roundUp(static_cast<size_t>(M) * N, ELEMENT_GROUP), batch),
+                                   cl::NDRange (ELEMENT_GROUP, 1),
+                                   events, &event);
+    }
+    traceCommand(event, small ? "batchedGemmSmall" : "batchedGemm");
+    return event;
+}
+
+void cpuBatchedGemm(int M, int N, int K, int batch,
+                    const float* a, size_t strideA,
+                    const float* b, size_t strideB,
+                    float* c, size_t strideC) {
+    constexpr int CHUNK = 1024;
+    ThreadPool::shared().parallelFor(static_cast<size_t>((batch + CHUNK - 1) / CHUNK), [&](size_t chunk) {
+        const int end = std::min(batch, static_cast<int>(chunk + 1) * CHUNK);
+        for (int i = static_cast<int>(chunk) * CHUNK; i < end; ++i) {
+            const float* ai = a + i * strideA;
+            const float* bi = b + i * strideB;
+            float* ci = c + i * strideC;
+            for (int n = 0; n < N; ++n) {
+                for (int m = 0; m < M; ++m) {
+                    float acc = 0.0f;
+                    for (int k = 0; k < K; ++k) {
+                        acc += ai[k * M + m] * bi[n * K + k];
+                    }
+                    ci[n * M + m] = acc;
+                }
+            }
+        }
+    });
+}
+
+/*!
+ * @}
+ */
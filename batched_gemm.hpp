@@ -0,0 +1,76 @@
+/*!
+  * \defgroup batched_gemm Пакетное умножение маленьких матриц
+  *
+  * Умножение множества независимых матриц одинакового размера одним запуском kernel'я.
+  * Матрицы пакета хранятся по столбцам (column-major) без промежутков внутри матрицы,
+  * i-я матрица операнда X начинается со смещения i * strideX элементов.
+  * Размеры M, N, K фиксируются при компиляции программы через -D BM/BN/BK.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * \brief BatchedGemm Пакетное умножение C_i = A_i * B_i для матриц фиксированного размера
+ *
+ * Для маленьких матриц (A и B вместе не больше MAX_PRIVATE_ELEMENTS элементов) каждый work-item
+ * загружает свою пару матриц в приватную память и вычисляет всю матрицу C_i; циклы полностью
+ * разворачиваются компилятором, т.к. размеры известны при компиляции.
+ * Для больших матриц каждый work-item вычисляет один элемент C.
+ */
+class BatchedGemm {
+public:
+    static constexpr int MAX_PRIVATE_ELEMENTS = 128;
+
+    /*!
+     * \throws std::invalid_argument Если размеры не положительны
+     * \throws cl::Error Если программа не компилируется
+     */
+    BatchedGemm(const cl::Context& context, const cl::Device& device, int M, int N, int K);
+
+    /*!
+     * \brief enqueue Добавляет в очередь умножение batch пар матриц
+     *
+     * \param [in] strideA Расстояние между началами соседних матриц A в элементах (не меньше M * K)
+     * \param [in] strideB Расстояние между матрицами B (не меньше K * N)
+     * \param [in] strideC Расстояние между матрицами C (не меньше M * N)
+     * \throws std::invalid_argument Если batch не положителен или шаги меньше размеров матриц
+     * \return Событие завершения kernel'я
+     */
+    cl::Event enqueue(cl::CommandQueue& queue, int batch,
+                      const cl::Buffer& a, size_t strideA,
+                      const cl::Buffer& b, size_t strideB,
+                      const cl::Buffer& c, size_t strideC,
+                      const std::vector<cl::Event>* events = nullptr);
+
+    /*!
+     * \brief usesPrivateMemory true, если используется kernel с матрицами в приватной памяти
+     */
+    bool usesPrivateMemory() const { return small; }
+
+private:
+    int M;
+    int N;
+    int K;
+    bool small;
+    cl::Program program;
+    cl::Kernel kernel;
+};
+
+/*!
+ * \brief cpuBatchedGemm Эталонное пакетное умножение на CPU для той же раскладки данных
+ */
+void cpuBatchedGemm(int M, int N, int K, int batch,
+                    const float* a, size_t strideA,
+                    const float* b, size_t strideB,
+                    float* c, size_t strideC);
+
+/*!
+ * @}
+ */
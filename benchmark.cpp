@@ -0,0 +1,256 @@
+/*!
+  * \addtogroup benchmark
+  * @{
+  */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char* const CSV_HEADER = "suite,name,config,size,device,driver,platform,revision,warmup,repetitions,"
+                               "min_ms,median_ms,p95_ms,p99_ms,rate,unit";
+
+std::string csvField(const std::string& value) {
+    std::string result = "\"";
+    for (char c : value) {
+        result += c;
+        if (c == '"') {
+            result += '"';
+        }
+    }
+    return result + "\"";
+}
+
+std::vector<std::string> parseCsvLine(const std::string& line) {
+    std::vector<std::string> fields (1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back() += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                fields.back() += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+std::string jsonString(const std::string& value) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+/*!
+ * \brief CsvRow Строка CSV результатов, нужная для сравнения
+ */
+struct CsvRow {
+    std::string device;
+    double median;
+    double rate;
+    std::string unit;
+};
+
+std::map<std::string, CsvRow> readBenchmarkCsv(const std::string& path, std::vector<std::string>& order) {
+    std::ifstream in { path };
+    if (!in) {
+        throw std::runtime_error { "cannot read benchmark results " + path };
+    }
+    std::string line;
+    if (!std::getline(in, line) || parseCsvLine(line) != parseCsvLine(CSV_HEADER)) {
+        throw std::runtime_error { path + " is not a benchmark CSV file" };
+    }
+    std::map<std::string, CsvRow> rows;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const std::vector<std::string> fields = parseCsvLine(line);
+        if (fields.size() != 16) {
+            throw std::runtime_error { path + ": malformed line: " + line };
+        }
+        const std::string key = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+        if (rows.count(key) == 0) {
+            order.push_back(key);
+        }
+        rows[key] = CsvRow { fields[4], std::stod(fields[11]), std::stod(fields[14]), fields[15] };
+    }
+    return rows;
+}
+
+} // namespace
+
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const double rank = std::clamp(p, 0.0, 100.0) / 100.0 * (samples.size() - 1);
+    const size_t low = static_cast<size_t>(std::floor(rank));
+    const size_t high = std::min(low + 1, samples.size() - 1);
+    return samples[low] + (samples[high] - samples[low]) * (rank - low);
+}
+
+double BenchmarkResult::min() const {
+    return seconds.empty() ? 0.0 : *std::min_element(seconds.begin(), seconds.end());
+}
+
+double BenchmarkResult::median() const {
+    return ::percentile(seconds, 50.0);
+}
+
+double BenchmarkResult::percentile(double p) const {
+    return ::percentile(seconds, p);
+}
+
+double BenchmarkResult::rate() const {
+    const double time = median();
+    return time > 0.0 ? work / time / 1e9 : 0.0;
+}
+
+BenchmarkResult measure(std::string suite, std::string name, std::string config, std::string size,
+                        double work, std::string unit, const std::function<void()>& run,
+                        const BenchmarkOptions& options) {
+    BenchmarkResult result;
+    result.suite = std::move(suite);
+    result.name = std::move(name);
+    result.config = std::move(config);
+    result.size = std::move(size);
+    result.work = work;
+    result.unit = std::move(unit);
+
+    for (int i = 0; i < options.warmup; ++i) {
+        run();
+    }
+    result.seconds.reserve(std::max(0, options.repetitions));
+    for (int i = 0; i < options.repetitions; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds.push_back(elapsed.count());
+    }
+    return result;
+}
+
+void printBenchmarks(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << std::left << std::setw(11) << "suite" << std::setw(18) << "name" << std::setw(26) << "config"
+        << std::setw(16) << "size" << std::right << std::setw(12) << "median ms" << std::setw(12) << "p95 ms"
+        << std::setw(12) << "p99 ms" << std::setw(12) << "rate" << std::endl;
+    for (const BenchmarkResult& result : results) {
+        out << std::left << std::setw(11) << result.suite << std::setw(18) << result.name
+            << std::setw(26) << result.config << std::setw(16) << result.size << std::right << std::fixed
+            << std::setprecision(3) << std::setw(12) << result.median() * 1e3
+            << std::setw(12) << result.percentile(95.0) * 1e3 << std::setw(12) << result.percentile(99.0) * 1e3
+            << std::setw(12) << result.rate() << " " << result.unit << std::defaultfloat << std::endl;
+    }
+}
+
+void writeBenchmarkCsv(std::ostream& out, const BenchmarkEnvironment& environment,
+                       const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results) {
+    out << CSV_HEADER << "\n";
+    out << std::setprecision(9);
+    for (const BenchmarkResult& result : results) {
+        out << csvField(result.suite) << "," << csvField(result.name) << "," << csvField(result.config) << ","
+            << csvField(result.size) << "," << csvField(environment.device) << ","
+            << csvField(environment.driver) << "," << csvField(environment.platform) << ","
+            << csvField(environment.revision) << "," << options.warmup << "," << result.seconds.size() << ","
+            << result.min() * 1e3 << "," << result.median() * 1e3 << ","
+            << result.percentile(95.0) * 1e3 << "," << result.percentile(99.0) * 1e3 << ","
+            << result.rate() << "," << csvField(result.unit) << "\n";
+    }
+}
+
+void writeBenchmarkJson(std::ostream& out, const BenchmarkEnvironment& environment,
+                        const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results) {
+    out << std::setprecision(9);
+    out << "{\n  \"environment\": {\"device\": " << jsonString(environment.device)
+        << ", \"driver\": " << jsonString(environment.driver)
+        << ", \"platform\": " << jsonString(environment.platform)
+        << ", \"revision\": " << jsonString(environment.revision) << "},\n"
+        << "  \"warmup\": " << options.warmup << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"suite\": " << jsonString(result.suite) << ", \"name\": " << jsonString(result.name)
+            << ", \"config\": " << jsonString(result.config) << ", \"size\": " << jsonString(result.size)
+            << ", \"min_ms\": " << result.min() * 1e3 << ", \"median_ms\": " << result.median() * 1e3
+            << ", \"p95_ms\": " << result.percentile(95.0) * 1e3
+            << ", \"p99_ms\": " << result.percentile(99.0) * 1e3
+            << ", \"rate\": " << result.rate() << ", \"unit\": " << jsonString(result.unit) << ", \"samples_ms\": [";
+        for (size_t s = 0; s < result.seconds.size(); ++s) {
+            out << (s == 0 ? "" : ", ") << result.seconds[s] * 1e3;
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int compareBenchmarks(std::ostream& out, const std::string& baselinePath, const std::string& currentPath,
+                      double threshold) {
+    std::vector<std::string> baselineOrder, currentOrder;
+    const std::map<std::string, CsvRow> baseline = readBenchmarkCsv(baselinePath, baselineOrder);
+    const std::map<std::string, CsvRow> current = readBenchmarkCsv(currentPath, currentOrder);
+
+    int regressions = 0;
+    out << std::fixed << std::setprecision(3);
+    for (const std::string& key : currentOrder) {
+        const CsvRow& now = current.at(key);
+        const auto found = baseline.find(key);
+        if (found == baseline.end()) {
+            out << key << ": new" << std::endl;
+            continue;
+        }
+        const CsvRow& before = found->second;
+        const double change = before.median > 0.0 ? now.median / before.median - 1.0 : 0.0;
+        const bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+        out << key << ": " << before.median << " -> " << now.median << " ms (" << std::showpos << change * 100.0
+            << std::noshowpos << "%), " << now.rate << " " << now.unit << (regressed ? "  REGRESSION" : "");
+        if (before.device != now.device) {
+            out << "  (device changed: " << before.device << " -> " << now.device << ")";
+        }
+        out << std::endl;
+    }
+    for (const std::string& key : baselineOrder) {
+        if (current.count(key) == 0) {
+            out << key << ": missing" << std::endl;
+        }
+    }
+    out << std::defaultfloat;
+    return regressions;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,106 @@
+/*!
+  * \defgroup benchmark Измерение производительности
+  *
+  * Общий порядок измерения для всех kernel'ей: прогревочные запуски, затем заданное количество повторений,
+  * каждое из которых замеряется отдельно (от постановки команд в очередь до их завершения). По замерам
+  * считаются минимум, медиана, 95-й и 99-й перцентили и достигнутая скорость (GFLOPS или GB/s по медиане).
+  *
+  * Результаты сохраняются в CSV и JSON вместе с описанием устройства и ревизией исходников, чтобы запуски
+  * разных коммитов можно было сравнить (compareBenchmarks).
+  * @{
+  */
+
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief BenchmarkOptions Параметры измерения
+ */
+struct BenchmarkOptions {
+    int warmup = 2;                 //< запусков до измерения (компиляция, выделение памяти, прогрев частот)
+    int repetitions = 10;           //< измеряемых запусков
+};
+
+/*!
+ * \brief BenchmarkEnvironment Описание условий запуска, записываемое вместе с результатами
+ */
+struct BenchmarkEnvironment {
+    std::string device;             //< имя устройства
+    std::string driver;             //< версия драйвера
+    std::string platform;           //< имя платформы
+    std::string revision;           //< ревизия исходников
+};
+
+/*!
+ * \brief BenchmarkResult Замеры одного случая
+ */
+struct BenchmarkResult {
+    std::string suite;              //< набор ("vector", "gemm", ...)
+    std::string name;               //< случай внутри набора
+    std::string config;             //< параметры kernel'я
+    std::string size;               //< размер задачи ("1048576", "512x512x512")
+    double work = 0.0;              //< работа одного запуска: операций с плавающей точкой или байт
+    std::string unit;               //< единица скорости: "GFLOPS" или "GB/s"
+    std::vector<double> seconds;    //< время каждого повторения
+
+    double min() const;
+    double median() const;
+    double percentile(double p) const;
+
+    /*!
+     * \brief rate Скорость по медиане в единицах unit
+     */
+    double rate() const;
+};
+
+/*!
+ * \brief percentile Перцентиль p (0..100) с линейной интерполяцией между соседними замерами
+ * \return 0 для пустого набора замеров
+ */
+double percentile(std::vector<double> samples, double p);
+
+/*!
+ * \brief measure Выполняет прогрев и повторения run и возвращает замеры
+ *
+ * \param [in] run Один запуск; должен дождаться завершения своих команд
+ * \param [in] work Работа одного запуска в единицах unit (операции для "GFLOPS", байты для "GB/s")
+ */
+BenchmarkResult measure(std::string suite, std::string name, std::string config, std::string size,
+                        double work, std::string unit, const std::function<void()>& run,
+                        const BenchmarkOptions& options);
+
+/*!
+ * \brief printBenchmarks Выводит таблицу результатов для чтения человеком
+ */
+void printBenchmarks(std::ostream& out, const std::vector<BenchmarkResult>& results);
+
+/*!
+ * \brief writeBenchmarkCsv Записывает результаты в CSV (одна строка на случай, времена в миллисекундах)
+ */
+void writeBenchmarkCsv(std::ostream& out, const BenchmarkEnvironment& environment,
+                       const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results);
+
+/*!
+ * \brief writeBenchmarkJson Записывает результаты в JSON, включая все замеры
+ */
+void writeBenchmarkJson(std::ostream& out, const BenchmarkEnvironment& environment,
+                        const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results);
+
+/*!
+ * \brief compareBenchmarks Сравнивает медианы двух CSV файлов, записанных writeBenchmarkCsv
+ *
+ * Случаи сопоставляются по набору, имени, конфигурации и размеру.
+ * \param [in] threshold Допустимое относительное замедление медианы (0.05 - 5%)
+ * \return Количество случаев, замедлившихся больше чем на threshold
+ * \throws std::runtime_error Если файл не читается или имеет неверный формат
+ */
+int compareBenchmarks(std::ostream& out, const std::string& baselinePath, const std::string& currentPath,
+                      double threshold);
+
+/*!
+ * @}
+ */
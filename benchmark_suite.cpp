@@ -0,0 +1,416 @@
+/*!
+  * \defgroup benchmark_suite Набор измерений производительности
+  *
+  * Измеряет kernel'и репозитория на одном устройстве по сетке размеров (и конфигураций для GEMM)
+  * и сохраняет результаты в CSV/JSON для сравнения между коммитами:
+  *
+  *     benchmark <platformId> <deviceId> [suite[:size,size,...]]... [warmup=N] [reps=N] [csv=file] [json=file]
+  *     benchmark compare <baseline.csv> <current.csv> [thresholdPercent]
+  *
+  * Наборы: vector (сложение векторов), reduce (сумма вектора), gemm (умножение квадратных матриц),
+  * sparse (разреженная матрица на вектор и на матрицу в сравнении с плотным умножением),
+  * quantized (умножение матриц с входами half и int8).
+  * Новый набор добавляется функцией вида runVector и записью в SUITES.
+  * @{
+  */
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "device_vector.hpp"
+#include "gemm.hpp"
+#include "gemm_tuner.hpp"
+#include "launch_geometry.h"
+#include "program_cache.hpp"
+#include "quantized_gemm.hpp"
+#include "reduction.hpp"
+#include "sparse.hpp"
+#include "trace.hpp"
+
+// Генерируется при сборке (revision.cmake)
+#include "benchmark_revision.h"
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view addSrc { R"CLC(
+kernel void add(const global int* a, const global int* b, global int* c) {
+    const int id = get_global_id(0);
+    c[id] = a[id] + b[id];
+}
+
+kernel void addStride(const global int* a, const global int* b, global int* c, const ulong n) {
+    for (size_t id = get_global_id(0); id < n; id += get_global_size(0)) {
+        c[id] = a[id] + b[id];
+    }
+}
+)CLC"sv };
+
+/*!
+ * \brief BenchmarkRun Общее состояние запуска наборов на одном устройстве
+ */
+struct BenchmarkRun {
+    cl::Context context;
+    cl::Device device;
+    cl::CommandQueue queue;
+    BenchmarkOptions options;
+    std::vector<BenchmarkResult> results;
+};
+
+using Suite = void (*)(BenchmarkRun& run, const std::vector<size_t>& sizes);
+
+/*!
+ * \brief measureFused Измеряет c = a + b для DeviceVector<float, Width>
+ */
+template <int Width>
+void measureFused(BenchmarkRun& run, size_t count) {
+    DeviceVector<cl_float, Width> a { run.context, run.queue, std::vector<cl_float>(count, 1.0f) };
+    DeviceVector<cl_float, Width> b { run.context, run.queue, std::vector<cl_float>(count, 2.0f) };
+    DeviceVector<cl_float, Width> c { run.context, run.queue, count };
+    run.results.push_back(measure("vector", "fused", "float x" + std::to_string(Width), std::to_string(count),
+                                  3.0 * count * sizeof(cl_float), "GB/s", [&] {
+        c = a + b;
+        run.queue.finish();
+    }, run.options));
+}
+
+/*!
+ * \brief runVector Сложение векторов: исходный kernel (int, элемент на work-item), grid-stride kernel
+ * с размерами запуска chooseLaunchGeometry и DeviceVector разной ширины
+ */
+void runVector(BenchmarkRun& run, const std::vector<size_t>& sizes) {
+    cl::Program program = buildProgramCached(run.context, run.device, std::string { addSrc });
+    cl::Kernel add { program, "add" };
+    cl::Kernel addStride { program, "addStride" };
+    for (size_t count : sizes) {
+        cl::Buffer a { run.context, CL_MEM_READ_ONLY, count * sizeof(cl_int) };
+        cl::Buffer b { run.context, CL_MEM_READ_ONLY, count * sizeof(cl_int) };
+        cl::Buffer c { run.context, CL_MEM_WRITE_ONLY, count * sizeof(cl_int) };
+        run.queue.enqueueFillBuffer(a, cl_int { 1 }, 0, count * sizeof(cl_int));
+        run.queue.enqueueFillBuffer(b, cl_int { 2 }, 0, count * sizeof(cl_int));
+        add.setArg(0, a);
+        add.setArg(1, b);
+        add.setArg(2, c);
+        run.results.push_back(measure("vector", "add", "int x1", std::to_string(count),
+                                      3.0 * count * sizeof(cl_int), "GB/s", [&] {
+            run.queue.enqueueNDRangeKernel(add, cl::NullRange, cl::NDRange { count });
+            run.queue.finish();
+        }, run.options));
+
+        addStride.setArg(0, a);
+        addStride.setArg(1, b);
+        addStride.setArg(2, c);
+        addStride.setArg(3, static_cast<cl_ulong>(count));
+        LaunchGeometry geometry;
+        const cl_int err = chooseLaunchGeometry(run.device(), addStride(), count, &geometry);
+        if (err != CL_SUCCESS) {
+            throw cl::Error { err, "chooseLaunchGeometry" };
+        }
+        run.results.push_back(measure("vector", "add grid-stride",
+                                      "int x1 " + std::to_string(geometry.global) + "/" + std::to_string(geometry.local),
+                                      std::to_string(count), 3.0 * count * sizeof(cl_int), "GB/s", [&] {
+            run.queue.enqueueNDRangeKernel(addStride, cl::NullRange, cl::NDRange { geometry.global },
+                                           cl::NDRange { geometry.local });
+            run.queue.finish();
+        }, run.options));
+
+        measureFused<1>(run, count);
+        measureFused<4>(run, count);
+        measureFused<16>(run, count);
+    }
+}
+
+/*!
+ * \brief runReduce Сумма вектора float (двухпроходная редукция с чтением результата)
+ */
+void runReduce(BenchmarkRun& run, const std::vector<size_t>& sizes) {
+    Reduction<cl_float> reduction { run.context, run.device };
+    for (size_t count : sizes) {
+        cl::Buffer a { run.context, CL_MEM_READ_ONLY, count * sizeof(cl_float) };
+        run.queue.enqueueFillBuffer(a, cl_float { 1.0f }, 0, count * sizeof(cl_float));
+        run.results.push_back(measure("reduce", "sum", "float", std::to_string(count),
+                                      1.0 * count * sizeof(cl_float), "GB/s", [&] {
+            reduction.reduce(run.queue, ReduceOp::Sum, a, count);
+        }, run.options));
+    }
+}
+
+std::string describe(const GemmConfig& config) {
+    std::ostringstream out;
+    out << config.tileM << "x" << config.tileN << "x" << config.tileK << " wpt" << config.wptM << "x"
+        << config.wptN << " w" << config.width;
+    return out.str();
+}
+
+/*!
+ * \brief runGemm Умножение квадратных матриц для нескольких конфигураций и конфигурации из базы настройки
+ *
+ * Конфигурации, которые не подходят устройству, пропускаются с сообщением.
+ */
+void runGemm(BenchmarkRun& run, const std::vector<size_t>& sizes) {
+    std::vector<std::pair<std::string, GemmConfig>> configs { { "default", GemmConfig {} } };
+    for (const auto& [tileM, tileN, tileK, wpt] : { std::tuple { 32, 32, 16, 4 }, std::tuple { 64, 64, 32, 4 },
+                                                    std::tuple { 128, 128, 16, 8 } }) {
+        GemmConfig config;
+        config.tileM = tileM;
+        config.tileN = tileN;
+        config.tileK = tileK;
+        config.wptM = config.wptN = wpt;
+        configs.emplace_back("tiled", config);
+    }
+    GemmTuner tuner { GemmTuner::defaultPath() };
+
+    for (size_t size : sizes) {
+        const int n = static_cast<int>(size);
+        const size_t bytes = size * size * sizeof(float);
+        cl::Buffer a { run.context, CL_MEM_READ_ONLY, bytes };
+        cl::Buffer b { run.context, CL_MEM_READ_ONLY, bytes };
+        cl::Buffer c { run.context, CL_MEM_WRITE_ONLY, bytes };
+        run.queue.enqueueFillBuffer(a, 0.5f, 0, bytes);
+        run.queue.enqueueFillBuffer(b, 0.25f, 0, bytes);
+
+        std::vector<std::pair<std::string, GemmConfig>> sizeConfigs = configs;
+        GemmConfig tuned;
+        if (tuner.find(run.device, n, n, n, tuned)) {
+            sizeConfigs.emplace_back("tuned", tuned);
+        }
+        for (const auto& [name, config] : sizeConfigs) {
+            std::unique_ptr<Gemm> gemm;
+            try {
+                gemm = std::make_unique<Gemm>(run.context, run.device, config);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "gemm " << describe(config) << " skipped: " << e.what() << std::endl;
+                continue;
+            }
+            run.results.push_back(measure("gemm", name, describe(config),
+                                          std::to_string(n) + "x" + std::to_string(n) + "x" + std::to_string(n),
+                                          2.0 * size * size * size, "GFLOPS", [&] {
+                gemm->enqueue(run.queue, n, n, n, a, b, c);
+                run.queue.finish();
+            }, run.options));
+        }
+    }
+}
+
+/*!
+ * \brief runSparse Умножение разреженной матрицы на вектор (n = 1) и на матрицу (n = 16) всеми kernel'ями
+ * и плотным Gemm при нескольких долях ненулевых элементов
+ *
+ * Производительность всех вариантов, включая плотный, считается по полезным операциям 2 * nnz * n,
+ * поэтому отношение скоростей равно отношению времен.
+ */
+void runSparse(BenchmarkRun& run, const std::vector<size_t>& sizes) {
+    std::mt19937 random { 42 };
+    std::uniform_real_distribution<float> value { -1.0f, 1.0f };
+    for (size_t size : sizes) {
+        const int side = static_cast<int>(size);
+        const size_t denseBytes = size * size * sizeof(float);
+        cl::Buffer denseA { run.context, CL_MEM_READ_ONLY, denseBytes };
+        run.queue.enqueueFillBuffer(denseA, 0.5f, 0, denseBytes);
+        Gemm gemm { run.context, run.device };
+
+        for (double density : { 0.001, 0.01, 0.05, 0.2 }) {
+            std::bernoulli_distribution nonZero { density };
+            std::vector<float> dense ( size * size );
+            for (float& x : dense) {
+                x = nonZero(random) ? value(random) : 0.0f;
+            }
+            const CsrMatrix csr = csrFromDense(dense, side, side);
+            std::ostringstream densityName;
+            densityName << "d=" << density * 100.0 << "%";
+
+            for (int n : { 1, 16 }) {
+                const size_t bytes = size * n * sizeof(float);
+                cl::Buffer b { run.context, CL_MEM_READ_ONLY, bytes };
+                cl::Buffer c { run.context, CL_MEM_WRITE_ONLY, bytes };
+                run.queue.enqueueFillBuffer(b, 0.25f, 0, bytes);
+                const std::string sizeName = std::to_string(side) + "x" + std::to_string(side) + " n="
+                                             + std::to_string(n);
+                const double work = 2.0 * csr.nnz() * n;
+
+                for (SparseKernel kernel : { SparseKernel::Auto, SparseKernel::CsrScalar, SparseKernel::CsrVector,
+                                             SparseKernel::Sell, SparseKernel::Ell }) {
+                    SparseMatrix matrix { run.context, run.device, run.queue, csr, kernel };
+                    const std::string config = densityName.str()
+                            + (kernel == SparseKernel::Auto ? std::string { " -> " } + sparseKernelName(matrix.kernel())
+                                                            : std::string {});
+                    run.results.push_back(measure(n == 1 ? "spmv" : "spmm", sparseKernelName(kernel), config,
+                                                  sizeName, work, "GFLOPS", [&] {
+                        matrix.enqueueSpmm(run.queue, n, b, c);
+                        run.queue.finish();
+                    }, run.options));
+                }
+                run.results.push_back(measure(n == 1 ? "spmv" : "spmm", "dense", densityName.str(), sizeName,
+                                              work, "GFLOPS", [&] {
+                    gemm.enqueue(run.queue, side, n, side, denseA, b, c);
+                    run.queue.finish();
+                }, run.options));
+            }
+        }
+    }
+}
+
+/*!
+ * \brief runQuantized Умножение квадратных матриц с входами float, half и int8 (накопление в int32/float)
+ */
+void runQuantized(BenchmarkRun& run, const std::vector<size_t>& sizes) {
+    for (size_t size : sizes) {
+        const int n = static_cast<int>(size);
+        std::vector<float> host ( size * size );
+        for (size_t i = 0; i < host.size(); ++i) {
+            host[i] = static_cast<float>(i % 7) * 0.25f - 0.75f;
+        }
+        cl::Buffer c { run.context, CL_MEM_WRITE_ONLY, size * size * sizeof(float) };
+        for (QuantizedType type : { QuantizedType::Float, QuantizedType::Half, QuantizedType::Int8 }) {
+            const QuantizedMatrix a = quantizeRows(host.data(), n, n, type);
+            QuantizedGemm gemm { run.context, run.device, type };
+            // A и Bt одинаковы: на скорость значения не влияют
+            cl::Buffer matrix { run.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, a.bytes(),
+                                const_cast<void*>(a.data()) };
+            std::unique_ptr<cl::Buffer> scales;
+            if (type == QuantizedType::Int8) {
+                scales = std::make_unique<cl::Buffer>(run.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                      sizeof(float) * a.scales.size(),
+                                                      const_cast<float*>(a.scales.data()));
+            }
+            const std::string config = std::string { quantizedTypeName(type) }
+                    + (gemm.usesDotProduct() ? " dot" : "") + (gemm.usesFp16() ? " fp16" : "");
+            run.results.push_back(measure("quantized", quantizedTypeName(type), config,
+                                          std::to_string(n) + "x" + std::to_string(n) + "x" + std::to_string(n),
+                                          2.0 * size * size * size, "GFLOPS", [&] {
+                gemm.enqueue(run.queue, n, n, n, matrix, scales.get(), matrix, scales.get(), c);
+                run.queue.finish();
+            }, run.options));
+        }
+    }
+}
+
+/*!
+ * \brief SUITES Наборы и размеры по умолчанию (элементов для векторов, сторона матрицы для остальных)
+ */
+const struct {
+    const char* name;
+    Suite run;
+    std::vector<size_t> sizes;
+} SUITES[] {
+    { "vector", runVector, { 1 << 16, 1 << 18, 1 << 20, 1 << 22, 1 << 24 } },
+    { "reduce", runReduce, { 1 << 20, 1 << 22, 1 << 24 } },
+    { "gemm", runGemm, { 128, 256, 512, 1024 } },
+    { "sparse", runSparse, { 1024, 4096 } },
+    { "quantized", runQuantized, { 256, 512, 1024 } },
+};
+
+std::vector<size_t> parseSizes(const std::string& list) {
+    std::vector<size_t> sizes;
+    std::istringstream in { list };
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) {
+            sizes.push_back(std::stoull(item));
+        }
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Трасса записывается при выходе из main, пока среда openCL еще загружена
+    TraceFlush trace;
+    if (argc > 3 && argv[1] == "compare"sv) {
+        const double threshold = argc > 4 ? std::atof(argv[4]) / 100.0 : 0.05;
+        return compareBenchmarks(std::cout, argv[2], argv[3], threshold) > 0 ? 1 : 0;
+    }
+    if (argc < 3) {
+        std::cout << "usage: <platformId> <deviceId> [vector|reduce|gemm|sparse|quantized[:size,size,...]]... [warmup=N] [reps=N] "
+                     "[csv=file] [json=file] | compare <baseline.csv> <current.csv> [thresholdPercent]"
+                  << std::endl;
+        return 0;
+    }
+
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    const cl::Platform platform = platforms.at(atoi(argv[1]));
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    const cl::Device device = devices.at(atoi(argv[2]));
+
+    cl::Context context { device };
+    BenchmarkRun run { context, device, cl::CommandQueue { context, device, traceQueueProperties() } };
+
+    std::vector<std::pair<Suite, std::vector<size_t>>> selected;
+    std::string csvPath, jsonPath;
+    for (int i = 3; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t separator = arg.find_first_of("=:");
+        const std::string key = arg.substr(0, separator);
+        const std::string value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+        if (key == "warmup") {
+            run.options.warmup = std::stoi(value);
+        } else if (key == "reps") {
+            run.options.repetitions = std::stoi(value);
+        } else if (key == "csv") {
+            csvPath = value;
+        } else if (key == "json") {
+            jsonPath = value;
+        } else {
+            bool known = false;
+            for (const auto& suite : SUITES) {
+                if (key == suite.name) {
+                    selected.emplace_back(suite.run, value.empty() ? suite.sizes : parseSizes(value));
+                    known = true;
+                }
+            }
+            if (!known) {
+                std::cerr << "unknown argument " << arg << std::endl;
+                return 1;
+            }
+        }
+    }
+    if (selected.empty()) {
+        for (const auto& suite : SUITES) {
+            selected.emplace_back(suite.run, suite.sizes);
+        }
+    }
+
+    const BenchmarkEnvironment environment {
+        device.getInfo<CL_DEVICE_NAME>(), device.getInfo<CL_DRIVER_VERSION>(),
+        platform.getInfo<CL_PLATFORM_NAME>(), BENCHMARK_REVISION
+    };
+    std::cout << environment.device << " (" << environment.platform << ", driver " << environment.driver
+              << "), revision " << environment.revision << ", " << run.options.warmup << " warmup, "
+              << run.options.repetitions << " repetitions" << std::endl;
+
+    for (const auto& [suite, sizes] : selected) {
+        suite(run, sizes);
+    }
+    printBenchmarks(std::cout, run.results);
+
+    if (!csvPath.empty()) {
+        std::ofstream out { csvPath };
+        writeBenchmarkCsv(out, environment, run.options, run.results);
+    }
+    if (!jsonPath.empty()) {
+        std::ofstream out { jsonPath };
+        writeBenchmarkJson(out, environment, run.options, run.results);
+    }
+    return 0;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,168 @@
+/*!
+  * \addtogroup buffer_pool
+  * @{
+  */
+
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+constexpr size_t MIN_CLASS = 256;
+
+bool completed(const std::vector<cl::Event>& events) {
+    // Отрицательный статус - команда завершилась с ошибкой, буфер ей больше не нужен
+    return std::all_of(events.begin(), events.end(), [](const cl::Event& event) {
+        return event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE;
+    });
+}
+
+} // namespace
+
+BufferPool::BufferPool(const cl::Context& context, size_t capacity)
+    : context { context }, limit { capacity } {
+    if (limit == 0) {
+        cl_ulong smallest = 0;
+        for (const auto& device : context.getInfo<CL_CONTEXT_DEVICES>()) {
+            const cl_ulong size = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+            smallest = smallest == 0 ? size : std::min(smallest, size);
+        }
+        limit = static_cast<size_t>(smallest / 2);
+    }
+}
+
+size_t BufferPool::sizeClass(size_t bytes) {
+    if (bytes <= MIN_CLASS) {
+        return MIN_CLASS;
+    }
+    size_t power = MIN_CLASS;
+    while (power * 2 <= bytes) {
+        power *= 2;
+    }
+    const size_t step = power / 4;
+    return (bytes + step - 1) / step * step;
+}
+
+cl::Buffer BufferPool::acquire(size_t bytes, cl_mem_flags flags) {
+    std::unique_lock<std::mutex> lock { mutex };
+    const Key key { sizeClass(bytes), flags };
+    if (key.first > limit) {
+        throw cl::Error { CL_MEM_OBJECT_ALLOCATION_FAILURE, "BufferPool::acquire" };
+    }
+    ++counters.acquires;
+
+    collect();
+    auto take = [&]() {
+        auto it = free.find(key);
+        if (it == free.end() || it->second.empty()) {
+            return cl::Buffer {};
+        }
+        cl::Buffer buffer = std::move(it->second.back());
+        it->second.pop_back();
+        ++counters.reuses;
+        counters.bytesInUse += key.first;
+        issued[buffer()] = key;
+        return buffer;
+    };
+    if (cl::Buffer buffer = take(); buffer() != nullptr) {
+        return buffer;
+    }
+
+    // Места не хватает: освобождаем свободные буферы, затем ждем возвращенные
+    evict(key.first);
+    while (counters.bytesAllocated + key.first > limit && !pending.empty()) {
+        // Ожидаем только самый старый буфер: остальные, скорее всего, завершатся вслед за ним.
+        // Ожидание идет без блокировки, чтобы не останавливать release и acquire других потоков
+        const std::vector<cl::Event> oldest = pending.front().events;
+        lock.unlock();
+        try {
+            cl::Event::waitForEvents(oldest);
+        } catch (const cl::Error&) {
+            // Команда завершилась с ошибкой, буфер ей больше не нужен
+        }
+        lock.lock();
+        collect();
+        if (cl::Buffer buffer = take(); buffer() != nullptr) {
+            return buffer;
+        }
+        evict(key.first);
+    }
+    if (counters.bytesAllocated + key.first > limit) {
+        throw cl::Error { CL_MEM_OBJECT_ALLOCATION_FAILURE, "BufferPool::acquire" };
+    }
+
+    cl::Buffer buffer { context, flags, key.first };
+    ++counters.allocations;
+    counters.bytesAllocated += key.first;
+    counters.bytesInUse += key.first;
+    counters.peakBytes = std::max(counters.peakBytes, counters.bytesAllocated);
+    issued[buffer()] = key;
+    return buffer;
+}
+
+void BufferPool::release(const cl::Buffer& buffer, const std::vector<cl::Event>& events) {
+    std::lock_guard<std::mutex> lock { mutex };
+    // Чужой или уже возвращенный буфер в пул не попадает: его размер может не совпадать с классом,
+    // а повторный возврат выдал бы один буфер дважды
+    auto it = issued.find(buffer());
+    if (it == issued.end()) {
+        return;
+    }
+    const Key key = it->second;
+    issued.erase(it);
+    if (events.empty()) {
+        free[key].push_back(buffer);
+        counters.bytesInUse -= key.first;
+    } else {
+        pending.push_back({ key, buffer, events });
+    }
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock { mutex };
+    collect();
+    for (auto& [key, buffers] : free) {
+        counters.evictions += buffers.size();
+        counters.bytesAllocated -= key.first * buffers.size();
+    }
+    free.clear();
+}
+
+BufferPoolStats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock { mutex };
+    return counters;
+}
+
+void BufferPool::collect() {
+    auto done = std::stable_partition(pending.begin(), pending.end(), [](const Pending& entry) {
+        return !completed(entry.events);
+    });
+    for (auto it = done; it != pending.end(); ++it) {
+        free[it->key].push_back(std::move(it->buffer));
+        counters.bytesInUse -= it->key.first;
+    }
+    pending.erase(done, pending.end());
+}
+
+void BufferPool::evict(size_t bytes) {
+    // Сначала освобождаются самые большие буферы
+    for (auto it = free.rbegin(); it != free.rend() && counters.bytesAllocated + bytes > limit; ++it) {
+        while (!it->second.empty() && counters.bytesAllocated + bytes > limit) {
+            it->second.pop_back();
+            ++counters.evictions;
+            counters.bytesAllocated -= it->first.first;
+        }
+    }
+}
+
+void printBufferPoolStats(const BufferPoolStats& stats) {
+    std::cout << "Buffer pool: " << stats.acquires << " acquires (" << stats.allocations << " allocated, "
+              << stats.reuses << " reused), " << stats.evictions << " evicted, "
+              << stats.bytesAllocated / 1024 << " KiB held, peak " << stats.peakBytes / 1024 << " KiB" << std::endl;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,112 @@
+/*!
+  * \defgroup buffer_pool Пул буферов устройства
+  *
+  * Повторное использование буферов openCL между запусками kernel'ей.
+  * Размер запрошенного буфера округляется вверх до класса размеров (четыре класса на каждую степень двойки,
+  * потеря памяти не больше 25%), освобожденные буферы хранятся в списках свободных по классу и флагам.
+  * Буфер, возвращенный вместе с событием, становится доступным только после завершения этого события,
+  * поэтому его можно вернуть в пул сразу после постановки последней использующей его команды в очередь.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief BufferPoolStats Статистика пула буферов
+ */
+struct BufferPoolStats {
+    size_t acquires = 0;        //< выдано буферов
+    size_t allocations = 0;     //< из них создано новых (clCreateBuffer)
+    size_t reuses = 0;          //< из них взято из пула
+    size_t evictions = 0;       //< свободных буферов освобождено, чтобы не превысить лимит
+    size_t bytesAllocated = 0;  //< объем всех буферов пула (выданных, ожидающих и свободных)
+    size_t bytesInUse = 0;      //< объем выданных и еще не завершенных буферов
+    size_t peakBytes = 0;       //< максимальный bytesAllocated
+};
+
+/*!
+ * \brief BufferPool Пул буферов одного контекста с ограничением общего объема
+ *
+ * Методы потокобезопасны.
+ */
+class BufferPool {
+public:
+    /*!
+     * \param [in] context Контекст, в котором создаются буферы
+     * \param [in] capacity Ограничение общего объема буферов в байтах
+     *                      (0 - половина глобальной памяти наименьшего устройства контекста)
+     */
+    explicit BufferPool(const cl::Context& context, size_t capacity = 0);
+
+    /*!
+     * \brief acquire Выдает буфер размером не меньше bytes с флагами flags
+     *
+     * Если новый буфер не помещается в лимит, сначала освобождаются свободные буферы других классов,
+     * затем ожидается завершение событий возвращенных буферов (без блокировки пула).
+     *
+     * \throws cl::Error CL_MEM_OBJECT_ALLOCATION_FAILURE, если буфер не помещается в лимит даже после этого
+     */
+    cl::Buffer acquire(size_t bytes, cl_mem_flags flags = CL_MEM_READ_WRITE);
+
+    /*!
+     * \brief release Возвращает буфер, выданный acquire, в пул
+     *
+     * Буферы, не выданные этим пулом или уже возвращенные, пропускаются: пул их не хранит.
+     *
+     * \param [in] buffer Буфер
+     * \param [in] events События команд, использующих буфер; буфер будет выдан повторно только после их завершения
+     */
+    void release(const cl::Buffer& buffer, const std::vector<cl::Event>& events = {});
+
+    /*!
+     * \brief trim Освобождает все свободные буферы
+     */
+    void trim();
+
+    BufferPoolStats stats() const;
+
+    size_t capacity() const { return limit; }
+
+    /*!
+     * \brief sizeClass Размер буфера, который будет выделен для запроса в bytes байт
+     */
+    static size_t sizeClass(size_t bytes);
+
+private:
+    using Key = std::pair<size_t, cl_mem_flags>;
+
+    struct Pending {
+        Key key;
+        cl::Buffer buffer;
+        std::vector<cl::Event> events;
+    };
+
+    void collect();
+    void evict(size_t bytes);
+
+    cl::Context context;
+    size_t limit;
+    mutable std::mutex mutex;
+    std::map<Key, std::vector<cl::Buffer>> free;
+    std::vector<Pending> pending;
+    std::map<cl_mem, Key> issued;   //< выданные и еще не возвращенные буферы
+    BufferPoolStats counters;
+};
+
+/*!
+ * \brief printBufferPoolStats Выводит статистику пула буферов
+ */
+void printBufferPoolStats(const BufferPoolStats& stats);
+
+/*!
+ * @}
+ */
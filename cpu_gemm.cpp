@@ -0,0 +1,287 @@
+/*!
+  * \addtogroup cpu_gemm
+  * @{
+  */
+
+#include "cpu_gemm.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_GEMM_X86
+#endif
+
+namespace {
+
+/*!
+ * \brief MicroKernel Микроядро, вычисляющее блок C размером mr x nr
+ *
+ * a - упакованная панель A (kc столбцов по mr значений), b - упакованная панель B (kc строк по nr значений).
+ * При accumulate == true результат прибавляется к C, иначе записывается поверх.
+ */
+struct MicroKernel {
+    int mr;
+    int nr;
+    void (*run)(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate);
+    const char* isa;
+};
+
+// Размеры блоков: KC x NR панель B помещается в L1, MC x KC блок A - в L2
+constexpr int KC = 256;
+constexpr int MC_TARGET = 96;
+constexpr int NC = 4096;
+constexpr int MAX_MR = 12;
+constexpr int MAX_NR = 32;
+
+template <int MR, int NR>
+void microKernelGeneric(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    float acc[MR][NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int i = 0; i < MR; ++i) {
+            const float ai = a[p * MR + i];
+            for (int j = 0; j < NR; ++j) {
+                acc[i][j] += ai * b[p * NR + j];
+            }
+        }
+    }
+    for (int i = 0; i < MR; ++i) {
+        for (int j = 0; j < NR; ++j) {
+            float& out = c[static_cast<size_t>(i) * ldc + j];
+            out = accumulate ? out + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+#ifdef CPU_GEMM_X86
+__attribute__((target("avx2,fma")))
+void microKernelAvx2(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    // 6 x 16: 12 аккумуляторов + 2 регистра под строку B + 1 под broadcast
+    __m256 acc[6][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int p = 0; p < kc; ++p) {
+        const __m256 b0 = _mm256_loadu_ps(b);
+        const __m256 b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+        for (int i = 0; i < 6; ++i) {
+            const __m256 ai = _mm256_broadcast_ss(a + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += 6;
+        b += 16;
+    }
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+        }
+        _mm256_storeu_ps(row, acc[i][0]);
+        _mm256_storeu_ps(row + 8, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx512f")))
+void microKernelAvx512(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    // 12 x 32: 24 аккумулятора из 32 zmm регистров
+    __m512 acc[12][2];
+#pragma GCC unroll 12
+    for (int i = 0; i < 12; ++i) {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+    for (int p = 0; p < kc; ++p) {
+        const __m512 b0 = _mm512_loadu_ps(b);
+        const __m512 b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 12
+        for (int i = 0; i < 12; ++i) {
+            const __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += 12;
+        b += 32;
+    }
+#pragma GCC unroll 12
+    for (int i = 0; i < 12; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(row));
+            acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(row + 16));
+        }
+        _mm512_storeu_ps(row, acc[i][0]);
+        _mm512_storeu_ps(row + 16, acc[i][1]);
+    }
+}
+#endif
+
+/*!
+ * \brief selectMicroKernel Выбирает микроядро по возможностям процессора
+ *
+ * Переменная окружения CPU_GEMM_ISA (avx512f, avx2, generic) позволяет принудительно выбрать более простое ядро.
+ */
+const MicroKernel& selectMicroKernel() {
+    static const MicroKernel kernel = [] {
+        const char* forced = std::getenv("CPU_GEMM_ISA");
+        auto allowed = [forced](const char* isa) {
+            return forced == nullptr || std::strcmp(forced, isa) == 0;
+        };
+#ifdef CPU_GEMM_X86
+        __builtin_cpu_init();
+        if (allowed("avx512f") && __builtin_cpu_supports("avx512f")) {
+            return MicroKernel { 12, 32, microKernelAvx512, "avx512f" };
+        }
+        if (allowed("avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return MicroKernel { 6, 16, microKernelAvx2, "avx2" };
+        }
+#endif
+        (void) allowed;
+        return MicroKernel { 4, 16, microKernelGeneric<4, 16>, "generic" };
+    }();
+    return kernel;
+}
+
+/*!
+ * \brief packA Упаковывает блок A (m x kc) в панели по mr строк; недостающие строки заполняются нулями
+ */
+void packA(int m, int kc, const float* a, int lda, int mr, float* dst) {
+    for (int i0 = 0; i0 < m; i0 += mr, dst += kc * mr) {
+        const int rows = std::min(mr, m - i0);
+        for (int i = 0; i < mr; ++i) {
+            if (i < rows) {
+                const float* src = a + static_cast<size_t>(i0 + i) * lda;
+                for (int p = 0; p < kc; ++p) {
+                    dst[p * mr + i] = src[p];
+                }
+            } else {
+                for (int p = 0; p < kc; ++p) {
+                    dst[p * mr + i] = 0.0f;
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * \brief packB Упаковывает одну панель B (kc x nr); недостающие столбцы заполняются нулями
+ */
+void packB(int kc, int n, const float* b, int ldb, int nr, float* dst) {
+    for (int p = 0; p < kc; ++p, dst += nr) {
+        const float* src = b + static_cast<size_t>(p) * ldb;
+        std::copy(src, src + n, dst);
+        std::fill(dst + n, dst + nr, 0.0f);
+    }
+}
+
+} // namespace
+
+void cpuGemm(int M, int N, int K,
+             const float* a, int lda,
+             const float* b, int ldb,
+             float* c, int ldc) {
+    if (M <= 0 || N <= 0) {
+        return;
+    }
+    if (K <= 0) {
+        for (int i = 0; i < M; ++i) {
+            float* row = c + static_cast<size_t>(i) * ldc;
+            std::fill(row, row + N, 0.0f);
+        }
+        return;
+    }
+
+    const MicroKernel& ukr = selectMicroKernel();
+    const int mr = ukr.mr;
+    const int nr = ukr.nr;
+    const int mc = (MC_TARGET + mr - 1) / mr * mr;
+    const int nb = nr * 8;              //< ширина полосы C, обрабатываемой одной задачей
+
+    ThreadPool& pool = ThreadPool::shared();
+
+    const int mPanels = (M + mr - 1) / mr;
+    std::vector<float> packedA (static_cast<size_t>(mPanels) * mr * KC);
+    std::vector<float> packedB (static_cast<size_t>((std::min(N, NC) + nr - 1) / nr) * nr * KC);
+
+    for (int jc = 0; jc < N; jc += NC) {
+        const int ncur = std::min(NC, N - jc);
+        const int nPanels = (ncur + nr - 1) / nr;
+        for (int pc = 0; pc < K; pc += KC) {
+            const int kc = std::min(KC, K - pc);
+            const bool accumulate = pc > 0;
+
+            pool.parallelFor(static_cast<size_t>(nPanels), [&](size_t panel) {
+                const int j = static_cast<int>(panel) * nr;
+                packB(kc, std::min(nr, ncur - j), b + static_cast<size_t>(pc) * ldb + jc + j, ldb, nr,
+                      packedB.data() + panel * kc * nr);
+            });
+            const int mBlocks = (M + mc - 1) / mc;
+            pool.parallelFor(static_cast<size_t>(mBlocks), [&](size_t block) {
+                const int i = static_cast<int>(block) * mc;
+                packA(std::min(mc, M - i), kc, a + static_cast<size_t>(i) * lda + pc, lda, mr,
+                      packedA.data() + static_cast<size_t>(i) * kc);
+            });
+
+            const int nBlocks = (ncur + nb - 1) / nb;
+            pool.parallelFor(static_cast<size_t>(mBlocks) * nBlocks, [&](size_t task) {
+                const int ib = static_cast<int>(task % mBlocks);
+                const int jb = static_cast<int>(task / mBlocks);
+                const int iEnd = std::min(M, (ib + 1) * mc);
+                const int jEnd = std::min(ncur, (jb + 1) * nb);
+                float edge[MAX_MR * MAX_NR];
+
+                for (int j = jb * nb; j < jEnd; j += nr) {
+                    const float* bp = packedB.data() + static_cast<size_t>(j / nr) * kc * nr;
+                    const int cols = std::min(nr, ncur - j);
+                    for (int i = ib * mc; i < iEnd; i += mr) {
+                        const float* ap = packedA.data() + static_cast<size_t>(i) * kc;
+                        const int rows = std::min(mr, M - i);
+                        float* cp = c + static_cast<size_t>(i) * ldc + jc + j;
+                        if (rows == mr && cols == nr) {
+                            ukr.run(kc, ap, bp, cp, ldc, accumulate);
+                            continue;
+                        }
+                        // Краевой блок: считаем во временный буфер и копируем нужную часть
+                        if (accumulate) {
+                            for (int r = 0; r < rows; ++r) {
+                                const float* row = cp + static_cast<size_t>(r) * ldc;
+                                std::copy(row, row + cols, edge + r * nr);
+                            }
+                        }
+                        ukr.run(kc, ap, bp, edge, nr, accumulate);
+                        for (int r = 0; r < rows; ++r) {
+                            std::copy(edge + r * nr, edge + r * nr + cols, cp + static_cast<size_t>(r) * ldc);
+                        }
+                    }
+                }
+            });
+        }
+    }
+}
+
+void multiplyMatrices(const std::vector<float>& a, int rowsA, int colsA,
+                      const std::vector<float>& b, int rowsB, int colsB,
+                      std::vector<float>& out) {
+    assert(colsA == rowsB && "Inner matrix dimensions must agree");
+    assert(a.size() >= static_cast<size_t>(rowsA) * colsA);
+    assert(b.size() >= static_cast<size_t>(rowsB) * colsB);
+    out.resize(static_cast<size_t>(rowsA) * colsB);
+    cpuGemm(rowsA, colsB, colsA, a.data(), colsA, b.data(), colsB, out.data(), colsB);
+}
+
+const char* cpuGemmIsa() {
+    return selectMicroKernel().isa;
+}
+
+/*!
+ * @}
+ */
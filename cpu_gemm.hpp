@@ -0,0 +1,48 @@
+/*!
+  * \defgroup cpu_gemm Умножение матриц на CPU
+  *
+  * Блочное (cache-blocked) умножение матриц одинарной точности на CPU с упаковкой панелей,
+  * SIMD микроядрами (AVX2/FMA, AVX-512) и распараллеливанием по блокам M/N.
+  * Используется как запасной исполнитель при отсутствии openCL устройства и как быстрый эталон для проверки.
+  * @{
+  */
+
+#pragma once
+
+#include <vector>
+
+/*!
+ * \brief cpuGemm Вычисляет C = A * B для матриц в построчном (row-major) формате
+ *
+ * \param [in] M Количество строк A и C
+ * \param [in] N Количество столбцов B и C
+ * \param [in] K Количество столбцов A и строк B
+ * \param [in] a Матрица A, строка i начинается с a + i * lda
+ * \param [in] lda Шаг между строками A (lda >= K)
+ * \param [in] b Матрица B, строка k начинается с b + k * ldb
+ * \param [in] ldb Шаг между строками B (ldb >= N)
+ * \param [out] c Матрица C, строка i начинается с c + i * ldc
+ * \param [in] ldc Шаг между строками C (ldc >= N)
+ */
+void cpuGemm(int M, int N, int K,
+             const float* a, int lda,
+             const float* b, int ldb,
+             float* c, int ldc);
+
+/*!
+ * \brief multiplyMatrices Перемножает матрицы A (rowsA x colsA) и B (rowsB x colsB) в row-major формате
+ *
+ * Результат out имеет размер rowsA x colsB. Требуется colsA == rowsB.
+ */
+void multiplyMatrices(const std::vector<float>& a, int rowsA, int colsA,
+                      const std::vector<float>& b, int rowsB, int colsB,
+                      std::vector<float>& out);
+
+/*!
+ * \brief cpuGemmIsa Название набора инструкций, выбранного для микроядра ("avx512f", "avx2" или "generic")
+ */
+const char* cpuGemmIsa();
+
+/*!
+ * @}
+ */
@@ -0,0 +1,523 @@
+/*!
+  * \addtogroup device_profile
+  * @{
+  */
+
+#include "device_profile.h"
+#include "program_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILE_REPETITIONS 5       //< повторений каждого измерения (берется лучшее)
+#define LAUNCH_REPETITIONS 100      //< запусков пустого kernel'я для оценки задержки
+#define PEAK_ITERATIONS 256         //< итераций цепочек mad в kernel'е пиковой производительности
+#define PEAK_CHAINS 8               //< независимых цепочек mad на work-item
+#define LOCAL_ITERATIONS 256        //< чтений локальной памяти на work-item
+#define TRANSFER_BYTES ((size_t) 64 << 20)
+
+static const char* peakSource =
+        "#ifdef USE_FP64\n"
+        "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+        "#endif\n"
+        "#ifdef USE_FP16\n"
+        "#pragma OPENCL EXTENSION cl_khr_fp16 : enable\n"
+        "#endif\n"
+        "#ifdef INTEGER\n"
+        "#define MAD(x) ((x) * va + vb)\n"
+        "#else\n"
+        "#define MAD(x) mad((x), va, vb)\n"
+        "#endif\n"
+        "kernel void peak(global SCALAR* out, float a, float b) {\n"
+        "    const size_t id = get_global_id(0);\n"
+        "    const VECTOR va = (VECTOR) ((SCALAR) a), vb = (VECTOR) ((SCALAR) b);\n"
+        "    VECTOR x0 = (VECTOR) ((SCALAR) (id & 7));\n"
+        "    VECTOR x1 = x0 + (VECTOR) ((SCALAR) 1), x2 = x0 + (VECTOR) ((SCALAR) 2);\n"
+        "    VECTOR x3 = x0 + (VECTOR) ((SCALAR) 3), x4 = x0 + (VECTOR) ((SCALAR) 4);\n"
+        "    VECTOR x5 = x0 + (VECTOR) ((SCALAR) 5), x6 = x0 + (VECTOR) ((SCALAR) 6);\n"
+        "    VECTOR x7 = x0 + (VECTOR) ((SCALAR) 7);\n"
+        "    for (int i = 0; i < ITERATIONS; ++i) {\n"
+        "        x0 = MAD(x0); x1 = MAD(x1); x2 = MAD(x2); x3 = MAD(x3);\n"
+        "        x4 = MAD(x4); x5 = MAD(x5); x6 = MAD(x6); x7 = MAD(x7);\n"
+        "    }\n"
+        "    const VECTOR s = ((x0 + x1) + (x2 + x3)) + ((x4 + x5) + (x6 + x7));\n"
+        "    out[id] = (s.s0 + s.s1) + (s.s2 + s.s3);\n"
+        "}\n";
+
+static const char* memorySource =
+        "kernel void copy(const global float4* in, global float4* out) {\n"
+        "    const size_t id = get_global_id(0);\n"
+        "    out[id] = in[id];\n"
+        "}\n"
+        "kernel void localRead(global float* out, local float4* tile) {\n"
+        "    const int lid = get_local_id(0);\n"
+        "    const int mask = get_local_size(0) - 1;\n"
+        "    tile[lid] = (float4) (lid);\n"
+        "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+        "    float4 acc = (float4) (0.0f);\n"
+        "    for (int i = 0; i < ITERATIONS; ++i) {\n"
+        "        acc += tile[(lid + i) & mask];\n"
+        "    }\n"
+        "    out[get_global_id(0)] = (acc.x + acc.y) + (acc.z + acc.w);\n"
+        "}\n"
+        "kernel void empty(global float* out) {\n"
+        "}\n";
+
+/*!
+ * \brief ProfileField Поле профиля в файле базы
+ */
+typedef struct ProfileField {
+    const char* name;
+    size_t offset;
+} ProfileField;
+
+static const ProfileField profileFields[] = {
+    { "half", offsetof(DeviceProfile, gflopsHalf) },
+    { "float", offsetof(DeviceProfile, gflopsFloat) },
+    { "double", offsetof(DeviceProfile, gflopsDouble) },
+    { "int", offsetof(DeviceProfile, giopsInt) },
+    { "global", offsetof(DeviceProfile, globalBandwidth) },
+    { "local", offsetof(DeviceProfile, localBandwidth) },
+    { "writePageable", offsetof(DeviceProfile, writePageable) },
+    { "readPageable", offsetof(DeviceProfile, readPageable) },
+    { "writePinned", offsetof(DeviceProfile, writePinned) },
+    { "readPinned", offsetof(DeviceProfile, readPinned) },
+    { "launch", offsetof(DeviceProfile, launchLatency) },
+};
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int hasExtension(cl_device_id device, const char* extension) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &size) != CL_SUCCESS) {
+        return 0;
+    }
+    char* extensions = (char*) malloc(size + 1);
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, size, extensions, NULL);
+    extensions[size] = '\0';
+    // Расширения разделены пробелами, поэтому сравнивается имя целиком
+    const size_t length = strlen(extension);
+    int found = 0;
+    for (const char* p = strstr(extensions, extension); p != NULL && !found; p = strstr(p + 1, extension)) {
+        found = (p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0');
+    }
+    free(extensions);
+    return found;
+}
+
+/*!
+ * \brief runKernel Запускает kernel с прогревом и возвращает лучшее время выполнения по событиям профилирования
+ */
+static cl_int runKernel(cl_command_queue queue, cl_kernel kernel, size_t global, const size_t* local,
+                        double* seconds) {
+    *seconds = 0.0;
+    for (int i = 0; i <= PROFILE_REPETITIONS; ++i) {
+        cl_event event;
+        cl_int err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, local, 0, NULL, &event);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        err = clWaitForEvents(1, &event);
+        cl_ulong start = 0, end = 0;
+        if (err == CL_SUCCESS) {
+            err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+        }
+        if (err == CL_SUCCESS) {
+            err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+        }
+        clReleaseEvent(event);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        // Первый запуск - прогревочный
+        const double elapsed = (end - start) * 1e-9;
+        if (i > 0 && elapsed > 0.0 && (*seconds == 0.0 || elapsed < *seconds)) {
+            *seconds = elapsed;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+/*!
+ * \brief measurePeak Измеряет пиковую производительность цепочек mad для типа, заданного опциями компиляции
+ */
+static cl_int measurePeak(cl_context context, cl_device_id device, cl_command_queue queue,
+                          const char* typeOptions, float a, float b, size_t global, double* result) {
+    char options[256];
+    snprintf(options, sizeof(options), "%s -D ITERATIONS=%d", typeOptions, PEAK_ITERATIONS);
+    cl_int err;
+    cl_program program = buildProgramCached(context, device, peakSource, options, &err);
+    if (program == NULL || err != CL_SUCCESS) {
+        if (program != NULL) {
+            clReleaseProgram(program);
+        }
+        return err;
+    }
+    cl_kernel kernel = clCreateKernel(program, "peak", &err);
+    cl_mem out = err == CL_SUCCESS
+            ? clCreateBuffer(context, CL_MEM_WRITE_ONLY, global * sizeof(cl_double), NULL, &err) : NULL;
+    double seconds = 0.0;
+    if (err == CL_SUCCESS) {
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &out);
+        clSetKernelArg(kernel, 1, sizeof(float), &a);
+        clSetKernelArg(kernel, 2, sizeof(float), &b);
+        err = runKernel(queue, kernel, global, NULL, &seconds);
+    }
+    // Каждая итерация - mad над PEAK_CHAINS векторами из 4 элементов, mad считается за 2 операции
+    const double operations = (double) global * PEAK_ITERATIONS * PEAK_CHAINS * 4 * 2;
+    *result = err == CL_SUCCESS && seconds > 0.0 ? operations / seconds / 1e9 : 0.0;
+
+    if (out != NULL) {
+        clReleaseMemObject(out);
+    }
+    if (kernel != NULL) {
+        clReleaseKernel(kernel);
+    }
+    clReleaseProgram(program);
+    return err;
+}
+
+/*!
+ * \brief measureTransfer Измеряет скорость блокирующих записи и чтения bytes байт из host (лучшее из повторений)
+ */
+static cl_int measureTransfer(cl_command_queue queue, cl_mem buffer, void* host, size_t bytes,
+                              double* write, double* read) {
+    double bestWrite = 0.0, bestRead = 0.0;
+    for (int i = 0; i <= PROFILE_REPETITIONS; ++i) {
+        double start = nowSeconds();
+        cl_int err = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0, bytes, host, 0, NULL, NULL);
+        const double written = nowSeconds() - start;
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        start = nowSeconds();
+        err = clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0, bytes, host, 0, NULL, NULL);
+        const double readBack = nowSeconds() - start;
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        if (i > 0) {
+            bestWrite = bestWrite == 0.0 || written < bestWrite ? written : bestWrite;
+            bestRead = bestRead == 0.0 || readBack < bestRead ? readBack : bestRead;
+        }
+    }
+    *write = bestWrite > 0.0 ? bytes / bestWrite / 1e9 : 0.0;
+    *read = bestRead > 0.0 ? bytes / bestRead / 1e9 : 0.0;
+    return CL_SUCCESS;
+}
+
+/*!
+ * \brief measureMemory Измеряет глобальную и локальную память, передачи и задержку запуска
+ */
+static cl_int measureMemory(cl_context context, cl_device_id device, cl_command_queue queue,
+                            size_t groupSize, size_t groups, DeviceProfile* profile) {
+    char options[64];
+    snprintf(options, sizeof(options), "-D ITERATIONS=%d", LOCAL_ITERATIONS);
+    cl_int err;
+    cl_program program = buildProgramCached(context, device, memorySource, options, &err);
+    if (program == NULL || err != CL_SUCCESS) {
+        if (program != NULL) {
+            clReleaseProgram(program);
+        }
+        return err;
+    }
+    cl_kernel copy = clCreateKernel(program, "copy", &err);
+    cl_kernel localRead = err == CL_SUCCESS ? clCreateKernel(program, "localRead", &err) : NULL;
+    cl_kernel empty = err == CL_SUCCESS ? clCreateKernel(program, "empty", &err) : NULL;
+
+    cl_ulong maxAlloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc), &maxAlloc, NULL);
+    size_t bytes = TRANSFER_BYTES;
+    if (maxAlloc > 0 && bytes > maxAlloc) {
+        bytes = (size_t) maxAlloc / 16 * 16;
+    }
+    cl_mem in = NULL, out = NULL, pinned = NULL;
+    if (err == CL_SUCCESS) {
+        in = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+    }
+    if (err == CL_SUCCESS) {
+        out = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+    }
+
+    // Глобальная память: копирование, каждый байт читается и записывается
+    double seconds = 0.0;
+    if (err == CL_SUCCESS) {
+        clSetKernelArg(copy, 0, sizeof(cl_mem), &in);
+        clSetKernelArg(copy, 1, sizeof(cl_mem), &out);
+        err = runKernel(queue, copy, bytes / 16, NULL, &seconds);
+        profile->globalBandwidth = seconds > 0.0 ? 2.0 * bytes / seconds / 1e9 : 0.0;
+    }
+
+    // Локальная память: чтение по кругу из массива work-group, размер которой - степень двойки
+    if (err == CL_SUCCESS) {
+        size_t kernelGroup = groupSize;
+        clGetKernelWorkGroupInfo(localRead, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelGroup), &kernelGroup,
+                                 NULL);
+        size_t local = groupSize;
+        while (local > kernelGroup && local > 1) {
+            local /= 2;
+        }
+        const size_t global = groups * local;
+        clSetKernelArg(localRead, 0, sizeof(cl_mem), &out);
+        clSetKernelArg(localRead, 1, local * 4 * sizeof(cl_float), NULL);
+        err = runKernel(queue, localRead, global, &local, &seconds);
+        profile->localBandwidth = seconds > 0.0
+                ? (double) global * LOCAL_ITERATIONS * 4 * sizeof(cl_float) / seconds / 1e9 : 0.0;
+    }
+
+    // Передачи из обычной памяти хоста
+    if (err == CL_SUCCESS) {
+        void* host = malloc(bytes);
+        if (host == NULL) {
+            err = CL_OUT_OF_HOST_MEMORY;
+        } else {
+            memset(host, 0, bytes);
+            err = measureTransfer(queue, in, host, bytes, &profile->writePageable, &profile->readPageable);
+            free(host);
+        }
+    }
+    // Передачи из закрепленной памяти: буфер CL_MEM_ALLOC_HOST_PTR, отображенный в память хоста
+    if (err == CL_SUCCESS) {
+        pinned = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, bytes, NULL, &err);
+    }
+    if (err == CL_SUCCESS) {
+        void* host = clEnqueueMapBuffer(queue, pinned, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes,
+                                        0, NULL, NULL, &err);
+        if (err == CL_SUCCESS) {
+            err = measureTransfer(queue, in, host, bytes, &profile->writePinned, &profile->readPinned);
+            clEnqueueUnmapMemObject(queue, pinned, host, 0, NULL, NULL);
+            clFinish(queue);
+        }
+    }
+
+    // Задержка запуска: постановка в очередь пустого kernel'я и ожидание его завершения
+    if (err == CL_SUCCESS) {
+        const size_t one = 1;
+        clSetKernelArg(empty, 0, sizeof(cl_mem), &out);
+        err = clEnqueueNDRangeKernel(queue, empty, 1, NULL, &one, NULL, 0, NULL, NULL);
+        err = err == CL_SUCCESS ? clFinish(queue) : err;
+        const double start = nowSeconds();
+        for (int i = 0; i < LAUNCH_REPETITIONS && err == CL_SUCCESS; ++i) {
+            err = clEnqueueNDRangeKernel(queue, empty, 1, NULL, &one, NULL, 0, NULL, NULL);
+            err = err == CL_SUCCESS ? clFinish(queue) : err;
+        }
+        profile->launchLatency = (nowSeconds() - start) / LAUNCH_REPETITIONS * 1e6;
+    }
+
+    cl_mem buffers[3] = { in, out, pinned };
+    for (int i = 0; i < 3; ++i) {
+        if (buffers[i] != NULL) {
+            clReleaseMemObject(buffers[i]);
+        }
+    }
+    cl_kernel kernels[3] = { copy, localRead, empty };
+    for (int i = 0; i < 3; ++i) {
+        if (kernels[i] != NULL) {
+            clReleaseKernel(kernels[i]);
+        }
+    }
+    clReleaseProgram(program);
+    return err;
+}
+
+void deviceProfileKey(cl_device_id device, char* key, size_t size) {
+    char name[256] = "", vendor[256] = "", driver[256] = "";
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name) - 1, name, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_VENDOR, sizeof(vendor) - 1, vendor, NULL);
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driver) - 1, driver, NULL);
+    snprintf(key, size, "%s | %s | %s", name, vendor, driver);
+    // Ключ хранится в строке базы до табуляции
+    for (char* p = key; *p != '\0'; ++p) {
+        if (*p == '\t' || *p == '\n') {
+            *p = ' ';
+        }
+    }
+}
+
+cl_int profileDevice(cl_device_id device, DeviceProfile* profile) {
+    memset(profile, 0, sizeof(*profile));
+    deviceProfileKey(device, profile->device, sizeof(profile->device));
+
+    cl_int err;
+    cl_context context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+    if (context == NULL) {
+        return err;
+    }
+    const cl_queue_properties properties[] = { CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0 };
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, properties, &err);
+    if (queue == NULL) {
+        clReleaseContext(context);
+        return err;
+    }
+
+    // Несколько work-group на вычислительный блок, чтобы загрузить все блоки и скрыть задержки
+    cl_uint units = 1;
+    size_t maxGroup = 1;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, NULL);
+    size_t groupSize = 1;
+    while (groupSize * 2 <= maxGroup && groupSize < 256) {
+        groupSize *= 2;
+    }
+    const size_t groups = (size_t) (units > 0 ? units : 1) * 8;
+    const size_t global = groups * groupSize;
+
+    cl_ulong doubleConfig = 0;
+    clGetDeviceInfo(device, CL_DEVICE_DOUBLE_FP_CONFIG, sizeof(doubleConfig), &doubleConfig, NULL);
+    // Множитель меньше 1 и малое слагаемое не дают значениям переполниться или стать денормализованными
+    err = measurePeak(context, device, queue, "-D SCALAR=float -D VECTOR=float4", 0.999f, 0.001f, global,
+                      &profile->gflopsFloat);
+    // Целые беззнаковые: их переполнение определено (по модулю 2^32), а переполнение int - неопределенное
+    // поведение, и компилятор может свернуть цикл и завысить пик
+    if (err == CL_SUCCESS) {
+        err = measurePeak(context, device, queue, "-D SCALAR=uint -D VECTOR=uint4 -D INTEGER", 3.0f, 1.0f, global,
+                          &profile->giopsInt);
+    }
+    // Ошибка измерения необязательного типа означает, что тип не поддерживается, а не сбой профилирования
+    if (err == CL_SUCCESS && (doubleConfig != 0 || hasExtension(device, "cl_khr_fp64"))) {
+        measurePeak(context, device, queue, "-D SCALAR=double -D VECTOR=double4 -D USE_FP64",
+                    0.999f, 0.001f, global, &profile->gflopsDouble);
+    }
+    if (err == CL_SUCCESS && hasExtension(device, "cl_khr_fp16")) {
+        measurePeak(context, device, queue, "-D SCALAR=half -D VECTOR=half4 -D USE_FP16",
+                    0.999f, 0.001f, global, &profile->gflopsHalf);
+    }
+    if (err == CL_SUCCESS) {
+        err = measureMemory(context, device, queue, groupSize, groups, profile);
+    }
+
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+    return err;
+}
+
+void printRoofline(const DeviceProfile* profile) {
+    printf("%s\n", profile->device);
+    printf("\tpeak:\t\thalf %.1f, float %.1f, double %.1f GFLOPS, int %.1f GIOPS (0 - not supported)\n",
+           profile->gflopsHalf, profile->gflopsFloat, profile->gflopsDouble, profile->giopsInt);
+    printf("\tmemory:\t\tglobal %.2f GB/s, local %.2f GB/s\n", profile->globalBandwidth, profile->localBandwidth);
+    printf("\ttransfer:\tpageable write %.2f / read %.2f GB/s, pinned write %.2f / read %.2f GB/s\n",
+           profile->writePageable, profile->readPageable, profile->writePinned, profile->readPinned);
+    printf("\tlaunch latency:\t%.1f us\n", profile->launchLatency);
+    if (profile->globalBandwidth <= 0.0) {
+        return;
+    }
+
+    // Достижимая производительность при заданной арифметической интенсивности (операций на байт глобальной памяти)
+    static const double intensities[] = { 0.25, 1.0, 4.0, 16.0, 64.0 };
+    const struct {
+        const char* name;
+        double peak;
+    } types[] = {
+        { "half", profile->gflopsHalf }, { "float", profile->gflopsFloat },
+        { "double", profile->gflopsDouble }, { "int", profile->giopsInt },
+    };
+    printf("\troofline, G(FL)OPS at intensity (ops/byte):\n\t\t");
+    for (size_t i = 0; i < sizeof(intensities) / sizeof(intensities[0]); ++i) {
+        printf("%10.2f", intensities[i]);
+    }
+    printf("%10s\n", "ridge");
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+        if (types[t].peak <= 0.0) {
+            continue;
+        }
+        printf("\t%s\t", types[t].name);
+        for (size_t i = 0; i < sizeof(intensities) / sizeof(intensities[0]); ++i) {
+            const double bound = intensities[i] * profile->globalBandwidth;
+            printf("%10.1f", bound < types[t].peak ? bound : types[t].peak);
+        }
+        printf("%10.2f\n", types[t].peak / profile->globalBandwidth);
+    }
+}
+
+const char* deviceProfilePath(void) {
+    const char* path = getenv("DEVICE_PROFILE_DB");
+    return path != NULL ? path : "device_profiles.db";
+}
+
+/*!
+ * \brief sameKey Проверяет, что строка базы относится к устройству key
+ */
+static int sameKey(const char* line, const char* key) {
+    const size_t length = strlen(key);
+    return strncmp(line, key, length) == 0 && line[length] == '\t';
+}
+
+int saveDeviceProfile(const char* path, const DeviceProfile* profile) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* out = fopen(tmp, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    // Профили остальных устройств переносятся без изменений
+    FILE* in = fopen(path, "r");
+    if (in != NULL) {
+        char* line = NULL;
+        size_t capacity = 0;
+        while (getline(&line, &capacity, in) != -1) {
+            if (!sameKey(line, profile->device)) {
+                fputs(line, out);
+            }
+        }
+        free(line);
+        fclose(in);
+    }
+    fprintf(out, "%s\t", profile->device);
+    for (size_t i = 0; i < sizeof(profileFields) / sizeof(profileFields[0]); ++i) {
+        const double value = *(const double*) ((const char*) profile + profileFields[i].offset);
+        fprintf(out, "%s%s=%.6g", i > 0 ? " " : "", profileFields[i].name, value);
+    }
+    fprintf(out, "\n");
+    if (fclose(out) != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int loadDeviceProfile(const char* path, cl_device_id device, DeviceProfile* profile) {
+    memset(profile, 0, sizeof(*profile));
+    deviceProfileKey(device, profile->device, sizeof(profile->device));
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        return -1;
+    }
+    int found = -1;
+    char* line = NULL;
+    size_t capacity = 0;
+    while (found != 0 && getline(&line, &capacity, in) != -1) {
+        if (!sameKey(line, profile->device)) {
+            continue;
+        }
+        found = 0;
+        char* saved = NULL;
+        for (char* token = strtok_r(line + strlen(profile->device) + 1, " \n", &saved); token != NULL;
+             token = strtok_r(NULL, " \n", &saved)) {
+            char* value = strchr(token, '=');
+            if (value == NULL) {
+                continue;
+            }
+            *value++ = '\0';
+            // Неизвестные поля пропускаются, чтобы база читалась и после добавления новых измерений
+            for (size_t i = 0; i < sizeof(profileFields) / sizeof(profileFields[0]); ++i) {
+                if (strcmp(token, profileFields[i].name) == 0) {
+                    *(double*) ((char*) profile + profileFields[i].offset) = strtod(value, NULL);
+                }
+            }
+        }
+    }
+    free(line);
+    fclose(in);
+    return found;
+}
+
+/*!
+ * @}
+ */
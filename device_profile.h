@@ -0,0 +1,89 @@
+/*!
+  * \defgroup device_profile Измеренные характеристики устройств
+  *
+  * Микротесты, измеряющие реальные возможности устройства вместо оценки по паспортным данным:
+  *  - пиковая производительность цепочек mad над векторами из 4 элементов для half, float, double и int;
+  *  - пропускная способность глобальной памяти (копирование буфера) и локальной памяти (чтение из local);
+  *  - скорость передачи хост <-> устройство из обычной (pageable) и закрепленной (pinned) памяти;
+  *  - задержка запуска пустого kernel'я (от постановки в очередь до завершения clFinish).
+  *
+  * По результатам строится roofline: достижимая производительность min(пик, интенсивность * пропускная способность).
+  * Профили хранятся в текстовой базе (строка на устройство), чтобы планировщики и подбор параметров
+  * могли использовать измеренные значения без повторных измерений.
+  * Путь к базе задается переменной окружения DEVICE_PROFILE_DB (по умолчанию device_profiles.db).
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief DeviceProfile Измеренные характеристики устройства (0 - тип не поддерживается или не измерен)
+ */
+typedef struct DeviceProfile {
+    char device[512];           //< ключ устройства: имя | производитель | версия драйвера
+    double gflopsHalf;          //< пик half, GFLOPS (mad = 2 операции)
+    double gflopsFloat;         //< пик float, GFLOPS
+    double gflopsDouble;        //< пик double, GFLOPS
+    double giopsInt;            //< пик 32-битных целых (умножение и сложение uint), GIOPS
+    double globalBandwidth;     //< глобальная память, GB/s (чтение + запись)
+    double localBandwidth;      //< локальная память, GB/s (чтение)
+    double writePageable;       //< хост -> устройство из обычной памяти, GB/s
+    double readPageable;        //< устройство -> хост в обычную память, GB/s
+    double writePinned;         //< хост -> устройство из закрепленной памяти, GB/s
+    double readPinned;          //< устройство -> хост в закрепленную память, GB/s
+    double launchLatency;       //< задержка запуска kernel'я, мкс
+} DeviceProfile;
+
+/*!
+ * \brief deviceProfileKey Записывает в key ключ устройства (имя | производитель | версия драйвера)
+ */
+void deviceProfileKey(cl_device_id device, char* key, size_t size);
+
+/*!
+ * \brief profileDevice Измеряет характеристики устройства (занимает от долей секунды до нескольких секунд)
+ *
+ * Создает собственные контекст и очередь. Каждое значение - лучшее из нескольких повторений после прогрева.
+ * \param [in] device Устройство
+ * \param [out] profile Результаты
+ * \return CL_SUCCESS или код первой ошибки openCL
+ */
+cl_int profileDevice(cl_device_id device, DeviceProfile* profile);
+
+/*!
+ * \brief printRoofline Выводит измеренные характеристики и roofline для каждого поддерживаемого типа
+ */
+void printRoofline(const DeviceProfile* profile);
+
+/*!
+ * \brief deviceProfilePath Путь к базе профилей (DEVICE_PROFILE_DB или device_profiles.db)
+ */
+const char* deviceProfilePath(void);
+
+/*!
+ * \brief saveDeviceProfile Сохраняет профиль в базу, заменяя прежний профиль того же устройства
+ *
+ * Запись выполняется во временный файл с последующим переименованием.
+ * \return 0 при успехе, -1 при ошибке
+ */
+int saveDeviceProfile(const char* path, const DeviceProfile* profile);
+
+/*!
+ * \brief loadDeviceProfile Загружает из базы профиль устройства
+ * \return 0, если профиль найден, иначе -1
+ */
+int loadDeviceProfile(const char* path, cl_device_id device, DeviceProfile* profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
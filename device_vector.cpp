@@ -0,0 +1,297 @@
+/*!
+  * \addtogroup device_vector
+  * @{
+  */
+
+#include "device_vector.hpp"
+#include "launch_geometry.h"
+#include "program_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <tuple>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+struct FusionCache {
+    std::mutex mutex;
+    std::map<std::tuple<cl_context, cl_device_id, std::string>, cl::Kernel> kernels;
+    FusionStats stats;
+};
+
+FusionCache& fusionCache() {
+    static FusionCache cache;
+    return cache;
+}
+
+// Выражение вставляется дважды: для WIDTH элементов векторными типами и для хвоста поэлементно.
+// AT(v) читает элементы вектора v, FROM_SCALAR(s) приводит скаляр к типу вычислений
+constexpr std::string_view kernelFusedPrologue { R"CLC(
+#ifdef ENABLE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+#ifdef ENABLE_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+
+#define CAT_(a, b) a ## b
+#define CAT(a, b) CAT_(a, b)
+
+#ifdef HALF_STORAGE
+// half только для хранения: загрузка и сохранение с преобразованием, вычисления во float
+#define SCALAR float
+#define FROM_SCALAR(s) (s)
+#define LOAD(p) vload_half(0, p)
+#define STORE(v, p) vstore_half(v, 0, p)
+#define LOAD_VEC(p) CAT(vload_half, WIDTH)(0, p)
+#define STORE_VEC(v, p) CAT(vstore_half, WIDTH)(v, 0, p)
+#else
+#ifdef ENABLE_FP16
+#define SCALAR float
+#define FROM_SCALAR(s) ((half) (s))
+#else
+#define SCALAR TYPE
+#define FROM_SCALAR(s) (s)
+#endif
+#define LOAD(p) (*(p))
+#define STORE(v, p) (*(p) = (v))
+#define LOAD_VEC(p) CAT(vload, WIDTH)(0, p)
+#define STORE_VEC(v, p) CAT(vstore, WIDTH)(v, 0, p)
+#endif
+)CLC" };
+
+/*!
+ * \brief fusedKernel Kernel выражения из кэша; при первом использовании сигнатуры компилирует программу
+ *
+ * Вызывается под блокировкой кэша. compiled - была ли программа скомпилирована этим вызовом.
+ */
+cl::Kernel& fusedKernel(FusionCache& cache, cl_context context, cl_device_id device, const char* type,
+                        const char* extension, int width, const std::string& params, const std::string& expression,
+                        bool& compiled) {
+    std::ostringstream options;
+    options << "-D TYPE=" << type << " -D WIDTH=" << width;
+    if (extension != nullptr) {
+        // Обертка не захватывает ссылку, поэтому устройство из очереди нужно захватить
+        clRetainDevice(device);
+        const bool supported = deviceHasExtension(cl::Device { device }, extension);
+        if (extension == "cl_khr_fp16"sv) {
+            options << (supported ? " -D ENABLE_FP16" : " -D HALF_STORAGE");
+        } else if (!supported) {
+            throw std::runtime_error { std::string { type } + " is not supported by the device (" + extension + ")" };
+        } else if (extension == "cl_khr_fp64"sv) {
+            options << " -D ENABLE_FP64";
+        }
+    }
+
+    // Сигнатура выражения: параметры компиляции, параметры kernel'я и само выражение. Контекст в ключе не может
+    // смениться на другой по тому же адресу, т.к. kernel в кэше удерживает свою программу и контекст
+    const std::string signature = options.str() + params + " => " + expression;
+
+    auto key = std::make_tuple(context, device, signature);
+    auto it = cache.kernels.find(key);
+    compiled = it == cache.kernels.end();
+    if (compiled) {
+        const std::string source = std::string { kernelFusedPrologue } +
+                "kernel void fused(const ulong n" + params + ", global TYPE* result) {\n"
+                "    const size_t items = (n + WIDTH - 1) / WIDTH;\n"
+                "    for (size_t item = get_global_id(0); item < items; item += get_global_size(0)) {\n"
+                "        const size_t first = item * WIDTH;\n"
+                "#if WIDTH > 1\n"
+                "        if (first + WIDTH <= n) {\n"
+                "#define AT(p) LOAD_VEC((p) + first)\n"
+                "            STORE_VEC(" + expression + ", result + first);\n"
+                "#undef AT\n"
+                "            continue;\n"
+                "        }\n"
+                "#endif\n"
+                "#define AT(p) LOAD((p) + i)\n"
+                "        for (size_t i = first; i < n && i < first + WIDTH; ++i) {\n"
+                "            STORE(" + expression + ", result + i);\n"
+                "        }\n"
+                "#undef AT\n"
+                "    }\n"
+                "}\n";
+        // Обертки C++ освобождают объекты при уничтожении, поэтому ссылки из очереди нужно захватить
+        clRetainContext(context);
+        clRetainDevice(device);
+        cl::Program program = buildProgramCached(cl::Context { context }, cl::Device { device }, source, options.str());
+        it = cache.kernels.emplace(key, cl::Kernel { program, "fused" }).first;
+        ++cache.stats.compiled;
+    }
+    return it->second;
+}
+
+} // namespace
+
+HalfFloat::HalfFloat(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const uint32_t absolute = x & 0x7fffffff;
+    if (absolute >= 0x7f800000) {
+        // inf и NaN (NaN остается NaN)
+        bits = static_cast<cl_half>(sign | 0x7c00 | (absolute > 0x7f800000 ? 0x200 : 0));
+        return;
+    }
+    if (absolute >= 0x477ff000) {
+        // Больше 65504 с учетом округления - переполнение
+        bits = static_cast<cl_half>(sign | 0x7c00);
+        return;
+    }
+    // Округление к ближайшему четному в обоих ветках
+    if (absolute < 0x38800000) {
+        // Денормализованные half (меньше 2^-14) и ноль
+        if (absolute < 0x33000000) {
+            bits = static_cast<cl_half>(sign);
+            return;
+        }
+        const uint32_t mantissa = (absolute & 0x7fffff) | 0x800000;
+        const int shift = 126 - static_cast<int>(absolute >> 23);
+        uint32_t result = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (result & 1))) {
+            ++result;
+        }
+        bits = static_cast<cl_half>(sign | result);
+        return;
+    }
+    uint32_t result = (absolute >> 13) - (112 << 10);
+    const uint32_t rest = absolute & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (result & 1))) {
+        ++result;
+    }
+    bits = static_cast<cl_half>(sign | result);
+}
+
+HalfFloat::operator float() const {
+    const uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+    const uint32_t exponent = (bits >> 10) & 0x1f;
+    const uint32_t mantissa = bits & 0x3ff;
+    if (exponent == 0) {
+        const float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -value : value;
+    }
+    const uint32_t x = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13)
+                                        : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+DeviceStorage::DeviceStorage(const cl::Context& context, const cl::CommandQueue& queue, size_t size,
+                             size_t elementSize, const void* host, BufferPool* pool)
+    : bufferContext { context }, commandQueue { queue }, length { size }, bufferPool { pool } {
+    if (pool == nullptr) {
+        storage = cl::Buffer { context, static_cast<cl_mem_flags>(host != nullptr ? CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR
+                                                                               : CL_MEM_READ_WRITE),
+                               elementSize * size, const_cast<void*>(host) };
+        return;
+    }
+    storage = pool->acquire(elementSize * size);
+    lease.reset(new Lease { pool, storage, queue });
+    if (host != nullptr) {
+        cl::Event event;
+        commandQueue.enqueueWriteBuffer(storage, CL_TRUE, 0, elementSize * size, host, nullptr, &event);
+        traceCommand(event, "write vector");
+    }
+}
+
+void DeviceStorage::markUsed(const cl::CommandQueue& queue, const cl::Event& event) const {
+    if (lease == nullptr || queue() == lease->queue()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock { lease->mutex };
+    // Завершенные команды буфер уже не держат, список не растет при долгой жизни вектора
+    auto done = std::remove_if(lease->uses.begin(), lease->uses.end(), [](const cl::Event& use) {
+        return use.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE;
+    });
+    lease->uses.erase(done, lease->uses.end());
+    lease->uses.push_back(event);
+}
+
+DeviceStorage::Lease::~Lease() {
+    try {
+        // Очередь упорядочена: маркер завершается после всех команд вектора, поставленных в нее
+        cl::Event marker;
+        queue.enqueueMarkerWithWaitList(nullptr, &marker);
+        uses.push_back(marker);
+        pool->release(buffer, uses);
+    } catch (const cl::Error&) {
+        // Буфер без маркера не возвращается в пул и освобождается вместе с последней ссылкой на него
+    }
+}
+
+bool deviceHasExtension(const cl::Device& device, const char* extension) {
+    std::istringstream extensions { device.getInfo<CL_DEVICE_EXTENSIONS>() };
+    std::string name;
+    while (extensions >> name) {
+        if (name == extension) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FusionStats fusionStats() {
+    auto& cache = fusionCache();
+    std::lock_guard<std::mutex> lock { cache.mutex };
+    return cache.stats;
+}
+
+void prepareFused(const cl::Context& context, const cl::Device& device, const char* type, const char* extension,
+                  int width, const std::string& params, const std::string& expression) {
+    auto& cache = fusionCache();
+    std::lock_guard<std::mutex> lock { cache.mutex };
+    bool compiled;
+    fusedKernel(cache, context(), device(), type, extension, width, params, expression, compiled);
+}
+
+cl::Event enqueueFused(cl::CommandQueue& queue, const char* type, const char* extension, int width,
+                       const std::string& params, const std::string& expression, size_t count,
+                       const std::function<void(cl::Kernel&)>& bind, const std::vector<cl::Event>* events) {
+    cl_context context;
+    cl_device_id device;
+    cl_int err = clGetCommandQueueInfo(queue(), CL_QUEUE_CONTEXT, sizeof(context), &context, nullptr);
+    if (err == CL_SUCCESS) {
+        err = clGetCommandQueueInfo(queue(), CL_QUEUE_DEVICE, sizeof(device), &device, nullptr);
+    }
+    if (err != CL_SUCCESS) {
+        throw cl::Error { err, "clGetCommandQueueInfo" };
+    }
+
+    auto& cache = fusionCache();
+    // Аргументы kernel'я общие, поэтому установка аргументов и запуск выполняются под блокировкой
+    std::lock_guard<std::mutex> lock { cache.mutex };
+    bool compiled;
+    cl::Kernel& kernel = fusedKernel(cache, context, device, type, extension, width, params, expression, compiled);
+    if (!compiled) {
+        ++cache.stats.reused;
+    }
+
+    kernel.setArg(0, static_cast<cl_ulong>(count));
+    bind(kernel);
+    // Порции по width элементов проходятся циклом с шагом в размер NDRange
+    LaunchGeometry geometry;
+    err = chooseLaunchGeometry(device, kernel(), (count + width - 1) / width, &geometry);
+    if (err != CL_SUCCESS) {
+        throw cl::Error { err, "chooseLaunchGeometry" };
+    }
+    cl::Event event;
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange (geometry.global), cl::NDRange (geometry.local),
+                               events, &event);
+    traceCommand(event, "fused");
+    return event;
+}
+
+/*!
+ * @}
+ */
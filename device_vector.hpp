@@ -0,0 +1,401 @@
+/*!
+  * \defgroup device_vector Векторы на устройстве и слияние поэлементных операций
+  *
+  * DeviceVector хранит вектор в буфере openCL. Арифметические операции над векторами не выполняются сразу,
+  * а строят дерево выражения (expression templates): `auto d = a + b * c - e;` - это выражение,
+  * которое вычисляется одним kernel'ем при присваивании в DeviceVector. Каждый вход читается
+  * из глобальной памяти один раз, результат записывается один раз, временных буферов нет.
+  *
+  * Исходный код kernel'я генерируется по выражению, компилируется с -D TYPE=<тип элемента> -D WIDTH=<ширина>
+  * и кэшируется по сигнатуре выражения (в памяти процесса и в кэше скомпилированных программ).
+  * Вектор делится на порции по WIDTH соседних элементов, которые обрабатываются векторными типами openCL
+  * (floatN, charN, ...), хвост вектора - поэлементно. Work-item проходит порции с шагом в размер NDRange
+  * (grid-stride), размеры запуска выбирает chooseLaunchGeometry.
+  * Буферы векторов (в том числе временных результатов выражений) могут браться из пула BufferPool.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include "buffer_pool.hpp"
+#include "trace.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*!
+ * \brief HalfFloat Число половинной точности на хосте (только хранение, арифметика через float)
+ */
+struct HalfFloat {
+    cl_half bits = 0;
+
+    HalfFloat() = default;
+    explicit HalfFloat(float value);
+    explicit operator float() const;
+};
+
+/*!
+ * \brief OpenclType Описание типа элемента для openCL C
+ *
+ * name - имя типа в openCL C, extension - расширение, без которого тип не поддерживается (nullptr - не нужно),
+ * scalar_type - тип скаляров в выражениях на хосте.
+ */
+template <typename T> struct OpenclType;
+template <> struct OpenclType<cl_char> {
+    static constexpr const char* name = "char";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_char;
+};
+template <> struct OpenclType<cl_int> {
+    static constexpr const char* name = "int";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_int;
+};
+template <> struct OpenclType<cl_uint> {
+    static constexpr const char* name = "uint";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_uint;
+};
+template <> struct OpenclType<cl_long> {
+    static constexpr const char* name = "long";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_long;
+};
+template <> struct OpenclType<cl_ulong> {
+    static constexpr const char* name = "ulong";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_ulong;
+};
+template <> struct OpenclType<cl_float> {
+    static constexpr const char* name = "float";
+    static constexpr const char* extension = nullptr;
+    using scalar_type = cl_float;
+};
+/*!
+ * Без cl_khr_fp64 double не поддерживается
+ */
+template <> struct OpenclType<cl_double> {
+    static constexpr const char* name = "double";
+    static constexpr const char* extension = "cl_khr_fp64";
+    using scalar_type = cl_double;
+};
+/*!
+ * Без cl_khr_fp16 half используется только для хранения: загрузка через vload_half, вычисления во float.
+ * Скаляры всегда передаются как float.
+ */
+template <> struct OpenclType<HalfFloat> {
+    static constexpr const char* name = "half";
+    static constexpr const char* extension = "cl_khr_fp16";
+    using scalar_type = cl_float;
+};
+
+/*!
+ * \brief deviceHasExtension Проверяет наличие расширения в CL_DEVICE_EXTENSIONS
+ */
+bool deviceHasExtension(const cl::Device& device, const char* extension);
+
+/*!
+ * \brief deviceSupportsType Можно ли использовать DeviceVector<T> на устройстве
+ *
+ * half поддерживается всегда (хотя бы для хранения), double - только с cl_khr_fp64.
+ */
+template <typename T>
+bool deviceSupportsType(const cl::Device& device) {
+    if constexpr (std::is_same<T, cl_double>::value) {
+        return deviceHasExtension(device, OpenclType<T>::extension);
+    }
+    return true;
+}
+
+/*!
+ * \brief FusionStats Статистика кэша слитых kernel'ей
+ */
+struct FusionStats {
+    size_t compiled = 0;    //< создано kernel'ей (разных сигнатур)
+    size_t reused = 0;      //< запусков с kernel'ем из кэша
+};
+
+FusionStats fusionStats();
+
+/*!
+ * \brief enqueueFused Запускает kernel `result[i] = expression` для i < count
+ *
+ * \param [in] queue Очередь выполнения
+ * \param [in] type Имя типа элемента (подставляется через -D TYPE=)
+ * \param [in] extension Расширение, необходимое для вычислений в этом типе (nullptr - не нужно)
+ * \param [in] width Количество соседних элементов, обрабатываемых вместе (1, 2, 4, 8 или 16)
+ * \param [in] params Параметры kernel'я после количества элементов, каждый начинается с ", "
+ * \param [in] expression Выражение от параметров; элементы векторов читаются через AT(v)
+ * \param [in] count Количество элементов
+ * \param [in] bind Устанавливает аргументы kernel'я начиная с 1 (0 - count), последний - буфер результата
+ * \param [in] events События, которых нужно дождаться перед запуском
+ * \return Событие завершения kernel'я
+ * \throws std::runtime_error Если тип не поддерживается устройством
+ */
+cl::Event enqueueFused(cl::CommandQueue& queue, const char* type, const char* extension, int width,
+                       const std::string& params, const std::string& expression, size_t count,
+                       const std::function<void(cl::Kernel&)>& bind,
+                       const std::vector<cl::Event>* events = nullptr);
+
+/*!
+ * \brief prepareFused Компилирует kernel выражения заранее, не запуская его
+ *
+ * Первый enqueueFused с новой сигнатурой компилирует программу синхронно. Если запуск ставится из места,
+ * где хост не должен блокироваться (например, в TaskGraph), kernel нужно подготовить до этого.
+ * Параметры - как у enqueueFused.
+ * \throws std::runtime_error Если тип не поддерживается устройством
+ */
+void prepareFused(const cl::Context& context, const cl::Device& device, const char* type, const char* extension,
+                  int width, const std::string& params, const std::string& expression);
+
+/*!
+ * \brief DeviceExpr Базовый класс узлов выражения (CRTP)
+ */
+template <typename Derived>
+struct DeviceExpr {
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+/*!
+ * \brief DeviceStorage Буфер вектора вместе с контекстом и очередью, не зависящий от ширины обработки
+ *
+ * Если задан пул, буфер берется из него и возвращается, когда уничтожается последняя копия вектора,
+ * вместе с маркером очереди вектора и событиями kernel'ей, читавших вектор из других очередей:
+ * буфер выдается повторно только после всех этих команд.
+ */
+class DeviceStorage {
+public:
+    /*!
+     * \param [in] host Начальные данные (копируются блокирующей записью) или nullptr
+     * \param [in] pool Пул буферов контекста (может быть nullptr - тогда буфер создается заново), должен пережить вектор
+     */
+    DeviceStorage(const cl::Context& context, const cl::CommandQueue& queue, size_t size, size_t elementSize,
+                  const void* host = nullptr, BufferPool* pool = nullptr);
+
+    size_t size() const { return length; }
+    const cl::Buffer& buffer() const { return storage; }
+    const cl::Context& context() const { return bufferContext; }
+    cl::CommandQueue& queue() const { return commandQueue; }
+    BufferPool* pool() const { return bufferPool; }
+
+    /*!
+     * \brief markUsed Отмечает, что команда event очереди queue использует буфер
+     *
+     * Команды очереди вектора покрываются маркером, события других очередей хранятся до возврата буфера в пул.
+     */
+    void markUsed(const cl::CommandQueue& queue, const cl::Event& event) const;
+
+protected:
+    /*!
+     * \brief Lease Владение буфером из пула, общее для всех копий вектора
+     */
+    struct Lease {
+        BufferPool* pool;
+        cl::Buffer buffer;
+        cl::CommandQueue queue;
+        std::mutex mutex;
+        std::vector<cl::Event> uses;    //< незавершенные команды других очередей
+
+        ~Lease();
+    };
+
+    cl::Context bufferContext;
+    mutable cl::CommandQueue commandQueue;
+    size_t length;
+    BufferPool* bufferPool;
+    cl::Buffer storage;
+    std::shared_ptr<Lease> lease;
+};
+
+/*!
+ * \brief ScalarExpr Скаляр в выражении, передается аргументом kernel'я
+ */
+template <typename T>
+class ScalarExpr : public DeviceExpr<ScalarExpr<T>> {
+public:
+    using value_type = T;
+    using scalar_type = typename OpenclType<T>::scalar_type;
+
+    explicit ScalarExpr(scalar_type value) : value { value } {}
+
+    void generate(std::string& expression, std::string& params, int& index) const {
+        const std::string name = "s" + std::to_string(index++);
+        params += ", const SCALAR " + name;
+        expression += "FROM_SCALAR(" + name + ")";
+    }
+    void bind(cl::Kernel& kernel, cl_uint& arg) const { kernel.setArg(arg++, value); }
+    void markUsed(const cl::CommandQueue&, const cl::Event&) const {}
+    //! Скаляр подходит к вектору любой длины
+    size_t size() const { return 0; }
+    const DeviceStorage* anchor() const { return nullptr; }
+
+private:
+    scalar_type value;
+};
+
+/*!
+ * \brief BinaryExpr Поэлементная бинарная операция
+ */
+template <char Op, typename L, typename R>
+class BinaryExpr : public DeviceExpr<BinaryExpr<Op, L, R>> {
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same<value_type, typename R::value_type>::value,
+                  "operands of a device expression must have the same element type");
+
+    BinaryExpr(const L& left, const R& right) : left { left }, right { right } {
+        if (left.size() != 0 && right.size() != 0 && left.size() != right.size()) {
+            throw std::invalid_argument { "device vector sizes do not match" };
+        }
+    }
+
+    void generate(std::string& expression, std::string& params, int& index) const {
+        expression += '(';
+        left.generate(expression, params, index);
+        expression += ' ';
+        expression += Op;
+        expression += ' ';
+        right.generate(expression, params, index);
+        expression += ')';
+    }
+    void bind(cl::Kernel& kernel, cl_uint& arg) const {
+        left.bind(kernel, arg);
+        right.bind(kernel, arg);
+    }
+    void markUsed(const cl::CommandQueue& queue, const cl::Event& event) const {
+        left.markUsed(queue, event);
+        right.markUsed(queue, event);
+    }
+    size_t size() const { return left.size() != 0 ? left.size() : right.size(); }
+    const DeviceStorage* anchor() const { return left.anchor() != nullptr ? left.anchor() : right.anchor(); }
+
+private:
+    // Узлы хранятся по значению: векторы копируются как ссылки на буферы, поэтому выражение
+    // остается корректным, даже если построено из временных объектов
+    L left;
+    R right;
+};
+
+/*!
+ * \brief DeviceVector Вектор в памяти устройства
+ *
+ * \tparam T Тип элемента: cl_char, cl_int, cl_uint, cl_long, cl_ulong, cl_float, cl_double или HalfFloat
+ * \tparam Width Количество соседних элементов, обрабатываемых вместе при вычислении выражения в этот вектор
+ *
+ * Копирование DeviceVector копирует ссылку на буфер, а не данные.
+ * Вычисление выражения ставится в очередь вектора, данные читаются блокирующим read().
+ * В выражении можно смешивать векторы с разной Width, ширину kernel'я определяет вектор результата.
+ */
+template <typename T, int Width = 1>
+class DeviceVector : public DeviceExpr<DeviceVector<T, Width>>, public DeviceStorage {
+public:
+    static_assert(Width == 1 || Width == 2 || Width == 4 || Width == 8 || Width == 16,
+                  "vector width must be 1, 2, 4, 8 or 16");
+    using value_type = T;
+
+    DeviceVector(const cl::Context& context, const cl::CommandQueue& queue, size_t size, BufferPool* pool = nullptr)
+        : DeviceStorage { context, queue, size, sizeof(T), nullptr, pool } {
+    }
+
+    DeviceVector(const cl::Context& context, const cl::CommandQueue& queue, const std::vector<T>& host,
+                 BufferPool* pool = nullptr)
+        : DeviceStorage { context, queue, host.size(), sizeof(T), host.data(), pool } {
+    }
+
+    /*!
+     * \brief DeviceVector Вычисляет выражение в новый вектор в контексте, очереди и пуле первого вектора выражения
+     */
+    template <typename E>
+    DeviceVector(const DeviceExpr<E>& expr)
+        : DeviceStorage { expr.self().anchor()->context(), expr.self().anchor()->queue(), expr.self().size(), sizeof(T),
+                          nullptr, expr.self().anchor()->pool() } {
+        assign(expr.self());
+    }
+
+    /*!
+     * \brief operator= Вычисляет выражение в этот вектор (вектор может входить в выражение)
+     */
+    template <typename E>
+    DeviceVector& operator=(const DeviceExpr<E>& expr) {
+        if (expr.self().size() != length) {
+            throw std::invalid_argument { "device vector sizes do not match" };
+        }
+        assign(expr.self());
+        return *this;
+    }
+
+    DeviceVector(const DeviceVector&) = default;
+    DeviceVector& operator=(const DeviceVector&) = default;
+
+    void read(T* host) const {
+        cl::Event event;
+        commandQueue.enqueueReadBuffer(storage, CL_TRUE, 0, sizeof(T) * length, host, nullptr, &event);
+        traceCommand(event);
+    }
+
+    std::vector<T> read() const {
+        std::vector<T> host ( length );
+        read(host.data());
+        return host;
+    }
+
+    void generate(std::string& expression, std::string& params, int& index) const {
+        const std::string name = "v" + std::to_string(index++);
+        params += ", const global TYPE* " + name;
+        expression += "AT(" + name + ")";
+    }
+    void bind(cl::Kernel& kernel, cl_uint& arg) const { kernel.setArg(arg++, storage); }
+    const DeviceStorage* anchor() const { return this; }
+
+private:
+    template <typename E>
+    void assign(const E& expr) {
+        std::string expression, params;
+        int index = 0;
+        expr.generate(expression, params, index);
+        const cl::Event event = enqueueFused(commandQueue, OpenclType<T>::name, OpenclType<T>::extension, Width,
+                                             params, expression, length, [&](cl::Kernel& kernel) {
+            cl_uint arg = 1;
+            expr.bind(kernel, arg);
+            kernel.setArg(arg, storage);
+        });
+        // Операнды из других очередей не должны вернуться в пул, пока kernel их читает
+        expr.markUsed(commandQueue, event);
+    }
+};
+
+#define DEVICE_EXPR_OPERATOR(op, symbol) \
+    template <typename L, typename R> \
+    BinaryExpr<symbol, L, R> operator op(const DeviceExpr<L>& left, const DeviceExpr<R>& right) { \
+        return { left.self(), right.self() }; \
+    } \
+    template <typename L> \
+    BinaryExpr<symbol, L, ScalarExpr<typename L::value_type>> \
+    operator op(const DeviceExpr<L>& left, typename OpenclType<typename L::value_type>::scalar_type right) { \
+        return { left.self(), ScalarExpr<typename L::value_type> { right } }; \
+    } \
+    template <typename R> \
+    BinaryExpr<symbol, ScalarExpr<typename R::value_type>, R> \
+    operator op(typename OpenclType<typename R::value_type>::scalar_type left, const DeviceExpr<R>& right) { \
+        return { ScalarExpr<typename R::value_type> { left }, right.self() }; \
+    }
+
+DEVICE_EXPR_OPERATOR(+, '+')
+DEVICE_EXPR_OPERATOR(-, '-')
+DEVICE_EXPR_OPERATOR(*, '*')
+DEVICE_EXPR_OPERATOR(/, '/')
+
+#undef DEVICE_EXPR_OPERATOR
+
+/*!
+ * @}
+ */
@@ -0,0 +1,513 @@
+/*!
+  * \addtogroup gemm
+  * @{
+  */
+
+#include "gemm.hpp"
+#include "program_cache.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view kernelMultiplySrc { R"CLC(
+// -D TSM= -D TSN= -D TSK= -D WPTM= -D WPTN= -D WIDTH=
+#define RTSM (TSM / WPTM)
+#define RTSN (TSN / WPTN)
+#define THREADS (RTSM * RTSN)
+#define LPTA ((TSK * TSM) / THREADS)
+#define LPTB ((TSK * TSN) / THREADS)
+
+// Накопление блока C в регистрах: work-item (tidm, tidn) отвечает за строки tidm + wm * RTSM
+// и столбцы tidn + wn * RTSN блока, поэтому соседние work-item'ы обращаются к соседним элементам
+// Каждый элемент C суммируется по k в порядке возрастания через fma при любых размерах блоков,
+// поэтому результат не зависит ни от конфигурации, ни от устройства (дополнение нулями его не меняет)
+#define MULTIPLY_TILE()                                                     \
+    for (int k = 0; k < TSK; ++k) {                                         \
+        float Breg[WPTN];                                                   \
+        for (int wn = 0; wn < WPTN; ++wn) {                                 \
+            Breg[wn] = Bsub[tidn + wn * RTSN][k];                           \
+        }                                                                   \
+        for (int wm = 0; wm < WPTM; ++wm) {                                 \
+            const float Areg = Asub[k][tidm + wm * RTSM];                   \
+            for (int wn = 0; wn < WPTN; ++wn) {                             \
+                acc[wm][wn] = fma(Areg, Breg[wn], acc[wm][wn]);             \
+            }                                                               \
+        }                                                                   \
+    }
+
+kernel void matrixMultiply(const int M, const int N, const int K,
+                    const global float* A,
+                    const global float* B,
+                    global float* C) {
+    const int tidm = get_local_id(0);
+    const int tidn = get_local_id(1);
+    const int tid = tidn * RTSM + tidm;
+    const int offsetM = TSM * get_group_id(0);
+    const int offsetN = TSN * get_group_id(1);
+    local float Asub[TSK][TSM];
+    local float Bsub[TSN][TSK + 2];     // +2: сдвиг строк против конфликтов банков
+
+    float acc[WPTM][WPTN];
+    for (int wm = 0; wm < WPTM; ++wm) {
+        for (int wn = 0; wn < WPTN; ++wn) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    const int numTiles = (K + TSK - 1) / TSK;
+    for (int t = 0; t < numTiles; ++t) {
+        for (int l = 0; l < LPTA; ++l) {
+            const int id = l * THREADS + tid;
+            const int row = id % TSM;
+            const int col = id / TSM;
+            const int globalRow = offsetM + row;
+            const int tiledCol = TSK * t + col;
+            Asub[col][row] = (globalRow < M && tiledCol < K) ? A[tiledCol * M + globalRow] : 0.0f;
+        }
+        for (int l = 0; l < LPTB; ++l) {
+            const int id = l * THREADS + tid;
+            const int row = id % TSK;
+            const int col = id / TSK;
+            const int tiledRow = TSK * t + row;
+            const int globalCol = offsetN + col;
+            Bsub[col][row] = (tiledRow < K && globalCol < N) ? B[globalCol * K + tiledRow] : 0.0f;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        MULTIPLY_TILE()
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    for (int wm = 0; wm < WPTM; ++wm) {
+        const int globalRow = offsetM + tidm + wm * RTSM;
+        for (int wn = 0; wn < WPTN; ++wn) {
+            const int globalCol = offsetN + tidn + wn * RTSN;
+            if (globalRow < M && globalCol < N) {
+                C[globalCol * M + globalRow] = acc[wm][wn];
+            }
+        }
+    }
+}
+
+#if WIDTH > 1
+#define CAT_(a, b) a ## b
+#define CAT(a, b) CAT_(a, b)
+#define floatX CAT(float, WIDTH)
+#define vloadX CAT(vload, WIDTH)
+#define vstoreX CAT(vstore, WIDTH)
+
+// Требует M % TSM == 0, N % TSN == 0, K % TSK == 0 - проверки границ не выполняются
+kernel void matrixMultiplyVec(const int M, const int N, const int K,
+                    const global float* A,
+                    const global float* B,
+                    global float* C) {
+    const int tidm = get_local_id(0);
+    const int tidn = get_local_id(1);
+    const int tid = tidn * RTSM + tidm;
+    const int offsetM = TSM * get_group_id(0);
+    const int offsetN = TSN * get_group_id(1);
+    local float Asub[TSK][TSM];
+    local float Bsub[TSN][TSK + 2];
+
+    float acc[WPTM][WPTN];
+    for (int wm = 0; wm < WPTM; ++wm) {
+        for (int wn = 0; wn < WPTN; ++wn) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    const int numTiles = K / TSK;
+    for (int t = 0; t < numTiles; ++t) {
+        // A загружается векторами вдоль M (столбцы A непрерывны), B - вдоль K
+        for (int l = 0; l < LPTA / WIDTH; ++l) {
+            const int id = l * THREADS + tid;
+            const int row = id % (TSM / WIDTH);
+            const int col = id / (TSM / WIDTH);
+            const floatX v = vloadX(((TSK * t + col) * M + offsetM) / WIDTH + row, A);
+            vstoreX(v, 0, &Asub[col][row * WIDTH]);
+        }
+        for (int l = 0; l < LPTB / WIDTH; ++l) {
+            const int id = l * THREADS + tid;
+            const int row = id % (TSK / WIDTH);
+            const int col = id / (TSK / WIDTH);
+            const floatX v = vloadX(((offsetN + col) * K + TSK * t) / WIDTH + row, B);
+            vstoreX(v, 0, &Bsub[col][row * WIDTH]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        MULTIPLY_TILE()
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    for (int wm = 0; wm < WPTM; ++wm) {
+        const int globalRow = offsetM + tidm + wm * RTSM;
+        for (int wn = 0; wn < WPTN; ++wn) {
+            const int globalCol = offsetN + tidn + wn * RTSN;
+            C[globalCol * M + globalRow] = acc[wm][wn];
+        }
+    }
+}
+#endif
+
+// Копирует матрицу rows x cols в матрицу paddedRows x paddedCols, дополняя нулями
+kernel void padMatrix(const int rows, const int cols, const int paddedRows, const int paddedCols,
+                    const global float* src,
+                    global float* dst) {
+    const int row = get_global_id(0);
+    const int col = get_global_id(1);
+    if (row < paddedRows && col < paddedCols) {
+        dst[col * paddedRows + row] = (row < rows && col < cols) ? src[col * rows + row] : 0.0f;
+    }
+}
+
+// Обратная операция: извлекает левый верхний блок rows x cols
+kernel void unpadMatrix(const int rows, const int cols, const int paddedRows, const int paddedCols,
+                    const global float* src,
+                    global float* dst) {
+    const int row = get_global_id(0);
+    const int col = get_global_id(1);
+    if (row < rows && col < cols) {
+        dst[col * rows + row] = src[col * paddedRows + row];
+    }
+}
+
+// Специализации по транспонированию: -D TRANS_A=1 и/или -D TRANS_B=1
+#ifndef TRANS_A
+#define TRANS_A 0
+#endif
+#ifndef TRANS_B
+#define TRANS_B 0
+#endif
+
+// Элементы op(A) (M x K) и op(B) (K x N) в матрицах по столбцам с шагами lda и ldb
+#if TRANS_A
+#define LOAD_A(m, k) A[(m) * lda + (k)]
+#else
+#define LOAD_A(m, k) A[(k) * lda + (m)]
+#endif
+#if TRANS_B
+#define LOAD_B(k, n) B[(k) * ldb + (n)]
+#else
+#define LOAD_B(k, n) B[(n) * ldb + (k)]
+#endif
+
+// C = alpha * op(A) * op(B) + beta * C для матриц по столбцам с произвольными шагами, любые размеры.
+// При beta == 0 матрица C не читается
+kernel void matrixMultiplyStrided(const int M, const int N, const int K, const float alpha,
+                    const global float* A, const int lda,
+                    const global float* B, const int ldb,
+                    const float beta, global float* C, const int ldc) {
+    const int tidm = get_local_id(0);
+    const int tidn = get_local_id(1);
+    const int tid = tidn * RTSM + tidm;
+    const int offsetM = TSM * get_group_id(0);
+    const int offsetN = TSN * get_group_id(1);
+    local float Asub[TSK][TSM];
+    local float Bsub[TSN][TSK + 2];
+
+    float acc[WPTM][WPTN];
+    for (int wm = 0; wm < WPTM; ++wm) {
+        for (int wn = 0; wn < WPTN; ++wn) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    const int numTiles = (K + TSK - 1) / TSK;
+    for (int t = 0; t < numTiles; ++t) {
+        // Соседние work-item'ы читают соседние элементы памяти: вдоль M или вдоль K в зависимости от op(A)
+        for (int l = 0; l < LPTA; ++l) {
+            const int id = l * THREADS + tid;
+#if TRANS_A
+            const int row = id / TSK;
+            const int col = id % TSK;
+#else
+            const int row = id % TSM;
+            const int col = id / TSM;
+#endif
+            const int globalRow = offsetM + row;
+            const int tiledCol = TSK * t + col;
+            Asub[col][row] = (globalRow < M && tiledCol < K) ? LOAD_A(globalRow, tiledCol) : 0.0f;
+        }
+        for (int l = 0; l < LPTB; ++l) {
+            const int id = l * THREADS + tid;
+#if TRANS_B
+            const int row = id / TSN;
+            const int col = id % TSN;
+#else
+            const int row = id % TSK;
+            const int col = id / TSK;
+#endif
+            const int tiledRow = TSK * t + row;
+            const int globalCol = offsetN + col;
+            Bsub[col][row] = (tiledRow < K && globalCol < N) ? LOAD_B(tiledRow, globalCol) : 0.0f;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        MULTIPLY_TILE()
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    for (int wm = 0; wm < WPTM; ++wm) {
+        const int globalRow = offsetM + tidm + wm * RTSM;
+        for (int wn = 0; wn < WPTN; ++wn) {
+            const int globalCol = offsetN + tidn + wn * RTSN;
+            if (globalRow < M && globalCol < N) {
+                const int index = globalCol * ldc + globalRow;
+                C[index] = beta == 0.0f ? alpha * acc[wm][wn] : alpha * acc[wm][wn] + beta * C[index];
+            }
+        }
+    }
+}
+)CLC"sv };
+
+// Наибольшая сторона work-group для kernel'ей дополнения
+constexpr int PAD_TS = 16;
+
+int roundUp(int value, int multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+/*!
+ * \brief checkWorkGroup Проверяет, что kernel допускает work-group из size work-item'ов
+ *
+ * CL_KERNEL_WORK_GROUP_SIZE зависит от регистров и локальной памяти kernel'я и бывает меньше предела устройства
+ */
+void checkWorkGroup(const cl::Kernel& kernel, const cl::Device& device, size_t size) {
+    if (size > kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device)) {
+        throw std::invalid_argument { "GEMM work-group size exceeds kernel limit of " +
+                                      kernel.getInfo<CL_KERNEL_FUNCTION_NAME>() };
+    }
+}
+
+} // namespace
+
+std::string GemmConfig::buildOptions() const {
+    std::ostringstream ss;
+    ss << "-D TSM=" << tileM << " -D TSN=" << tileN << " -D TSK=" << tileK
+       << " -D WPTM=" << wptM << " -D WPTN=" << wptN << " -D WIDTH=" << width;
+    return ss.str();
+}
+
+std::string GemmConfig::validate() const {
+    if (tileM <= 0 || tileN <= 0 || tileK <= 0 || wptM <= 0 || wptN <= 0) {
+        return "tile sizes and work per thread must be positive";
+    }
+    if (tileM % wptM != 0 || tileN % wptN != 0) {
+        return "tile size must be a multiple of work per thread";
+    }
+    const int threads = workGroupSize();
+    if ((tileK * tileM) % threads != 0 || (tileK * tileN) % threads != 0) {
+        return "tile loads must split evenly between work-items";
+    }
+    if (width != 1 && width != 2 && width != 4 && width != 8 && width != 16) {
+        return "vector width must be 1, 2, 4, 8 or 16";
+    }
+    if (width > 1) {
+        if (tileM % width != 0 || tileK % width != 0) {
+            return "tileM and tileK must be multiples of vector width";
+        }
+        if ((tileK * tileM) % (threads * width) != 0 || (tileK * tileN) % (threads * width) != 0) {
+            return "vector tile loads must split evenly between work-items";
+        }
+    }
+    return {};
+}
+
+size_t GemmConfig::localMemSize() const {
+    return sizeof(float) * (static_cast<size_t>(tileK) * tileM + static_cast<size_t>(tileN) * (tileK + 2));
+}
+
+Gemm::Gemm(const cl::Context& context, const cl::Device& device, const GemmConfig& config, BufferPool* pool)
+    : params { config }, context { context }, device { device }, pool { pool }, padTile { PAD_TS } {
+    const std::string error = params.validate();
+    if (!error.empty()) {
+        throw std::invalid_argument { "invalid GEMM config: " + error };
+    }
+    if (static_cast<size_t>(params.workGroupSize()) > device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()) {
+        throw std::invalid_argument { "GEMM work-group size exceeds device limit" };
+    }
+    if (params.localMemSize() > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>()) {
+        throw std::invalid_argument { "GEMM tiles exceed device local memory" };
+    }
+
+    program = buildProgramCached(context, device, std::string { kernelMultiplySrc }, params.buildOptions());
+    multiply = cl::Kernel { program, "matrixMultiply" };
+    if (params.width > 1) {
+        multiplyVec = cl::Kernel { program, "matrixMultiplyVec" };
+    }
+    pad = cl::Kernel { program, "padMatrix" };
+    unpad = cl::Kernel { program, "unpadMatrix" };
+    strided[0] = cl::Kernel { program, "matrixMultiplyStrided" };
+
+    // Неподходящая конфигурация отбрасывается здесь, а не ошибкой CL_INVALID_WORK_GROUP_SIZE при запуске
+    const size_t groupSize = static_cast<size_t>(params.workGroupSize());
+    checkWorkGroup(multiply, device, groupSize);
+    if (params.width > 1) {
+        checkWorkGroup(multiplyVec, device, groupSize);
+    }
+    checkWorkGroup(strided[0], device, groupSize);
+    const size_t padLimit = std::min(pad.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device),
+                                     unpad.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+    while (padTile > 1 && static_cast<size_t>(padTile) * padTile > padLimit) {
+        padTile /= 2;
+    }
+}
+
+cl::Event Gemm::enqueue(cl::CommandQueue& queue, int M, int N, int K,
+                        const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                        const std::vector<cl::Event>* events) {
+    if (M <= 0 || N <= 0 || K <= 0) {
+        throw std::invalid_argument { "GEMM dimensions must be positive" };
+    }
+    const bool aligned = M % params.tileM == 0 && N % params.tileN == 0 && K % params.tileK == 0;
+    if (params.width == 1) {
+        return enqueueTiled(queue, false, M, N, K, a, b, c, events);
+    }
+    if (aligned) {
+        return enqueueTiled(queue, true, M, N, K, a, b, c, events);
+    }
+    // Дополнение оправдано, если лишняя работа по нулям не больше исходной
+    const double padded = static_cast<double>(roundUp(M, params.tileM))
+            * roundUp(N, params.tileN) * roundUp(K, params.tileK);
+    if (params.padding && padded <= 2.0 * M * N * K) {
+        return enqueuePadded(queue, M, N, K, a, b, c, events);
+    }
+    return enqueueTiled(queue, false, M, N, K, a, b, c, events);
+}
+
+cl::Event Gemm::enqueueSgemm(cl::CommandQueue& queue, GemmLayout layout, GemmOp opA, GemmOp opB,
+                             int M, int N, int K, float alpha,
+                             const cl::Buffer& a, int lda, const cl::Buffer& b, int ldb,
+                             float beta, const cl::Buffer& c, int ldc,
+                             const std::vector<cl::Event>* events) {
+    if (layout == GemmLayout::RowMajor) {
+        // Матрица по строкам с шагом ld - это транспонированная матрица по столбцам с тем же шагом:
+        // C^T = op(B)^T * op(A)^T, поэтому достаточно поменять местами A и B, M и N
+        return enqueueSgemm(queue, GemmLayout::ColumnMajor, opB, opA, N, M, K, alpha, b, ldb, a, lda,
+                            beta, c, ldc, events);
+    }
+    if (M <= 0 || N <= 0 || K <= 0) {
+        throw std::invalid_argument { "GEMM dimensions must be positive" };
+    }
+    if (lda < (opA == GemmOp::NoTrans ? M : K) || ldb < (opB == GemmOp::NoTrans ? K : N) || ldc < M) {
+        throw std::invalid_argument { "GEMM leading dimension is too small" };
+    }
+    // Плотные матрицы без транспонирования и масштабирования - векторный kernel с дополнением
+    if (opA == GemmOp::NoTrans && opB == GemmOp::NoTrans && alpha == 1.0f && beta == 0.0f &&
+        lda == M && ldb == K && ldc == M) {
+        return enqueue(queue, M, N, K, a, b, c, events);
+    }
+
+    const int index = (opA == GemmOp::Trans ? 2 : 0) + (opB == GemmOp::Trans ? 1 : 0);
+    if (strided[index]() == nullptr) {
+        const std::string options = params.buildOptions() + " -D TRANS_A=" + std::to_string(index / 2) +
+                " -D TRANS_B=" + std::to_string(index % 2);
+        cl::Kernel built { buildProgramCached(context, device, std::string { kernelMultiplySrc }, options),
+                           "matrixMultiplyStrided" };
+        checkWorkGroup(built, device, static_cast<size_t>(params.workGroupSize()));
+        strided[index] = built;
+    }
+    cl::Kernel& kernel = strided[index];
+    kernel.setArg(0, M);
+    kernel.setArg(1, N);
+    kernel.setArg(2, K);
+    kernel.setArg(3, alpha);
+    kernel.setArg(4, a);
+    kernel.setArg(5, lda);
+    kernel.setArg(6, b);
+    kernel.setArg(7, ldb);
+    kernel.setArg(8, beta);
+    kernel.setArg(9, c);
+    kernel.setArg(10, ldc);
+
+    cl::Event event;
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange (roundUp(M, params.tileM) / params.wptM,
+                                            roundUp(N, params.tileN) / params.wptN),
+                               cl::NDRange (params.tileM / params.wptM, params.tileN / params.wptN),
+                               events, &event);
+    traceCommand(event, "matrixMultiplyStrided");
+    return event;
+}
+
+cl::Event Gemm::enqueueTiled(cl::CommandQueue& queue, bool vectorized, int M, int N, int K,
+                             const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                             const std::vector<cl::Event>* events) {
+    cl::Kernel& kernel = vectorized ? multiplyVec : multiply;
+    kernel.setArg(0, M);
+    kernel.setArg(1, N);
+    kernel.setArg(2, K);
+    kernel.setArg(3, a);
+    kernel.setArg(4, b);
+    kernel.setArg(5, c);
+
+    const int rtsm = params.tileM / params.wptM;
+    const int rtsn = params.tileN / params.wptN;
+    cl::Event event;
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange (roundUp(M, params.tileM) / params.wptM,
+                                            roundUp(N, params.tileN) / params.wptN),
+                               cl::NDRange (rtsm, rtsn),
+                               events, &event);
+    traceCommand(event, vectorized ? "matrixMultiplyVec" : "matrixMultiply");
+    return event;
+}
+
+cl::Event Gemm::enqueuePadded(cl::CommandQueue& queue, int M, int N, int K,
+                              const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                              const std::vector<cl::Event>* events) {
+    const int paddedM = roundUp(M, params.tileM);
+    const int paddedN = roundUp(N, params.tileN);
+    const int paddedK = roundUp(K, params.tileK);
+
+    // Временные буферы можно освобождать сразу: openCL удерживает их до завершения команд,
+    // а пул выдает их повторно только после завершения событий
+    auto temporary = [&](size_t elements) {
+        return pool != nullptr ? pool->acquire(sizeof(float) * elements)
+                               : cl::Buffer { context, CL_MEM_READ_WRITE, sizeof(float) * elements };
+    };
+    cl::Buffer paddedA = temporary(static_cast<size_t>(paddedM) * paddedK);
+    cl::Buffer paddedB = temporary(static_cast<size_t>(paddedK) * paddedN);
+    cl::Buffer paddedC = temporary(static_cast<size_t>(paddedM) * paddedN);
+
+    auto copy = [&](cl::Kernel& kernel, int rows, int cols, int paddedRows, int paddedCols,
+                    const cl::Buffer& src, const cl::Buffer& dst,
+                    const std::vector<cl::Event>* wait) {
+        kernel.setArg(0, rows);
+        kernel.setArg(1, cols);
+        kernel.setArg(2, paddedRows);
+        kernel.setArg(3, paddedCols);
+        kernel.setArg(4, src);
+        kernel.setArg(5, dst);
+        cl::Event event;
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                   cl::NDRange (roundUp(paddedRows, padTile), roundUp(paddedCols, padTile)),
+                                   cl::NDRange (padTile, padTile),
+                                   wait, &event);
+        traceCommand(event, &kernel == &pad ? "padMatrix" : "unpadMatrix");
+        return event;
+    };
+
+    const std::vector<cl::Event> padded {
+        copy(pad, M, K, paddedM, paddedK, a, paddedA, events),
+        copy(pad, K, N, paddedK, paddedN, b, paddedB, events),
+    };
+    const std::vector<cl::Event> multiplied {
+        enqueueTiled(queue, true, paddedM, paddedN, paddedK, paddedA, paddedB, paddedC, &padded)
+    };
+    cl::Event done = copy(unpad, M, N, paddedM, paddedN, paddedC, c, &multiplied);
+    if (pool != nullptr) {
+        pool->release(paddedA, multiplied);
+        pool->release(paddedB, multiplied);
+        pool->release(paddedC, { done });
+    }
+    return done;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,156 @@
+/*!
+  * \defgroup gemm Умножение матриц на openCL устройстве
+  *
+  * Семейство kernel'ей умножения матриц с блочным разбиением в локальной памяти,
+  * регистровым блокированием (несколько элементов C на work-item) и векторной загрузкой данных.
+  * Все матрицы хранятся по столбцам (column-major): C (M x N) = A (M x K) * B (K x N).
+  * Интерфейс в стиле BLAS (enqueueSgemm) принимает также матрицы по строкам, транспонирование и шаги.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include "buffer_pool.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief GemmLayout Порядок хранения матриц
+ */
+enum class GemmLayout { ColumnMajor, RowMajor };
+
+/*!
+ * \brief GemmOp Операция над операндом: op(X) = X или X^T
+ */
+enum class GemmOp { NoTrans, Trans };
+
+/*!
+ * \brief GemmConfig Параметры kernel'я умножения матриц
+ *
+ * Work-group вычисляет блок C размером tileM x tileN, содержит (tileM / wptM) x (tileN / wptN) work-item'ов,
+ * каждый из которых накапливает в регистрах wptM x wptN элементов. По K данные проходят через локальную память
+ * порциями по tileK. width - ширина векторной загрузки (1 - скалярная загрузка с проверкой границ).
+ */
+struct GemmConfig {
+    int tileM = 64;
+    int tileN = 64;
+    int tileK = 16;
+    int wptM = 4;
+    int wptN = 4;
+    int width = 4;
+    /*!
+     * Дополнять матрицы нулями до кратности блокам, чтобы использовать векторный kernel.
+     * Применяется, только если дополненный объем вычислений не больше чем в 2 раза превышает исходный.
+     */
+    bool padding = true;
+
+    /*!
+     * \brief buildOptions Строка -D определений для компиляции kernel'ей
+     */
+    std::string buildOptions() const;
+
+    /*!
+     * \brief validate Проверяет согласованность параметров
+     * \return Пустая строка, если конфигурация корректна, иначе описание ошибки
+     */
+    std::string validate() const;
+
+    /*!
+     * \brief workGroupSize Количество work-item'ов в work-group
+     */
+    int workGroupSize() const { return (tileM / wptM) * (tileN / wptN); }
+
+    /*!
+     * \brief localMemSize Объем локальной памяти, используемой kernel'ем, в байтах
+     */
+    size_t localMemSize() const;
+};
+
+/*!
+ * \brief Gemm Скомпилированное семейство kernel'ей умножения матриц для одного устройства
+ *
+ * Выбирает kernel в зависимости от размеров задачи:
+ *  - размеры кратны блокам: векторный kernel без проверок границ;
+ *  - размеры не кратны блокам и дополнение выгодно: дополнение нулями, векторный kernel, обратное копирование;
+ *  - иначе (например, "узкие" матрицы): kernel с проверкой границ.
+ *
+ * Объект не потокобезопасен: аргументы kernel'ей общие.
+ */
+class Gemm {
+public:
+    /*!
+     * \throws std::invalid_argument Если конфигурация некорректна или не подходит устройству и его kernel'ям
+     * \throws cl::Error Если программа не компилируется (лог компиляции выводится в std::cerr)
+     *
+     * Программа берется из кэша скомпилированных программ, если он доступен.
+     * \param [in] pool Пул для временных буферов дополнения (nullptr - буферы создаются при каждом вызове)
+     */
+    Gemm(const cl::Context& context, const cl::Device& device, const GemmConfig& config = GemmConfig {},
+         BufferPool* pool = nullptr);
+
+    /*!
+     * \brief enqueue Добавляет в очередь вычисление C = A * B
+     *
+     * \param [in] queue Очередь выполнения
+     * \param [in] M Количество строк A и C
+     * \param [in] N Количество столбцов B и C
+     * \param [in] K Количество столбцов A и строк B
+     * \param [in] a Буфер A (M x K, column-major)
+     * \param [in] b Буфер B (K x N, column-major)
+     * \param [out] c Буфер C (M x N, column-major)
+     * \param [in] events События, которых нужно дождаться перед запуском
+     * \return Событие завершения последней операции
+     */
+    cl::Event enqueue(cl::CommandQueue& queue, int M, int N, int K,
+                      const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                      const std::vector<cl::Event>* events = nullptr);
+
+    /*!
+     * \brief enqueueSgemm Добавляет в очередь вычисление C = alpha * op(A) * op(B) + beta * C (как cblas_sgemm)
+     *
+     * op(A) имеет размер M x K, op(B) - K x N. Транспонирование и шаги обрабатываются специализациями kernel'я,
+     * матрицы по строкам сводятся к матрицам по столбцам перестановкой операндов, без копирования.
+     * Плотные матрицы по столбцам с alpha = 1, beta = 0 умножаются через enqueue.
+     *
+     * \param [in] layout Порядок хранения всех трех матриц
+     * \param [in] lda Шаг между столбцами (ColumnMajor) или строками (RowMajor) хранимой матрицы A
+     * \param [in] beta Множитель C; при beta = 0 исходное содержимое C не читается
+     * \throws std::invalid_argument Если размеры не положительны или шаг меньше размера хранимой матрицы
+     */
+    cl::Event enqueueSgemm(cl::CommandQueue& queue, GemmLayout layout, GemmOp opA, GemmOp opB,
+                           int M, int N, int K, float alpha,
+                           const cl::Buffer& a, int lda, const cl::Buffer& b, int ldb,
+                           float beta, const cl::Buffer& c, int ldc,
+                           const std::vector<cl::Event>* events = nullptr);
+
+    const GemmConfig& config() const { return params; }
+
+private:
+    cl::Event enqueueTiled(cl::CommandQueue& queue, bool vectorized, int M, int N, int K,
+                           const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                           const std::vector<cl::Event>* events);
+    cl::Event enqueuePadded(cl::CommandQueue& queue, int M, int N, int K,
+                            const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c,
+                            const std::vector<cl::Event>* events);
+
+    GemmConfig params;
+    cl::Context context;
+    cl::Device device;
+    BufferPool* pool;
+    cl::Program program;
+    cl::Kernel multiply;            //< kernel с проверкой границ, любые размеры
+    cl::Kernel multiplyVec;         //< векторный kernel, размеры кратны блокам
+    cl::Kernel pad;
+    cl::Kernel unpad;
+    int padTile;                    //< сторона work-group kernel'ей дополнения
+    std::array<cl::Kernel, 4> strided;  //< kernel'и с шагами, индекс 2 * TRANS_A + TRANS_B
+};
+
+/*!
+ * @}
+ */
@@ -0,0 +1,234 @@
+/*!
+  * \addtogroup gemm_tuner
+  * @{
+  */
+
+#include "gemm_tuner.hpp"
+#include "cpu_gemm.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+int roundUpPow2(int value) {
+    int result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+std::string sanitize(std::string value) {
+    std::replace(value.begin(), value.end(), '\t', ' ');
+    std::replace(value.begin(), value.end(), '\n', ' ');
+    return value;
+}
+
+bool sameConfig(const GemmConfig& a, const GemmConfig& b) {
+    return a.tileM == b.tileM && a.tileN == b.tileN && a.tileK == b.tileK
+            && a.wptM == b.wptM && a.wptN == b.wptN && a.width == b.width && a.padding == b.padding;
+}
+
+} // namespace
+
+std::vector<GemmConfig> gemmCandidates(const cl::Device& device) {
+    const size_t maxGroup = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const std::vector<size_t> maxItems = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+    const size_t localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+    std::vector<GemmConfig> result;
+    for (int tileM : { 16, 32, 64, 128 }) {
+        for (int tileN : { 16, 32, 64, 128 }) {
+            for (int tileK : { 8, 16, 32 }) {
+                for (int wptM : { 1, 2, 4, 8 }) {
+                    for (int wptN : { 1, 2, 4, 8 }) {
+                        for (int width : { 1, 2, 4, 8 }) {
+                            GemmConfig config;
+                            config.tileM = tileM;
+                            config.tileN = tileN;
+                            config.tileK = tileK;
+                            config.wptM = wptM;
+                            config.wptN = wptN;
+                            config.width = width;
+                            // Слишком маленькие work-group и слишком большие регистровые блоки заведомо медленны
+                            if (!config.validate().empty() || wptM * wptN > 64 || config.workGroupSize() < 16) {
+                                continue;
+                            }
+                            if (static_cast<size_t>(config.workGroupSize()) > maxGroup
+                                    || static_cast<size_t>(tileM / wptM) > maxItems.at(0)
+                                    || static_cast<size_t>(tileN / wptN) > maxItems.at(1)
+                                    || config.localMemSize() > localMem) {
+                                continue;
+                            }
+                            result.push_back(config);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+GemmTuner::GemmTuner(std::string path) : path { std::move(path) } {
+    std::ifstream in { this->path };
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields { line };
+        std::string device, bucket, params, ms;
+        if (!std::getline(fields, device, '\t') || !std::getline(fields, bucket, '\t')
+                || !std::getline(fields, params, '\t') || !std::getline(fields, ms, '\t')) {
+            continue;
+        }
+        Entry entry;
+        std::istringstream values { params };
+        if (!(values >> entry.config.tileM >> entry.config.tileN >> entry.config.tileK
+                     >> entry.config.wptM >> entry.config.wptN >> entry.config.width >> entry.config.padding)) {
+            continue;
+        }
+        // Испорченные записи игнорируем - такая задача будет подобрана заново
+        if (!entry.config.validate().empty()) {
+            continue;
+        }
+        entry.ms = std::atof(ms.c_str());
+        entries[device + '\t' + bucket] = entry;
+    }
+}
+
+std::string GemmTuner::defaultPath() {
+    const char* path = std::getenv("GEMM_TUNING_DB");
+    return path != nullptr ? path : "gemm_tuning.db";
+}
+
+std::string GemmTuner::deviceKey(const cl::Device& device) {
+    return sanitize(device.getInfo<CL_DEVICE_NAME>() + " | " + device.getInfo<CL_DEVICE_VENDOR>()
+                    + " | " + device.getInfo<CL_DRIVER_VERSION>());
+}
+
+std::string GemmTuner::shapeBucket(int M, int N, int K) {
+    std::ostringstream ss;
+    ss << roundUpPow2(M) << 'x' << roundUpPow2(N) << 'x' << roundUpPow2(K);
+    return ss.str();
+}
+
+bool GemmTuner::find(const cl::Device& device, int M, int N, int K, GemmConfig& config) const {
+    auto it = entries.find(deviceKey(device) + '\t' + shapeBucket(M, N, K));
+    if (it == entries.end()) {
+        return false;
+    }
+    config = it->second.config;
+    return true;
+}
+
+GemmConfig GemmTuner::tune(const cl::Context& context, const cl::Device& device, int M, int N, int K,
+                           const GemmTuneOptions& options) {
+    std::vector<GemmConfig> candidates = gemmCandidates(device);
+    if (candidates.size() > options.maxCandidates) {
+        std::vector<GemmConfig> sampled;
+        for (size_t i = 0; i < options.maxCandidates; ++i) {
+            sampled.push_back(candidates[i * candidates.size() / options.maxCandidates]);
+        }
+        candidates.swap(sampled);
+    }
+    // Конфигурация по умолчанию всегда участвует, чтобы результат подбора был не хуже нее
+    const GemmConfig fallback;
+    if (std::none_of(candidates.begin(), candidates.end(),
+                     [&](const GemmConfig& c) { return sameConfig(c, fallback); })) {
+        candidates.insert(candidates.begin(), fallback);
+    }
+
+    // Значения кратны 1/4, поэтому любой порядок суммирования дает точный результат
+    std::vector<float> a ( static_cast<size_t>(M) * K );
+    std::vector<float> b ( static_cast<size_t>(K) * N );
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<float>(i % 7) * 0.25f;
+    }
+    for (size_t i = 0; i < b.size(); ++i) {
+        b[i] = static_cast<float>(i % 5) * 0.5f - 0.5f;
+    }
+    std::vector<float> reference;
+    multiplyMatrices(b, N, K, a, K, M, reference);
+    std::vector<float> c ( reference.size() );
+
+    cl::CommandQueue queue { context, device, CL_QUEUE_PROFILING_ENABLE };
+    cl::Buffer bufferA { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * a.size(), a.data() };
+    cl::Buffer bufferB { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * b.size(), b.data() };
+    cl::Buffer bufferC { context, CL_MEM_WRITE_ONLY, sizeof(float) * c.size() };
+
+    Entry best { fallback, std::numeric_limits<double>::infinity() };
+    for (const GemmConfig& config : candidates) {
+        double ms = std::numeric_limits<double>::infinity();
+        try {
+            Gemm gemm { context, device, config };
+            for (int i = 0; i < std::max(1, options.warmup); ++i) {
+                gemm.enqueue(queue, M, N, K, bufferA, bufferB, bufferC);
+            }
+            queue.enqueueReadBuffer(bufferC, CL_TRUE, 0, sizeof(float) * c.size(), c.data());
+            if (c != reference) {
+                if (options.log != nullptr) {
+                    *options.log << config.buildOptions() << ": wrong result, skipped" << std::endl;
+                }
+                continue;
+            }
+            for (int i = 0; i < options.repetitions; ++i) {
+                // Маркер отмечает начало: в режиме дополнения Gemm запускает несколько kernel'ей
+                cl::Event start;
+                queue.enqueueMarkerWithWaitList(nullptr, &start);
+                cl::Event done = gemm.enqueue(queue, M, N, K, bufferA, bufferB, bufferC);
+                done.wait();
+                const cl_ulong begin = start.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+                const cl_ulong end = done.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+                ms = std::min(ms, (end - begin) * 1e-6);
+            }
+        } catch (const std::invalid_argument&) {
+            continue;
+        } catch (const cl::Error& e) {
+            if (options.log != nullptr) {
+                *options.log << config.buildOptions() << ": " << e.what() << " (" << e.err() << "), skipped" << std::endl;
+            }
+            continue;
+        }
+        if (options.log != nullptr) {
+            *options.log << config.buildOptions() << ": " << ms << " ms" << std::endl;
+        }
+        if (ms < best.ms) {
+            best = Entry { config, ms };
+        }
+    }
+    if (best.ms == std::numeric_limits<double>::infinity()) {
+        throw std::runtime_error { "no working GEMM configuration for " + deviceKey(device) };
+    }
+    entries[deviceKey(device) + '\t' + shapeBucket(M, N, K)] = best;
+    return best.config;
+}
+
+void GemmTuner::save() const {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out { tmp, std::ios::trunc };
+        for (const auto& [key, entry] : entries) {
+            const GemmConfig& c = entry.config;
+            out << key << '\t'
+                << c.tileM << ' ' << c.tileN << ' ' << c.tileK << ' '
+                << c.wptM << ' ' << c.wptN << ' ' << c.width << ' ' << c.padding << '\t'
+                << entry.ms << '\n';
+        }
+        if (!out) {
+            throw std::runtime_error { "cannot write GEMM tuning database " + tmp };
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error { "cannot replace GEMM tuning database " + path };
+    }
+}
+
+/*!
+ * @}
+ */
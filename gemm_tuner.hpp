@@ -0,0 +1,90 @@
+/*!
+  * \defgroup gemm_tuner Автоподбор параметров умножения матриц
+  *
+  * Перебирает конфигурации GemmConfig (размеры блоков, работа на work-item, ширина векторов и,
+  * как следствие, размер work-group) для пары (устройство, класс размеров задачи), измеряет время
+  * через профилирование событий и сохраняет лучшую конфигурацию в файл. При следующих запусках
+  * конфигурация берется из файла без повторного подбора.
+  * @{
+  */
+
+#pragma once
+
+#include "gemm.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief GemmTuneOptions Параметры перебора
+ */
+struct GemmTuneOptions {
+    int warmup = 1;                 //< запусков до измерения (не меньше одного: по нему проверяется результат)
+    int repetitions = 3;            //< измеряемых запусков, берется минимальное время
+    size_t maxCandidates = 48;      //< ограничение на количество проверяемых конфигураций
+    std::ostream* log = nullptr;    //< куда выводить ход перебора
+};
+
+/*!
+ * \brief gemmCandidates Конфигурации, допустимые для устройства (размер work-group, локальная память)
+ */
+std::vector<GemmConfig> gemmCandidates(const cl::Device& device);
+
+/*!
+ * \brief GemmTuner База подобранных конфигураций
+ *
+ * Файл текстовый, одна запись на строку: устройство, класс размеров, параметры, время в мс (через табуляцию).
+ * Устройство идентифицируется именем, производителем и версией драйвера, поэтому обновление драйвера
+ * приводит к повторному подбору. Класс размеров - M, N, K, округленные вверх до степени двойки.
+ */
+class GemmTuner {
+public:
+    /*!
+     * \param [in] path Файл базы; если он существует, записи загружаются
+     */
+    explicit GemmTuner(std::string path);
+
+    /*!
+     * \brief defaultPath Путь из переменной окружения GEMM_TUNING_DB или "gemm_tuning.db"
+     */
+    static std::string defaultPath();
+
+    static std::string deviceKey(const cl::Device& device);
+    static std::string shapeBucket(int M, int N, int K);
+
+    /*!
+     * \brief find Ищет сохраненную конфигурацию
+     * \return true, если запись найдена
+     */
+    bool find(const cl::Device& device, int M, int N, int K, GemmConfig& config) const;
+
+    /*!
+     * \brief tune Подбирает конфигурацию для задачи M x N x K и запоминает ее (без записи в файл)
+     *
+     * Каждый кандидат проверяется на корректность результата; неподходящие устройству или
+     * некомпилирующиеся конфигурации пропускаются.
+     * \throws std::runtime_error Если ни одна конфигурация не работает
+     */
+    GemmConfig tune(const cl::Context& context, const cl::Device& device, int M, int N, int K,
+                    const GemmTuneOptions& options = GemmTuneOptions {});
+
+    /*!
+     * \brief save Записывает базу в файл (через временный файл, чтобы не оставить его поврежденным)
+     */
+    void save() const;
+
+private:
+    struct Entry {
+        GemmConfig config;
+        double ms;
+    };
+
+    std::string path;
+    std::map<std::string, Entry> entries;   //< ключ: устройство + '\t' + класс размеров
+};
+
+/*!
+ * @}
+ */
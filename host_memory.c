@@ -0,0 +1,40 @@
+/*!
+  * \addtogroup host_memory
+  * @{
+  */
+
+#include "host_memory.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+void* allocHostAligned(size_t bytes) {
+    static size_t pageSize = 0;
+    if (pageSize == 0) {
+        const long size = sysconf(_SC_PAGESIZE);
+        pageSize = size > 0 ? (size_t) size : 4096;
+    }
+    // Некоторые реализации используют память без копирования, только если и размер кратен 64 байтам
+    bytes = (bytes + 63) / 64 * 64;
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, pageSize, bytes > 0 ? bytes : 64) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void freeHostAligned(void* ptr) {
+    free(ptr);
+}
+
+int deviceHasUnifiedMemory(cl_device_id device) {
+    cl_bool unified = CL_FALSE;
+    if (clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified, NULL) != CL_SUCCESS) {
+        return 0;
+    }
+    return unified == CL_TRUE;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,42 @@
+/*!
+  * \defgroup host_memory Память хоста для работы без копирования
+  *
+  * Выделение памяти, выровненной по границе страницы. Такую память можно передать в буфер
+  * с флагом CL_MEM_USE_HOST_PTR, и на устройствах с общей с хостом памятью (CPU, встроенные GPU)
+  * kernel будет работать с ней напрямую, а результат читается через clEnqueueMapBuffer без копирования.
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief allocHostAligned Выделяет память, выровненную по странице; размер округляется вверх до 64 байт
+ * \return Указатель или NULL, если память не выделена. Освобождается через freeHostAligned
+ */
+void* allocHostAligned(size_t bytes);
+
+/*!
+ * \brief freeHostAligned Освобождает память, выделенную allocHostAligned
+ */
+void freeHostAligned(void* ptr);
+
+/*!
+ * \brief deviceHasUnifiedMemory Проверяет, что устройство работает с памятью хоста напрямую
+ *                               (CL_DEVICE_HOST_UNIFIED_MEMORY)
+ */
+int deviceHasUnifiedMemory(cl_device_id device);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
@@ -0,0 +1,51 @@
+/*!
+  * \addtogroup host_memory
+  * @{
+  */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "host_memory.h"
+
+/*!
+ * \brief PageAlignedAllocator Аллокатор для std::vector, выделяющий память через allocHostAligned
+ */
+template <typename T>
+struct PageAlignedAllocator {
+    using value_type = T;
+
+    PageAlignedAllocator() = default;
+    template <typename U>
+    PageAlignedAllocator(const PageAlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t count) {
+        void* ptr = allocHostAligned(count * sizeof(T));
+        if (ptr == nullptr) {
+            throw std::bad_alloc {};
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) {
+        freeHostAligned(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return false; }
+
+/*!
+ * \brief HostVector Вектор в памяти, пригодной для буферов с CL_MEM_USE_HOST_PTR
+ */
+template <typename T>
+using HostVector = std::vector<T, PageAlignedAllocator<T>>;
+
+/*!
+ * @}
+ */
@@ -0,0 +1,47 @@
+/*!
+  * \addtogroup launch_geometry
+  * @{
+  */
+
+#include "launch_geometry.h"
+
+cl_int chooseLaunchGeometry(cl_device_id device, cl_kernel kernel, size_t count, LaunchGeometry* geometry) {
+    cl_uint units = 0;
+    size_t kernelLimit = 0, multiple = 0;
+    cl_int err = clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, NULL);
+    if (err == CL_SUCCESS) {
+        err = clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelLimit),
+                                       &kernelLimit, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                       sizeof(multiple), &multiple, NULL);
+    }
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    units = units > 0 ? units : 1;
+    multiple = multiple > 0 ? multiple : 1;
+
+    // Наибольшее кратное multiple, не больше предела; если предел меньше кратности - сам предел
+    const size_t limit = kernelLimit < LAUNCH_MAX_LOCAL ? kernelLimit : LAUNCH_MAX_LOCAL;
+    size_t local = limit / multiple * multiple;
+    local = local > 0 ? local : (limit > 0 ? limit : 1);
+    // Для коротких векторов work-group не больше вектора, округленного до кратного
+    const size_t rounded = (count + multiple - 1) / multiple * multiple;
+    if (rounded > 0 && rounded < local) {
+        local = rounded;
+    }
+
+    const size_t needed = (count + local - 1) / local;
+    const size_t resident = (size_t) units * LAUNCH_GROUPS_PER_UNIT;
+    const size_t groups = needed < resident ? needed : resident;
+    geometry->local = local;
+    geometry->global = (groups > 0 ? groups : 1) * local;
+    geometry->perItem = (count + geometry->global - 1) / geometry->global;
+    return CL_SUCCESS;
+}
+
+/*!
+ * @}
+ */
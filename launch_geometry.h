@@ -0,0 +1,54 @@
+/*!
+  * \defgroup launch_geometry Размеры запуска поэлементных kernel'ей
+  *
+  * Поэлементные kernel'и проходят вектор циклом с шагом в размер NDRange (grid-stride):
+  *
+  *     for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) { ... }
+  *
+  * поэтому количество work-item'ов не зависит от длины вектора, а хвост, не кратный размеру NDRange,
+  * обрабатывается условием цикла. Размер work-group - наибольшее кратное CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+  * не больше LAUNCH_MAX_LOCAL и предела kernel'я, количество work-group - LAUNCH_GROUPS_PER_UNIT
+  * на вычислительный блок (CL_DEVICE_MAX_COMPUTE_UNITS), чтобы устройство было занято и скрывало задержки памяти.
+  * Короткие векторы получают столько work-item'ов, сколько в них элементов (с округлением до кратного).
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LAUNCH_MAX_LOCAL 256            //< наибольший выбираемый размер work-group
+#define LAUNCH_GROUPS_PER_UNIT 8        //< work-group на вычислительный блок для длинных векторов
+
+/*!
+ * \brief LaunchGeometry Размеры запуска одномерного kernel'я
+ */
+typedef struct LaunchGeometry {
+    size_t global;              //< work-item'ов в NDRange (кратно local)
+    size_t local;               //< work-item'ов в work-group
+    size_t perItem;             //< наибольшее количество элементов на work-item
+} LaunchGeometry;
+
+/*!
+ * \brief chooseLaunchGeometry Выбирает размеры запуска grid-stride kernel'я для count элементов
+ *
+ * \param [in] device Устройство
+ * \param [in] kernel Kernel (его предел и предпочтительная кратность размера work-group)
+ * \param [in] count Количество элементов
+ * \param [out] geometry Размеры запуска
+ * \return CL_SUCCESS или код ошибки запроса свойств
+ */
+cl_int chooseLaunchGeometry(cl_device_id device, cl_kernel kernel, size_t count, LaunchGeometry* geometry);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
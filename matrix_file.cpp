@@ -0,0 +1,224 @@
+/*!
+  * \addtogroup matrix_file
+  * @{
+  */
+
+#include "matrix_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'O', 'C', 'L', 'M', 'A', 'T', 0, 0 };
+constexpr uint32_t VERSION = 1;
+
+[[noreturn]] void fail(const std::string& path, const char* what) {
+    throw std::runtime_error { path + ": " + what + " (" + std::strerror(errno) + ")" };
+}
+
+/*!
+ * \brief dataFits Проверяет, что данные матрицы rows x cols помещаются в размер файла без переполнения
+ */
+bool dataFits(uint64_t rows, uint64_t cols) {
+    const uint64_t limit = (static_cast<uint64_t>(std::numeric_limits<off_t>::max()) - MATRIX_DATA_OFFSET)
+            / sizeof(float);
+    return rows == 0 || cols <= limit / rows;
+}
+
+size_t pageSize() {
+    static const size_t size = [] {
+        const long value = sysconf(_SC_PAGESIZE);
+        return value > 0 ? static_cast<size_t>(value) : size_t(4096);
+    }();
+    return size;
+}
+
+} // namespace
+
+MappedWindow::MappedWindow(MappedWindow&& other) noexcept
+    : base { std::exchange(other.base, nullptr) }, shift { other.shift }, length { std::exchange(other.length, 0) } {
+}
+
+MappedWindow& MappedWindow::operator=(MappedWindow&& other) noexcept {
+    std::swap(base, other.base);
+    std::swap(shift, other.shift);
+    std::swap(length, other.length);
+    return *this;
+}
+
+MappedWindow::~MappedWindow() {
+    if (base != nullptr) {
+        munmap(base, length);
+    }
+}
+
+MatrixFile::MatrixFile(const std::string& path, int fd, bool writable, const MatrixFileHeader& header)
+    : filePath { path }, fd { fd }, writable { writable }, header { header } {
+}
+
+MatrixFile::MatrixFile(MatrixFile&& other) noexcept
+    : filePath { std::move(other.filePath) }, fd { std::exchange(other.fd, -1) },
+      writable { other.writable }, header { other.header } {
+}
+
+MatrixFile& MatrixFile::operator=(MatrixFile&& other) noexcept {
+    std::swap(filePath, other.filePath);
+    std::swap(fd, other.fd);
+    std::swap(writable, other.writable);
+    std::swap(header, other.header);
+    return *this;
+}
+
+MatrixFile::~MatrixFile() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+MatrixFile MatrixFile::open(const std::string& path, bool writable) {
+    const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        fail(path, "cannot open matrix file");
+    }
+    MatrixFile file { path, fd, writable, MatrixFileHeader {} };
+    if (pread(fd, &file.header, sizeof(file.header), 0) != static_cast<ssize_t>(sizeof(file.header))) {
+        fail(path, "cannot read matrix header");
+    }
+    if (std::memcmp(file.header.magic, MAGIC, sizeof(MAGIC)) != 0 || file.header.version != VERSION) {
+        throw std::runtime_error { path + ": not a matrix file" };
+    }
+    if (file.header.type != MatrixType::Float32 ||
+        (file.header.layout != MatrixLayout::RowMajor && file.header.layout != MatrixLayout::ColumnMajor)) {
+        throw std::runtime_error { path + ": unsupported matrix type or layout" };
+    }
+    // Поврежденный заголовок не должен давать переполненный и потому малый ожидаемый размер
+    if (!dataFits(file.header.rows, file.header.cols)) {
+        throw std::runtime_error { path + ": matrix dimensions in header are too large" };
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        fail(path, "cannot stat matrix file");
+    }
+    const uint64_t expected = MATRIX_DATA_OFFSET + file.header.rows * file.header.cols * sizeof(float);
+    if (static_cast<uint64_t>(info.st_size) < expected) {
+        throw std::runtime_error { path + ": matrix file is truncated" };
+    }
+    return file;
+}
+
+MatrixFile MatrixFile::create(const std::string& path, uint64_t rows, uint64_t cols, MatrixLayout layout) {
+    if (!dataFits(rows, cols)) {
+        throw std::invalid_argument { path + ": matrix dimensions are too large" };
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fail(path, "cannot create matrix file");
+    }
+    MatrixFileHeader header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.type = MatrixType::Float32;
+    header.layout = layout;
+    header.rows = rows;
+    header.cols = cols;
+    MatrixFile file { path, fd, true, header };
+    // Файл создается разреженным: элементы равны нулю, место выделяется при записи
+    if (ftruncate(fd, static_cast<off_t>(MATRIX_DATA_OFFSET + rows * cols * sizeof(float))) != 0) {
+        fail(path, "cannot resize matrix file");
+    }
+    if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        fail(path, "cannot write matrix header");
+    }
+    return file;
+}
+
+MappedWindow MatrixFile::map(uint64_t offset, size_t bytes) const {
+    const uint64_t position = MATRIX_DATA_OFFSET + offset;
+    const uint64_t aligned = position / pageSize() * pageSize();
+    MappedWindow window;
+    window.shift = static_cast<size_t>(position - aligned);
+    window.length = window.shift + bytes;
+    void* ptr = mmap(nullptr, window.length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                     fd, static_cast<off_t>(aligned));
+    if (ptr == MAP_FAILED) {
+        fail(filePath, "cannot map matrix file");
+    }
+    window.base = static_cast<char*>(ptr);
+    return window;
+}
+
+uint64_t MatrixFile::offsetOf(uint64_t row, uint64_t col) const {
+    const uint64_t index = header.layout == MatrixLayout::ColumnMajor ? col * header.rows + row
+                                                                      : row * header.cols + col;
+    return index * sizeof(float);
+}
+
+void MatrixFile::readBlock(uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, float* dst, size_t ld) const {
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+    // Окно покрывает блок от первого до последнего элемента; в память попадают только страницы его строк (столбцов)
+    const uint64_t first = offsetOf(row, col);
+    const uint64_t last = offsetOf(row + rows - 1, col + cols - 1) + sizeof(float);
+    MappedWindow window = map(first, static_cast<size_t>(last - first));
+    const float* src = reinterpret_cast<const float*>(window.data());
+    if (header.layout == MatrixLayout::ColumnMajor) {
+        for (uint64_t j = 0; j < cols; ++j) {
+            std::memcpy(dst + j * ld, src + j * header.rows, rows * sizeof(float));
+        }
+    } else {
+        for (uint64_t i = 0; i < rows; ++i) {
+            const float* line = src + i * header.cols;
+            for (uint64_t j = 0; j < cols; ++j) {
+                dst[j * ld + i] = line[j];
+            }
+        }
+    }
+}
+
+void MatrixFile::writeBlock(uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, const float* src, size_t ld) {
+    if (!writable) {
+        throw std::runtime_error { filePath + ": matrix file is opened read-only" };
+    }
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+    const uint64_t first = offsetOf(row, col);
+    const uint64_t last = offsetOf(row + rows - 1, col + cols - 1) + sizeof(float);
+    MappedWindow window = map(first, static_cast<size_t>(last - first));
+    float* dst = reinterpret_cast<float*>(window.data());
+    if (header.layout == MatrixLayout::ColumnMajor) {
+        for (uint64_t j = 0; j < cols; ++j) {
+            std::memcpy(dst + j * header.rows, src + j * ld, rows * sizeof(float));
+        }
+    } else {
+        for (uint64_t i = 0; i < rows; ++i) {
+            float* line = dst + i * header.cols;
+            for (uint64_t j = 0; j < cols; ++j) {
+                line[j] = src[j * ld + i];
+            }
+        }
+    }
+}
+
+float MatrixFile::at(uint64_t row, uint64_t col) const {
+    float value;
+    if (pread(fd, &value, sizeof(value), static_cast<off_t>(MATRIX_DATA_OFFSET + offsetOf(row, col))) !=
+            static_cast<ssize_t>(sizeof(value))) {
+        fail(filePath, "cannot read matrix element");
+    }
+    return value;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,127 @@
+/*!
+  * \defgroup matrix_file Файлы матриц
+  *
+  * Двоичный формат матриц, которые не помещаются в память: заголовок (размеры, порядок хранения, тип элементов)
+  * занимает первую страницу файла, за ним подряд идут элементы. Файл читается и пишется через mmap окнами,
+  * поэтому в памяти процесса находятся только страницы окон, открытых в данный момент.
+  * @{
+  */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class MatrixLayout : uint32_t { RowMajor = 0, ColumnMajor = 1 };
+enum class MatrixType : uint32_t { Float32 = 0 };
+
+/*!
+ * \brief MatrixFileHeader Заголовок файла матрицы
+ */
+struct MatrixFileHeader {
+    char magic[8];              //< "OCLMAT\0\0"
+    uint32_t version;
+    MatrixType type;
+    MatrixLayout layout;
+    uint32_t reserved;
+    uint64_t rows;
+    uint64_t cols;
+};
+
+/*!
+ * \brief MATRIX_DATA_OFFSET Смещение элементов от начала файла; кратно размеру страницы
+ */
+constexpr size_t MATRIX_DATA_OFFSET = 4096;
+
+/*!
+ * \brief MappedWindow Отображенный в память участок файла, освобождается при уничтожении
+ */
+class MappedWindow {
+public:
+    MappedWindow() = default;
+    MappedWindow(MappedWindow&& other) noexcept;
+    MappedWindow& operator=(MappedWindow&& other) noexcept;
+    MappedWindow(const MappedWindow&) = delete;
+    MappedWindow& operator=(const MappedWindow&) = delete;
+    ~MappedWindow();
+
+    /*!
+     * \brief data Начало запрошенного участка (mmap выравнивает отображение по странице)
+     */
+    char* data() const { return base + shift; }
+
+private:
+    friend class MatrixFile;
+
+    char* base = nullptr;
+    size_t shift = 0;
+    size_t length = 0;
+};
+
+/*!
+ * \brief MatrixFile Матрица float в файле
+ *
+ * Ошибки файловой системы и неверный формат сообщаются исключением std::runtime_error.
+ */
+class MatrixFile {
+public:
+    /*!
+     * \brief open Открывает существующий файл
+     * \param [in] writable Разрешить изменение элементов
+     */
+    static MatrixFile open(const std::string& path, bool writable = false);
+
+    /*!
+     * \brief create Создает (или перезаписывает) файл матрицы rows x cols, заполненной нулями
+     * \throws std::invalid_argument Если размер данных не помещается в файл
+     */
+    static MatrixFile create(const std::string& path, uint64_t rows, uint64_t cols, MatrixLayout layout);
+
+    MatrixFile(MatrixFile&& other) noexcept;
+    MatrixFile& operator=(MatrixFile&& other) noexcept;
+    MatrixFile(const MatrixFile&) = delete;
+    MatrixFile& operator=(const MatrixFile&) = delete;
+    ~MatrixFile();
+
+    uint64_t rows() const { return header.rows; }
+    uint64_t cols() const { return header.cols; }
+    MatrixLayout layout() const { return header.layout; }
+    const std::string& path() const { return filePath; }
+
+    /*!
+     * \brief readBlock Копирует блок rows x cols с углом (row, col) в dst по столбцам (ld - шаг столбца dst)
+     *
+     * Отображается только участок файла, покрывающий блок, и освобождается сразу после копирования.
+     */
+    void readBlock(uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, float* dst, size_t ld) const;
+
+    /*!
+     * \brief writeBlock Записывает блок rows x cols, хранящийся в src по столбцам, в угол (row, col)
+     */
+    void writeBlock(uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, const float* src, size_t ld);
+
+    /*!
+     * \brief at Читает один элемент (для проверки результата)
+     */
+    float at(uint64_t row, uint64_t col) const;
+
+    /*!
+     * \brief map Отображает bytes байт элементов начиная со смещения offset (в байтах от начала элементов)
+     */
+    MappedWindow map(uint64_t offset, size_t bytes) const;
+
+private:
+    MatrixFile(const std::string& path, int fd, bool writable, const MatrixFileHeader& header);
+
+    uint64_t offsetOf(uint64_t row, uint64_t col) const;
+
+    std::string filePath;
+    int fd = -1;
+    bool writable = false;
+    MatrixFileHeader header {};
+};
+
+/*!
+ * @}
+ */
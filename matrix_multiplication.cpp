@@ -1,7 +1,6 @@
 /*!
   * \defgroup matrix_multiplication Перемножение матриц C++
   * @{
-  * \todo test for different matrices!
   * \todo add doxygen documentation
   */
 
@@ -11,43 +10,36 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
-#include <cassert>
-#include <sstream>
 
 #include <string_view>
+#include <chrono>
+#include <cfloat>
+#include <random>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
-using namespace std::literals::string_view_literals;
+#include <sys/resource.h>
 
-static constexpr std::string_view kernelMultiplySrc { R"CLC(
-// -D TS=
-kernel void matrixMultiply(const int M, const int N, const int K,
-                    const global float* A,
-                    const global float* B,
-                    global float* C) {
-    const int row = get_local_id(0);
-    const int col = get_local_id(1);
-    const int globalRow = TS * get_group_id(0) + row;
-    const int globalCol = TS * get_group_id(1) + col;
-    local float Asub[TS][TS];
-    local float Bsub[TS][TS];
-
-    float sum = 0.0f;
-    const int numTiles = K / TS;
-    for (int t=0; t < numTiles; ++t) {
-        const int tiledRow = TS * t + row;
-        const int tiledCol = TS * t + col;
-        Asub[col][row] = A[tiledCol * M + globalRow];
-        Bsub[col][row] = B[globalCol * K + tiledRow];
-
-        barrier(CLK_LOCAL_MEM_FENCE);
-        for (int k=0; k < TS; ++k) {
-            sum += Asub[k][row] * Bsub[col][k];
-        }
-        barrier(CLK_LOCAL_MEM_FENCE);
-    }
-    C[globalCol * M + globalRow] = sum;
-}
-)CLC"sv };
+#include "batched_gemm.hpp"
+#include "cpu_gemm.hpp"
+#include "device_vector.hpp"
+#include "gemm.hpp"
+#include "gemm_tuner.hpp"
+#include "host_memory.hpp"
+#include "matrix_file.hpp"
+#include "multi_device_gemm.hpp"
+#include "out_of_core_gemm.hpp"
+#include "program_cache.h"
+#include "quantized_gemm.hpp"
+#include "sparse.hpp"
+#include "task_graph.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "validate.hpp"
+
+using namespace std::literals::string_view_literals;
 
 void printMatrix(const std::vector<float>& a, int x, int y) {
     for (int i = 0; i < x; ++i) {
@@ -58,94 +50,762 @@ void printMatrix(const std::vector<float>& a, int x, int y) {
     }
 }
 
-void multiplyMatrices(const std::vector<float>& a, int rowsA, int colsA,
-              const std::vector<float>& b, int bX, int colsB,
-              std::vector<float>& out) {
-    for (int row = 0; row < rowsA; row++) {
-        for (int col = 0; col < colsA; col++) {
-            float sum = 0;
-            for (int k = 0; k < colsB; k++) {
-                sum += a[row * colsA + k] * b[k * colsB + col];
-            }
-            out[row * colsA + col] = sum;
-        }
-    }
+/*!
+ * \brief gemmTolerance Допуск сравнения результата умножения с эталоном
+ *
+ * Устройство и CPU могут суммировать K произведений в разном порядке, поэтому ошибка округления растет с K.
+ * \param [in] scale Порядок величины слагаемых (для элементов с нулевым эталоном)
+ */
+Tolerance gemmTolerance(int K, double scale = 1.0) {
+    return Tolerance { K * FLT_EPSILON * scale, K * FLT_EPSILON, 0 };
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cout << "usage: <platformId> <deviceId>";
-        return 0;
-    }
-    std::vector<cl::Platform> platforms;
-    cl::Platform::get(&platforms);
+/*!
+ * \brief runOnCpu Умножает квадратные матрицы размера size на CPU и выводит время и производительность
+ *
+ * Используется, когда openCL устройство недоступно или явно выбран режим cpu.
+ */
+int runOnCpu(int size) {
+    std::vector<float> matrixA ( size * size, 0.5f );
+    std::vector<float> matrixB ( size * size, 1.5f );
+    std::vector<float> matrixC;
 
-    auto platform = platforms[atoi(argv[1])];
+    auto start = std::chrono::steady_clock::now();
+    multiplyMatrices(matrixA, size, size, matrixB, size, size, matrixC);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    std::vector<cl::Device> devices;
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
+    std::cout << "CPU (" << cpuGemmIsa() << ", " << ThreadPool::shared().size() << " threads): "
+              << size << "x" << size << " in " << elapsed.count() * 1000.0 << " ms, "
+              << 2.0 * size * size * size / elapsed.count() / 1e9 << " GFLOPS" << std::endl;
 
-    auto device = devices[atoi(argv[2])];
+    requireValid("cpu", matrixC, std::vector<float>(matrixC.size(), 0.75f * size), gemmTolerance(size));
+    return 0;
+}
 
-    cl::Context context { device };
-    cl::CommandQueue queue { context, device };
+/*!
+ * \brief fillOperands Заполняет A (M x K) и B (K x N) значениями, кратными 1/4
+ *
+ * Значения малы, поэтому суммы вычисляются точно при любом порядке сложения
+ * и результат устройства можно сравнивать с CPU на равенство.
+ */
+template <typename Vector>
+void fillOperands(int M, int N, int K, Vector& a, Vector& b) {
+    a.resize(static_cast<size_t>(M) * K);
+    b.resize(static_cast<size_t>(K) * N);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<float>(i % 7) * 0.25f;
+    }
+    for (size_t i = 0; i < b.size(); ++i) {
+        b[i] = static_cast<float>(i % 5) * 0.5f - 0.5f;
+    }
+}
 
-    const int TILE_WIDTH = 3;
-    cl::Program multiply { context, kernelMultiplySrc.data() };
-    std::ostringstream ss;
-    ss << "-D TS=" << TILE_WIDTH;
+/*!
+ * \brief runOnAllDevices Умножает матрицы на всех openCL устройствах всех платформ и выводит вклад каждого
+ *
+ * Результат сравнивается побитово с результатом первого устройства и с CPU.
+ */
+int runOnAllDevices(int M, int N, int K) {
+    std::vector<cl::Platform> platforms;
+    std::vector<cl::Device> devices;
     try {
-        multiply.build(ss.str().data());
-    } catch (const cl::Error& e) {
-        std::cout << multiply.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
-        throw e;
+        cl::Platform::get(&platforms);
+    } catch (const cl::Error&) {
+    }
+    for (auto& platform : platforms) {
+        std::vector<cl::Device> platformDevices;
+        try {
+            platform.getDevices(CL_DEVICE_TYPE_ALL, &platformDevices);
+        } catch (const cl::Error&) {
+            continue;
+        }
+        devices.insert(devices.end(), platformDevices.begin(), platformDevices.end());
+    }
+    if (devices.empty()) {
+        std::cout << "no openCL device available, falling back to CPU" << std::endl;
+        return runOnCpu(1024);
     }
-    auto multiplyKernel = cl::make_kernel<
-            int, int, int,
-            cl::Buffer&, cl::Buffer&, cl::Buffer&
-    >{ multiply, "matrixMultiply" };
 
-    const int M = 3;
-    const int N = 3;
-    const int K = 3;
+    std::vector<float> matrixAHost, matrixBHost;
+    fillOperands(M, N, K, matrixAHost, matrixBHost);
+    std::vector<float> matrixCHost ( static_cast<size_t>(M) * N );
 
-    std::vector<float> matrixAHost ( M * N, 0.5f );
-    std::vector<float> matrixBHost ( N * K, 1.5f );
+    GemmTuner tuner { GemmTuner::defaultPath() };
+    MultiDeviceGemm gemm { devices, &tuner };
+    auto start = std::chrono::steady_clock::now();
+    auto stats = gemm.multiply(M, N, K, matrixAHost.data(), matrixBHost.data(), matrixCHost.data());
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    std::vector<float> matrixCHost ( M * K );
-    std::vector<float> matC = matrixCHost;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const BufferPoolStats pool = gemm.bufferPoolStats(i);
+        std::cout << stats[i].device << ": " << stats[i].panels << " panels, " << stats[i].columns << " columns, "
+                  << stats[i].seconds * 1000.0 << " ms, " << stats[i].gflops << " GFLOPS, buffers: "
+                  << pool.allocations << " allocated, " << pool.reuses << " reused" << std::endl;
+    }
+    std::cout << "total: " << M << "x" << N << "x" << K << " on " << devices.size() << " devices in "
+              << elapsed.count() * 1000.0 << " ms, " << 2.0 * M * N * K / elapsed.count() / 1e9 << " GFLOPS" << std::endl;
 
+    // Тот же расчет на одном устройстве должен дать побитово тот же результат
+    cl::Context context { devices[0] };
+    cl::CommandQueue queue { context, devices[0], traceQueueProperties() };
     cl::Buffer matrixA { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                          sizeof(float) * matrixAHost.size(), matrixAHost.data() };
     cl::Buffer matrixB { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                          sizeof(float) * matrixBHost.size(), matrixBHost.data() };
-    cl::Buffer matrixC { context, CL_MEM_WRITE_ONLY,
-                         sizeof(float) * matrixCHost.size() };
+    cl::Buffer matrixC { context, CL_MEM_WRITE_ONLY, sizeof(float) * matrixCHost.size() };
+    Gemm { context, devices[0] }.enqueue(queue, M, N, K, matrixA, matrixB, matrixC);
+    std::vector<float> single ( matrixCHost.size() );
+    cl::Event read;
+    queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, single.size() * sizeof(float), single.data(), nullptr, &read);
+    traceCommand(read, "read C");
+    requireValid("single device", matrixCHost, single);
 
-    multiplyKernel(
-            cl::EnqueueArgs{queue,
-                            cl::NDRange {M, N},
-                            cl::NDRange {TILE_WIDTH, TILE_WIDTH},
-            },
-            M, N, K,
-            matrixA, matrixB, matrixC
-    );
+    std::vector<float> matC;
+    multiplyMatrices(matrixBHost, N, K, matrixAHost, K, M, matC);
+    requireValid("all devices", matrixCHost, matC, gemmTolerance(K));
+    std::cout << "OK" << std::endl;
+    printProgramCacheStats();
+    return 0;
+}
 
-    queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, matrixCHost.size() * sizeof(float), matrixCHost.data());
+/*!
+ * \brief runBatched Умножает batch пар маленьких матриц M x K и K x N одним запуском kernel'я
+ *
+ * Матрицы пакета лежат в буферах подряд (stride равен размеру матрицы).
+ */
+int runBatched(const cl::Context& context, const cl::Device& device, int batch, int M, int N, int K) {
+    if (batch <= 0) {
+        throw std::invalid_argument { "batch size must be positive" };
+    }
+    const size_t strideA = static_cast<size_t>(M) * K;
+    const size_t strideB = static_cast<size_t>(K) * N;
+    const size_t strideC = static_cast<size_t>(M) * N;
+    std::vector<float> matrixAHost ( strideA * batch );
+    std::vector<float> matrixBHost ( strideB * batch );
+    for (size_t i = 0; i < matrixAHost.size(); ++i) {
+        matrixAHost[i] = static_cast<float>(i % 7) * 0.25f;
+    }
+    for (size_t i = 0; i < matrixBHost.size(); ++i) {
+        matrixBHost[i] = static_cast<float>(i % 5) * 0.5f - 0.5f;
+    }
+    std::vector<float> matrixCHost ( strideC * batch );
 
-//    printMatrix( matrixAHost, M, N);
-//    printMatrix( matrixBHost, N, K);
-//    printMatrix( matrixCHost, M, K);
+    cl::CommandQueue queue { context, device, CL_QUEUE_PROFILING_ENABLE };
+    BatchedGemm gemm { context, device, M, N, K };
+    cl::Buffer matrixA { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         sizeof(float) * matrixAHost.size(), matrixAHost.data() };
+    cl::Buffer matrixB { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         sizeof(float) * matrixBHost.size(), matrixBHost.data() };
+    cl::Buffer matrixC { context, CL_MEM_WRITE_ONLY, sizeof(float) * matrixCHost.size() };
+
+    auto event = gemm.enqueue(queue, batch, matrixA, strideA, matrixB, strideB, matrixC, strideC);
+    event.wait();
+    const double seconds = (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                            - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) / 1e9;
+    cl::Event read;
+    queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, sizeof(float) * matrixCHost.size(), matrixCHost.data(),
+                            nullptr, &read);
+    traceCommand(read, "read C");
+
+    std::cout << batch << " x " << M << "x" << N << "x" << K << " ("
+              << (gemm.usesPrivateMemory() ? "private memory" : "element per work-item") << "): "
+              << seconds * 1000.0 << " ms, " << batch / seconds / 1e6 << " M matrices/s, "
+              << 2.0 * M * N * K * batch / seconds / 1e9 << " GFLOPS" << std::endl;
+
+    std::vector<float> matC ( matrixCHost.size() );
+    auto start = std::chrono::steady_clock::now();
+    cpuBatchedGemm(M, N, K, batch, matrixAHost.data(), strideA, matrixBHost.data(), strideB, matC.data(), strideC);
+    std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - start;
+    std::cout << "CPU reference: " << cpuTime.count() << " ms" << std::endl;
+
+    requireValid("batch", matrixCHost, matC, gemmTolerance(K));
+    std::cout << "OK" << std::endl;
+    printProgramCacheStats();
+    return 0;
+}
+
+/*!
+ * \brief runGraph Вычисляет D = A1 * B1 + A2 * B2 графом асинхронных задач
+ *
+ * Записи операндов и оба умножения не зависят друг от друга и могут выполняться одновременно,
+ * сложение ждет оба умножения, чтение - сложение. Хост блокируется только при получении результата.
+ */
+int runGraph(const cl::Context& context, const cl::Device& device, int M, int N, int K) {
+    std::vector<float> matrixA1Host, matrixB1Host;
+    fillOperands(M, N, K, matrixA1Host, matrixB1Host);
+    // Вторая пара - те же значения в обратном порядке
+    std::vector<float> matrixA2Host { matrixA1Host.rbegin(), matrixA1Host.rend() };
+    std::vector<float> matrixB2Host { matrixB1Host.rbegin(), matrixB1Host.rend() };
+    const size_t sizeC = static_cast<size_t>(M) * N;
+
+    TaskGraph graph { context, device };
+    if (graph.outOfOrder()) {
+        std::cout << "task graph: out-of-order queue" << std::endl;
+    } else {
+        std::cout << "task graph: " << graph.queueCount() << " in-order queues" << std::endl;
+    }
+    Gemm gemm { context, device };
+    cl::Buffer matrixA1 { context, CL_MEM_READ_ONLY, sizeof(float) * matrixA1Host.size() };
+    cl::Buffer matrixB1 { context, CL_MEM_READ_ONLY, sizeof(float) * matrixB1Host.size() };
+    cl::Buffer matrixA2 { context, CL_MEM_READ_ONLY, sizeof(float) * matrixA2Host.size() };
+    cl::Buffer matrixB2 { context, CL_MEM_READ_ONLY, sizeof(float) * matrixB2Host.size() };
+    cl::Buffer matrixC1 { context, CL_MEM_READ_WRITE, sizeof(float) * sizeC };
+    cl::Buffer matrixC2 { context, CL_MEM_READ_WRITE, sizeof(float) * sizeC };
+    cl::Buffer matrixD { context, CL_MEM_WRITE_ONLY, sizeof(float) * sizeC };
+
+    // Kernel сложения компилируется до построения графа, чтобы постановка задач не ждала компилятора
+    const std::string sumParams = ", const global TYPE* a, const global TYPE* b";
+    const std::string sumExpression = "AT(a) + AT(b)";
+    prepareFused(context, device, "float", nullptr, 4, sumParams, sumExpression);
+
+    auto multiply = [&](const cl::Buffer& a, const cl::Buffer& b, const cl::Buffer& c) {
+        return [&, a, b, c](cl::CommandQueue& queue, const std::vector<cl::Event>* events) {
+            return gemm.enqueue(queue, M, N, K, a, b, c, events);
+        };
+    };
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    Task writeA1 = graph.write(matrixA1, matrixA1Host.data(), sizeof(float) * matrixA1Host.size());
+    Task writeB1 = graph.write(matrixB1, matrixB1Host.data(), sizeof(float) * matrixB1Host.size());
+    Task writeA2 = graph.write(matrixA2, matrixA2Host.data(), sizeof(float) * matrixA2Host.size());
+    Task writeB2 = graph.write(matrixB2, matrixB2Host.data(), sizeof(float) * matrixB2Host.size());
+    Task product1 = graph.enqueue(multiply(matrixA1, matrixB1, matrixC1), { writeA1, writeB1 });
+    Task product2 = graph.enqueue(multiply(matrixA2, matrixB2, matrixC2), { writeA2, writeB2 });
+    Task sum = graph.enqueue([&](cl::CommandQueue& queue, const std::vector<cl::Event>* events) {
+        return enqueueFused(queue, "float", nullptr, 4, sumParams, sumExpression, sizeC, [&](cl::Kernel& kernel) {
+            kernel.setArg(1, matrixC1);
+            kernel.setArg(2, matrixC2);
+            kernel.setArg(3, matrixD);
+        }, events);
+    }, { product1, product2 });
+    std::shared_future<std::vector<float>> result = graph.read<float>(matrixD, sizeC, { sum });
+    std::chrono::duration<double, std::milli> submitTime = Clock::now() - start;
+
+    const std::vector<float>& matrixDHost = result.get();
+    std::chrono::duration<double, std::milli> totalTime = Clock::now() - start;
+    std::cout << "submit: " << submitTime.count() << " ms, result after " << totalTime.count() << " ms" << std::endl;
+
+    // Эталон на CPU: матрицы на устройстве хранятся по столбцам, см. main
+    std::vector<float> matC1 ( sizeC ), matC2 ( sizeC );
+    cpuGemm(N, M, K, matrixB1Host.data(), K, matrixA1Host.data(), M, matC1.data(), M);
+    cpuGemm(N, M, K, matrixB2Host.data(), K, matrixA2Host.data(), M, matC2.data(), M);
+    for (size_t i = 0; i < sizeC; ++i) {
+        matC1[i] += matC2[i];
+    }
+    requireValid("graph", matrixDHost, matC1, gemmTolerance(2 * K));
+    std::cout << M << "x" << N << "x" << K << ": OK" << std::endl;
+    printProgramCacheStats();
+    return 0;
+}
 
-    // do same on cpu
-    multiplyMatrices(matrixAHost, M, N, matrixBHost, N, K, matC);
+/*!
+ * \brief runOutOfCore Умножает матрицы из файлов aPath и bPath блоками, результат записывается в cPath
+ *
+ * Выборочные элементы C сравниваются со скалярными произведениями, прочитанными напрямую из файлов.
+ */
+int runOutOfCore(const cl::Context& context, const cl::Device& device,
+                 const std::string& aPath, const std::string& bPath, const std::string& cPath, size_t budget) {
+    MatrixFile a = MatrixFile::open(aPath);
+    MatrixFile b = MatrixFile::open(bPath);
+    MatrixFile c = MatrixFile::create(cPath, a.rows(), b.cols(), MatrixLayout::ColumnMajor);
 
-//    printMatrix(matC, M, K);
+    OutOfCoreGemm gemm { context, device, budget };
+    auto stats = gemm.multiply(a, b, c);
 
-    for (size_t i = 0; i < matrixCHost.size(); ++i) {
-        assert( matrixCHost[i] == matC[i] );
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << a.rows() << "x" << b.cols() << "x" << a.cols() << " in tiles " << stats.tileM << "x" << stats.tileN
+              << "x" << stats.tileK << " (budget " << budget / (1 << 20) << " MiB): " << stats.tiles << " tiles, "
+              << stats.steps << " steps, " << stats.seconds * 1000.0 << " ms, "
+              << 2.0 * a.rows() * b.cols() * a.cols() / stats.seconds / 1e9 << " GFLOPS, "
+              << (stats.bytesRead + stats.bytesWritten) / stats.seconds / 1e9 << " GB/s from files" << std::endl;
+    std::cout << "peak RSS: " << usage.ru_maxrss / 1024 << " MiB" << std::endl;
+
+    const uint64_t samples = std::min<uint64_t>(16, c.rows() * c.cols());
+    std::vector<float> sampled ( samples ), expected ( samples );
+    for (uint64_t s = 0; s < samples; ++s) {
+        const uint64_t row = (s * 7919) % c.rows();
+        const uint64_t col = (s * 104729) % c.cols();
+        for (uint64_t k = 0; k < a.cols(); ++k) {
+            expected[s] += a.at(row, k) * b.at(k, col);
+        }
+        sampled[s] = c.at(row, col);
     }
+    requireValid("out-of-core samples", sampled, expected, gemmTolerance(static_cast<int>(a.cols())));
+    std::cout << "OK" << std::endl;
+    printProgramCacheStats();
+    return 0;
+}
+
+/*!
+ * \brief writeOperandFiles Создает файлы A (M x K, по строкам) и B (K x N, по столбцам)
+ *
+ * Значения суммируются точно, как в fillOperands. Файлы заполняются по строкам и столбцам,
+ * поэтому объем памяти не зависит от размеров матриц.
+ */
+void writeOperandFiles(int M, int N, int K, const std::string& aPath, const std::string& bPath) {
+    MatrixFile a = MatrixFile::create(aPath, M, K, MatrixLayout::RowMajor);
+    MatrixFile b = MatrixFile::create(bPath, K, N, MatrixLayout::ColumnMajor);
+    std::vector<float> line ( K );
+    for (int i = 0; i < M; ++i) {
+        for (int j = 0; j < K; ++j) {
+            line[j] = static_cast<float>((static_cast<size_t>(i) * K + j) % 7) * 0.25f;
+        }
+        a.writeBlock(i, 0, 1, K, line.data(), 1);
+    }
+    for (int j = 0; j < N; ++j) {
+        for (int i = 0; i < K; ++i) {
+            line[i] = static_cast<float>((static_cast<size_t>(j) * K + i) % 5) * 0.5f - 0.5f;
+        }
+        b.writeBlock(0, j, K, 1, line.data(), K);
+    }
+}
+
+/*!
+ * \brief runSgemm Проверяет enqueueSgemm для обоих порядков хранения и всех вариантов транспонирования
+ *
+ * Шаги матриц больше их размеров, alpha и beta отличны от 1 и 0. Результат сравнивается с прямым
+ * вычислением, включая элементы между концом строки (столбца) и шагом, которые не должны изменяться.
+ */
+int runSgemm(const cl::Context& context, const cl::Device& device, int M, int N, int K) {
+    const float alpha = 1.5f;
+    const float beta = -0.5f;
+    cl::CommandQueue queue { context, device, CL_QUEUE_PROFILING_ENABLE };
+    Gemm gemm { context, device };
+
+    for (GemmLayout layout : { GemmLayout::ColumnMajor, GemmLayout::RowMajor }) {
+        const bool rowMajor = layout == GemmLayout::RowMajor;
+        // Хранимая матрица rows x cols с шагом ld между столбцами (или строками для RowMajor)
+        auto index = [rowMajor](int ld, int row, int col) {
+            return rowMajor ? static_cast<size_t>(row) * ld + col : static_cast<size_t>(col) * ld + row;
+        };
+        auto at = [&index](const std::vector<float>& x, int ld, int row, int col) -> float {
+            return x[index(ld, row, col)];
+        };
+        for (GemmOp opA : { GemmOp::NoTrans, GemmOp::Trans }) {
+            for (GemmOp opB : { GemmOp::NoTrans, GemmOp::Trans }) {
+                const int rowsA = opA == GemmOp::NoTrans ? M : K, colsA = opA == GemmOp::NoTrans ? K : M;
+                const int rowsB = opB == GemmOp::NoTrans ? K : N, colsB = opB == GemmOp::NoTrans ? N : K;
+                const int lda = (rowMajor ? colsA : rowsA) + 3;
+                const int ldb = (rowMajor ? colsB : rowsB) + 5;
+                const int ldc = (rowMajor ? N : M) + 1;
+                std::vector<float> matrixAHost ( static_cast<size_t>(lda) * (rowMajor ? rowsA : colsA) );
+                std::vector<float> matrixBHost ( static_cast<size_t>(ldb) * (rowMajor ? rowsB : colsB) );
+                std::vector<float> matrixCHost ( static_cast<size_t>(ldc) * (rowMajor ? M : N) );
+                for (size_t i = 0; i < matrixAHost.size(); ++i) {
+                    matrixAHost[i] = static_cast<float>(i % 7) * 0.25f;
+                }
+                for (size_t i = 0; i < matrixBHost.size(); ++i) {
+                    matrixBHost[i] = static_cast<float>(i % 5) * 0.5f - 0.5f;
+                }
+                for (size_t i = 0; i < matrixCHost.size(); ++i) {
+                    matrixCHost[i] = static_cast<float>(i % 3) * 0.5f;
+                }
+
+                cl::Buffer matrixA { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     sizeof(float) * matrixAHost.size(), matrixAHost.data() };
+                cl::Buffer matrixB { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     sizeof(float) * matrixBHost.size(), matrixBHost.data() };
+                cl::Buffer matrixC { context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                     sizeof(float) * matrixCHost.size(), matrixCHost.data() };
+                auto event = gemm.enqueueSgemm(queue, layout, opA, opB, M, N, K, alpha, matrixA, lda, matrixB, ldb,
+                                               beta, matrixC, ldc);
+                event.wait();
+                const double seconds = (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                                        - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) / 1e9;
+                std::vector<float> result ( matrixCHost.size() );
+                cl::Event read;
+                queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, sizeof(float) * result.size(), result.data(),
+                                        nullptr, &read);
+                traceCommand(read, "read C");
 
+                // Элементы между концом строки (столбца) и шагом не должны изменяться, поэтому эталон - копия C
+                std::vector<float> expected = matrixCHost;
+                for (int i = 0; i < M; ++i) {
+                    for (int j = 0; j < N; ++j) {
+                        float sum = 0.0f;
+                        for (int k = 0; k < K; ++k) {
+                            const float x = opA == GemmOp::NoTrans ? at(matrixAHost, lda, i, k)
+                                                                   : at(matrixAHost, lda, k, i);
+                            const float y = opB == GemmOp::NoTrans ? at(matrixBHost, ldb, k, j)
+                                                                   : at(matrixBHost, ldb, j, k);
+                            sum += x * y;
+                        }
+                        expected[index(ldc, i, j)] = alpha * sum + beta * at(matrixCHost, ldc, i, j);
+                    }
+                }
+                requireValid("sgemm", result, expected, gemmTolerance(K));
+                std::cout << (rowMajor ? "row-major " : "column-major ") << (opA == GemmOp::NoTrans ? 'N' : 'T')
+                          << (opB == GemmOp::NoTrans ? 'N' : 'T') << ": " << seconds * 1000.0 << " ms, "
+                          << 2.0 * M * N * K / seconds / 1e9 << " GFLOPS, OK" << std::endl;
+            }
+        }
+    }
+    printProgramCacheStats();
+    return 0;
+}
+
+/*!
+ * \brief runSparse Умножает случайную разреженную матрицу rows x cols на вектор и на матрицу cols x n всеми kernel'ями
+ *
+ * Матрица строится в плотном формате и преобразуется в CSR. Результаты сравниваются с многопоточным эталоном
+ * на CPU, который сам сверяется с плотным умножением multiplyMatrices.
+ * \param [in] density Доля ненулевых элементов
+ */
+int runSparse(const cl::Context& context, const cl::Device& device, int rows, int cols, double density, int n) {
+    if (!(density >= 0.0 && density <= 1.0)) {
+        throw std::invalid_argument { "density must be in [0, 1]" };
+    }
+    std::mt19937 random { 42 };
+    std::bernoulli_distribution nonZero { density };
+    std::uniform_real_distribution<float> value { -1.0f, 1.0f };
+    std::vector<float> dense ( static_cast<size_t>(rows) * cols );
+    for (float& x : dense) {
+        x = nonZero(random) ? value(random) : 0.0f;
+    }
+    std::vector<float> matrixBHost ( static_cast<size_t>(cols) * n );
+    for (size_t i = 0; i < matrixBHost.size(); ++i) {
+        matrixBHost[i] = static_cast<float>(i % 5) * 0.5f - 0.5f;
+    }
+
+    const CsrMatrix csr = csrFromDense(dense, rows, cols);
+    requireValid("csr to dense", csrToDense(csr), dense);
+    const RowStatistics statistics = rowStatistics(csr);
+    std::cout << rows << "x" << cols << ", " << csr.nnz() << " non-zeros (" << 100.0 * csr.nnz() / dense.size()
+              << "%), row length " << statistics.mean << " +- " << statistics.deviation << " (max "
+              << statistics.max << "), SELL fill " << statistics.sellFill << ", auto: "
+              << sparseKernelName(chooseSparseKernel(statistics, device.getInfo<CL_DEVICE_TYPE>())) << std::endl;
+
+    std::vector<float> expected ( static_cast<size_t>(rows) * n );
+    auto start = std::chrono::steady_clock::now();
+    cpuSpmm(csr, matrixBHost.data(), n, expected.data());
+    std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - start;
+    std::vector<float> denseC;
+    multiplyMatrices(dense, rows, cols, matrixBHost, cols, n, denseC);
+    requireValid("cpu spmm", expected, denseC, gemmTolerance(statistics.max));
+    std::cout << "CPU reference (" << ThreadPool::shared().size() << " threads): " << cpuTime.count() << " ms"
+              << std::endl;
+
+    cl::CommandQueue queue { context, device, CL_QUEUE_PROFILING_ENABLE };
+    cl::Buffer matrixB { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                         sizeof(float) * matrixBHost.size(), matrixBHost.data() };
+    cl::Buffer matrixC { context, CL_MEM_WRITE_ONLY, sizeof(float) * expected.size() };
+    std::vector<float> expectedY ( rows );
+    cpuSpmv(csr, matrixBHost.data(), expectedY.data());
+
+    for (SparseKernel kernel : { SparseKernel::Auto, SparseKernel::CsrScalar, SparseKernel::CsrVector,
+                                 SparseKernel::Sell, SparseKernel::Ell }) {
+        SparseMatrix matrix { context, device, queue, csr, kernel };
+        std::cout << (kernel == SparseKernel::Auto ? "auto -> " : "") << sparseKernelName(matrix.kernel());
+        if (matrix.kernel() == SparseKernel::CsrVector) {
+            std::cout << " (" << matrix.vectorWidth() << " per row)";
+        }
+        std::cout << ", " << matrix.deviceBytes() / 1024 << " KiB (dense "
+                  << sizeof(float) * dense.size() / 1024 << " KiB)" << std::endl;
+
+        // Первые cols элементов B - вектор x для SpMV
+        for (int columns : { 1, n }) {
+            auto event = matrix.enqueueSpmm(queue, columns, matrixB, matrixC);
+            event.wait();
+            const double seconds = (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                                    - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) / 1e9;
+            std::vector<float> result ( static_cast<size_t>(rows) * columns );
+            cl::Event read;
+            queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, sizeof(float) * result.size(), result.data(),
+                                    nullptr, &read);
+            traceCommand(read, "read C");
+            requireValid(columns == 1 ? "spmv" : "spmm", result.data(),
+                         columns == 1 ? expectedY.data() : expected.data(), result.size(),
+                         gemmTolerance(statistics.max));
+            std::cout << "\t" << (columns == 1 ? "spmv" : "spmm n=" + std::to_string(n)) << ": "
+                      << seconds * 1000.0 << " ms, " << 2.0 * csr.nnz() * columns / seconds / 1e9
+                      << " GFLOPS, OK" << std::endl;
+        }
+    }
+    printProgramCacheStats();
+    return 0;
+}
+
+/*!
+ * \brief runQuantized Умножает случайные матрицы с входами float, half и int8 и сравнивает скорость и точность
+ *
+ * Результат каждого типа проверяется эталоном на CPU с теми же входами. Ошибка квантования оценивается
+ * относительно точного float произведения cpuGemm исходных матриц: наибольшая и среднеквадратичная ошибка,
+ * деленные на наибольший модуль элемента C.
+ */
+int runQuantized(const cl::Context& context, const cl::Device& device, int M, int N, int K) {
+    std::mt19937 random { 42 };
+    std::normal_distribution<float> value { 0.0f, 1.0f };
+    std::vector<float> matrixAHost ( static_cast<size_t>(M) * K );
+    std::vector<float> matrixBHost ( static_cast<size_t>(K) * N );
+    for (float& x : matrixAHost) {
+        x = value(random);
+    }
+    for (float& x : matrixBHost) {
+        x = value(random);
+    }
+    std::vector<float> reference ( static_cast<size_t>(M) * N );
+    cpuGemm(M, N, K, matrixAHost.data(), K, matrixBHost.data(), N, reference.data(), N);
+    float maxReference = 0.0f;
+    for (float x : reference) {
+        maxReference = std::max(maxReference, std::fabs(x));
+    }
+
+    cl::CommandQueue queue { context, device, CL_QUEUE_PROFILING_ENABLE };
+    cl::Buffer matrixC { context, CL_MEM_WRITE_ONLY, sizeof(float) * reference.size() };
+    double floatSeconds = 0.0;
+    for (QuantizedType type : { QuantizedType::Float, QuantizedType::Half, QuantizedType::Int8 }) {
+        const QuantizedMatrix a = quantizeRows(matrixAHost.data(), M, K, type);
+        const QuantizedMatrix bt = quantizeColumns(matrixBHost.data(), K, N, type);
+        QuantizedGemm gemm { context, device, type };
+        cl::Buffer matrixA { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, a.bytes(),
+                             const_cast<void*>(a.data()) };
+        cl::Buffer matrixBt { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bt.bytes(),
+                              const_cast<void*>(bt.data()) };
+        std::unique_ptr<cl::Buffer> scaleA, scaleB;
+        if (type == QuantizedType::Int8) {
+            scaleA = std::make_unique<cl::Buffer>(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                  sizeof(float) * a.scales.size(),
+                                                  const_cast<float*>(a.scales.data()));
+            scaleB = std::make_unique<cl::Buffer>(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                  sizeof(float) * bt.scales.size(),
+                                                  const_cast<float*>(bt.scales.data()));
+        }
+
+        // Первый запуск прогревает устройство, измеряется второй
+        gemm.enqueue(queue, M, N, K, matrixA, scaleA.get(), matrixBt, scaleB.get(), matrixC).wait();
+        auto event = gemm.enqueue(queue, M, N, K, matrixA, scaleA.get(), matrixBt, scaleB.get(), matrixC);
+        event.wait();
+        const double seconds = (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                                - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) / 1e9;
+        floatSeconds = type == QuantizedType::Float ? seconds : floatSeconds;
+        std::vector<float> result ( reference.size() );
+        cl::Event read;
+        queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, sizeof(float) * result.size(), result.data(), nullptr, &read);
+        traceCommand(read, "read C");
+
+        std::vector<float> expected ( reference.size() );
+        cpuQuantizedGemm(a, bt, expected.data());
+        requireValid(quantizedTypeName(type), result, expected, gemmTolerance(K, maxReference));
+
+        double squares = 0.0, maxError = 0.0;
+        for (size_t i = 0; i < result.size(); ++i) {
+            const double error = std::fabs(static_cast<double>(result[i]) - reference[i]);
+            squares += error * error;
+            maxError = std::max(maxError, error);
+        }
+        std::cout << quantizedTypeName(type);
+        if (gemm.usesDotProduct()) {
+            std::cout << " (dot)";
+        }
+        if (gemm.usesFp16()) {
+            std::cout << " (cl_khr_fp16)";
+        }
+        std::cout << ": " << seconds * 1000.0 << " ms, " << 2.0 * M * N * K / seconds / 1e9 << " GFLOPS, speedup "
+                  << floatSeconds / seconds << "x, inputs " << (a.bytes() + bt.bytes()) / 1024 << " KiB, error max "
+                  << maxError / maxReference << " rms " << std::sqrt(squares / result.size()) / maxReference
+                  << " (of max |C|), OK" << std::endl;
+    }
+    printProgramCacheStats();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Трасса записывается при выходе из main, пока среда openCL еще загружена
+    TraceFlush trace;
+    if (argc > 1 && argv[1] == "cpu"sv) {
+        return runOnCpu(argc > 2 ? atoi(argv[2]) : 1024);
+    }
+    if (argc > 1 && argv[1] == "all"sv) {
+        return runOnAllDevices(argc > 4 ? atoi(argv[2]) : 1024,
+                               argc > 4 ? atoi(argv[3]) : 1024,
+                               argc > 4 ? atoi(argv[4]) : 1024);
+    }
+    if (argc < 3) {
+        std::cout << "usage: <platformId> <deviceId> [M N K] [tune] [copy | zerocopy] | <platformId> <deviceId> batch [count] [M N K] | <platformId> <deviceId> graph [M N K] | <platformId> <deviceId> sgemm [M N K] | <platformId> <deviceId> file <A> <B> <C> [budgetMiB] | <platformId> <deviceId> ooc [M N K] [budgetMiB] | <platformId> <deviceId> sparse [rows cols density n] | <platformId> <deviceId> quantized [M N K] | all [M N K] | cpu [size]";
+        return 0;
+    }
+    std::vector<cl::Platform> platforms;
+    std::vector<cl::Device> devices;
+    try {
+        cl::Platform::get(&platforms);
+        platforms.at(atoi(argv[1])).getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    } catch (const std::exception& e) {
+        // Нет подходящего openCL устройства - считаем на CPU
+        std::cout << "no openCL device available (" << e.what() << "), falling back to CPU" << std::endl;
+        return runOnCpu(1024);
+    }
+
+    auto device = devices.at(atoi(argv[2]));
+
+    cl::Context context { device };
+    if (argc > 3 && argv[3] == "batch"sv) {
+        return runBatched(context, device, argc > 4 ? atoi(argv[4]) : 1 << 20,
+                          argc > 7 ? atoi(argv[5]) : 3,
+                          argc > 7 ? atoi(argv[6]) : 3,
+                          argc > 7 ? atoi(argv[7]) : 3);
+    }
+    if (argc > 6 && argv[3] == "file"sv) {
+        return runOutOfCore(context, device, argv[4], argv[5], argv[6],
+                            static_cast<size_t>(argc > 7 ? atoi(argv[7]) : 256) << 20);
+    }
+    if (argc > 3 && argv[3] == "ooc"sv) {
+        // Операнды создаются в текущем каталоге
+        const int M = argc > 6 ? atoi(argv[4]) : 4096;
+        const int N = argc > 6 ? atoi(argv[5]) : 4096;
+        const int K = argc > 6 ? atoi(argv[6]) : 4096;
+        writeOperandFiles(M, N, K, "ooc_a.mat", "ooc_b.mat");
+        return runOutOfCore(context, device, "ooc_a.mat", "ooc_b.mat", "ooc_c.mat",
+                            static_cast<size_t>(argc > 7 ? atoi(argv[7]) : 64) << 20);
+    }
+    if (argc > 3 && argv[3] == "sgemm"sv) {
+        return runSgemm(context, device, argc > 6 ? atoi(argv[4]) : 100,
+                        argc > 6 ? atoi(argv[5]) : 70,
+                        argc > 6 ? atoi(argv[6]) : 90);
+    }
+    if (argc > 3 && argv[3] == "quantized"sv) {
+        return runQuantized(context, device, argc > 6 ? atoi(argv[4]) : 1024,
+                            argc > 6 ? atoi(argv[5]) : 1024,
+                            argc > 6 ? atoi(argv[6]) : 1024);
+    }
+    if (argc > 3 && argv[3] == "sparse"sv) {
+        return runSparse(context, device, argc > 7 ? atoi(argv[4]) : 4096,
+                         argc > 7 ? atoi(argv[5]) : 4096,
+                         argc > 7 ? atof(argv[6]) : 0.01,
+                         argc > 7 ? atoi(argv[7]) : 16);
+    }
+    if (argc > 3 && argv[3] == "graph"sv) {
+        return runGraph(context, device, argc > 6 ? atoi(argv[4]) : 512,
+                        argc > 6 ? atoi(argv[5]) : 512,
+                        argc > 6 ? atoi(argv[6]) : 512);
+    }
+    cl::CommandQueue queue { context, device, traceQueueProperties() };
+
+    // Остальные аргументы: размеры M N K и флаги tune, copy, zerocopy.
+    // Режим без копирования выбирается по умолчанию для устройств с общей с хостом памятью
+    std::vector<int> dims;
+    bool tune = false;
+    bool zeroCopy = device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE;
+    for (int i = 3; i < argc; ++i) {
+        if (argv[i] == "tune"sv) {
+            tune = true;
+        } else if (argv[i] == "copy"sv) {
+            zeroCopy = false;
+        } else if (argv[i] == "zerocopy"sv) {
+            zeroCopy = true;
+        } else {
+            dims.push_back(atoi(argv[i]));
+        }
+    }
+    const int M = dims.size() == 3 ? dims[0] : 3;
+    const int N = dims.size() == 3 ? dims[1] : 3;
+    const int K = dims.size() == 3 ? dims[2] : 3;
+
+    // Конфигурация берется из базы подбора; режим tune подбирает ее заново и сохраняет
+    GemmTuner tuner { GemmTuner::defaultPath() };
+    GemmConfig config;
+    if (tune) {
+        GemmTuneOptions options;
+        options.log = &std::cout;
+        config = tuner.tune(context, device, M, N, K, options);
+        tuner.save();
+    } else if (!tuner.find(device, M, N, K, config)) {
+        std::cout << "no tuned GEMM config for " << GemmTuner::shapeBucket(M, N, K)
+                  << ", using defaults (run with 'tune' to tune)" << std::endl;
+    }
+    std::cout << "GEMM config: " << config.buildOptions() << std::endl;
+    std::cout << "mode: " << (zeroCopy ? "zero-copy (CL_MEM_USE_HOST_PTR + map)" : "copy (pooled buffers, write + read)")
+              << std::endl;
+    BufferPool pool { context };
+    Gemm gemm { context, device, config, &pool };
+
+    // Память выровнена по странице, поэтому в режиме без копирования буферы работают прямо с ней
+    HostVector<float> matrixAHost, matrixBHost;
+    fillOperands(M, N, K, matrixAHost, matrixBHost);
+    HostVector<float> matrixCHost ( M * N );
+
+    // do same on cpu: матрицы на устройстве хранятся по столбцам,
+    // а C^T = B^T * A^T в построчном формате совпадает с C по столбцам
+    std::vector<float> matC ( matrixCHost.size() );
+    {
+        TraceScope scope { "CPU reference" };
+        cpuGemm(N, M, K, matrixBHost.data(), K, matrixAHost.data(), M, matC.data(), M);
+    }
+
+    // Умножение выполняется дважды: в режиме копирования второй запуск берет буферы, возвращенные в пул первым
+    using Clock = std::chrono::steady_clock;
+    for (int run = 1; run <= 2; ++run) {
+        auto start = Clock::now();
+        const unsigned long long createBegin = traceHostNow();
+        cl::Buffer matrixA, matrixB, matrixC;
+        if (zeroCopy) {
+            // Буферы привязаны к памяти хоста и не могут браться из пула
+            matrixA = cl::Buffer { context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+                                   sizeof(float) * matrixAHost.size(), matrixAHost.data() };
+            matrixB = cl::Buffer { context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+                                   sizeof(float) * matrixBHost.size(), matrixBHost.data() };
+            matrixC = cl::Buffer { context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
+                                   sizeof(float) * matrixCHost.size(), matrixCHost.data() };
+        } else {
+            matrixA = pool.acquire(sizeof(float) * matrixAHost.size(), CL_MEM_READ_ONLY);
+            matrixB = pool.acquire(sizeof(float) * matrixBHost.size(), CL_MEM_READ_ONLY);
+            matrixC = pool.acquire(sizeof(float) * matrixCHost.size(), CL_MEM_WRITE_ONLY);
+            cl::Event writtenA, writtenB;
+            queue.enqueueWriteBuffer(matrixA, CL_TRUE, 0, sizeof(float) * matrixAHost.size(), matrixAHost.data(),
+                                     nullptr, &writtenA);
+            traceCommand(writtenA, "write A");
+            queue.enqueueWriteBuffer(matrixB, CL_TRUE, 0, sizeof(float) * matrixBHost.size(), matrixBHost.data(),
+                                     nullptr, &writtenB);
+            traceCommand(writtenB, "write B");
+        }
+        traceHostSpan("create buffers", createBegin, traceHostNow());
+        std::chrono::duration<double, std::milli> writeTime = Clock::now() - start;
+
+        start = Clock::now();
+        cl::Event multiplied = gemm.enqueue(queue, M, N, K, matrixA, matrixB, matrixC);
+        multiplied.wait();
+        std::chrono::duration<double, std::milli> executeTime = Clock::now() - start;
+
+        // В режиме без копирования результат уже в памяти хоста, буфер только отображается
+        start = Clock::now();
+        const float* result = matrixCHost.data();
+        cl::Event read;
+        if (zeroCopy) {
+            result = static_cast<const float*>(queue.enqueueMapBuffer(matrixC, CL_TRUE, CL_MAP_READ,
+                                                                      0, sizeof(float) * matrixCHost.size(),
+                                                                      nullptr, &read));
+        } else {
+            queue.enqueueReadBuffer(matrixC, CL_TRUE, 0, matrixCHost.size() * sizeof(float), matrixCHost.data(),
+                                    nullptr, &read);
+        }
+        traceCommand(read, zeroCopy ? "map C" : "read C");
+        std::chrono::duration<double, std::milli> readTime = Clock::now() - start;
+
+        std::cout << "run " << run << ": total time " << (writeTime + executeTime + readTime).count() << " ms"
+                  << std::endl
+                  << "\twrite:\t\t" << writeTime.count() << " ms" << std::endl
+                  << "\texecute:\t" << executeTime.count() << " ms" << std::endl
+                  << (zeroCopy ? "\tmap:\t\t" : "\tread back:\t") << readTime.count() << " ms" << std::endl;
+
+        {
+            TraceScope scope { "verify" };
+            requireValid("gemm", result, matC.data(), matC.size(), gemmTolerance(K));
+        }
+        if (zeroCopy) {
+            cl::Event unmapped;
+            queue.enqueueUnmapMemObject(matrixC, const_cast<float*>(result), nullptr, &unmapped);
+            traceCommand(unmapped, "unmap C");
+            queue.finish();
+        } else {
+            pool.release(matrixA, { multiplied });
+            pool.release(matrixB, { multiplied });
+            pool.release(matrixC, { read });
+        }
+    }
+    std::cout << M << "x" << N << "x" << K << ": OK" << std::endl;
+    printProgramCacheStats();
+    printBufferPoolStats(pool.stats());
 }
 
 /*!
@@ -0,0 +1,157 @@
+/*!
+  * \addtogroup multi_device_gemm
+  * @{
+  */
+
+#include "multi_device_gemm.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr int PANEL_SLOTS = 2;  //< буферов B и C на устройство (двойная буферизация панелей)
+
+} // namespace
+
+MultiDeviceGemm::MultiDeviceGemm(const std::vector<cl::Device>& devices, const GemmTuner* tuner)
+    : devices { devices }, tuner { tuner } {
+    for (const auto& device : devices) {
+        contexts.emplace_back(device);
+        pools.push_back(std::make_unique<BufferPool>(contexts.back()));
+    }
+}
+
+BufferPoolStats MultiDeviceGemm::bufferPoolStats(size_t device) const {
+    return pools.at(device)->stats();
+}
+
+std::vector<DeviceThroughput> MultiDeviceGemm::multiply(int M, int N, int K, const float* a, const float* b, float* c,
+                                                        int panelWidth) {
+    if (panelWidth <= 0) {
+        // Около 4 панелей на устройство, ширина кратна блоку по умолчанию
+        const int tile = GemmConfig {}.tileN;
+        const int target = (N + 4 * static_cast<int>(devices.size()) - 1) / (4 * static_cast<int>(devices.size()));
+        panelWidth = std::max(tile, (target + tile - 1) / tile * tile);
+    }
+    panelWidth = std::min(panelWidth, N);
+    const int panelCount = (N + panelWidth - 1) / panelWidth;
+
+    std::atomic<int> nextPanel { 0 };
+    std::vector<DeviceThroughput> stats ( devices.size() );
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto worker = [&](size_t index) {
+        const cl::Device& device = devices[index];
+        DeviceThroughput& stat = stats[index];
+        const auto start = std::chrono::steady_clock::now();
+        // Записи A, B и чтения C неблокирующие: при ошибке очереди нужно завершить, пока память хоста
+        // и буферы панелей еще живы
+        cl::CommandQueue queues[PANEL_SLOTS];
+        try {
+            stat.device = device.getInfo<CL_DEVICE_NAME>();
+            const cl::Context& context = contexts[index];
+            BufferPool& pool = *pools[index];
+            // Своя очередь на слот: запись следующей панели и чтение предыдущей идут во время вычисления текущей
+            for (auto& queue : queues) {
+                queue = cl::CommandQueue { context, device, traceQueueProperties() };
+            }
+
+            GemmConfig config;
+            if (tuner != nullptr) {
+                tuner->find(device, M, panelWidth, K, config);
+            }
+            // Буферы панелей и временные буферы дополнения переиспользуются между панелями и вызовами multiply
+            Gemm gemm { context, device, config, &pool };
+
+            // Столбцы B и C в column-major непрерывны, поэтому панель - это непрерывный участок памяти
+            const size_t bytesA = sizeof(float) * M * K;
+            cl::Buffer bufferA = pool.acquire(bytesA, CL_MEM_READ_ONLY);
+            std::vector<cl::Event> usesA;
+            cl::Event writtenA;
+            queues[0].enqueueWriteBuffer(bufferA, CL_FALSE, 0, bytesA, a, nullptr, &writtenA);
+            traceCommand(writtenA, "write A");
+            const std::vector<cl::Event> waitA { writtenA };
+
+            cl::Event reads[PANEL_SLOTS];
+            for (int slot = 0; ; slot = (slot + 1) % PANEL_SLOTS) {
+                // Слот свободен после чтения его прошлой панели; на устройстве не больше PANEL_SLOTS панелей,
+                // поэтому медленное устройство не забирает панели впрок
+                if (reads[slot]() != nullptr) {
+                    reads[slot].wait();
+                }
+                const int panel = nextPanel++;
+                if (panel >= panelCount) {
+                    break;
+                }
+                const int column = panel * panelWidth;
+                const int width = std::min(panelWidth, N - column);
+                cl::CommandQueue& queue = queues[slot];
+                cl::Buffer bufferB = pool.acquire(sizeof(float) * K * width, CL_MEM_READ_ONLY);
+                cl::Buffer bufferC = pool.acquire(sizeof(float) * M * width, CL_MEM_WRITE_ONLY);
+                cl::Event written;
+                queue.enqueueWriteBuffer(bufferB, CL_FALSE, 0, sizeof(float) * K * width,
+                                         b + static_cast<size_t>(column) * K, nullptr, &written);
+                traceCommand(written, "write B panel");
+                // A записывается через первую очередь, вторая дожидается записи по событию
+                const cl::Event product = gemm.enqueue(queue, M, width, K, bufferA, bufferB, bufferC,
+                                                       slot == 0 ? nullptr : &waitA);
+                queue.enqueueReadBuffer(bufferC, CL_FALSE, 0, sizeof(float) * M * width,
+                                        c + static_cast<size_t>(column) * M, nullptr, &reads[slot]);
+                traceCommand(reads[slot], "read C panel");
+                usesA.push_back(product);
+                pool.release(bufferB, { product });
+                pool.release(bufferC, { reads[slot] });
+                ++stat.panels;
+                stat.columns += width;
+            }
+            pool.release(bufferA, usesA.empty() ? std::vector<cl::Event> { writtenA } : usesA);
+            for (auto& queue : queues) {
+                queue.finish();
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock { errorMutex };
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            // Остальные устройства должны прекратить брать панели
+            nextPanel = panelCount;
+            for (auto& queue : queues) {
+                try {
+                    if (queue() != nullptr) {
+                        queue.finish();
+                    }
+                } catch (const cl::Error&) {
+                    // Ошибка уже сохранена, команды очереди больше не обращаются к памяти хоста
+                }
+            }
+        }
+        stat.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stat.gflops = stat.seconds > 0.0 ? 2.0 * M * stat.columns * K / stat.seconds / 1e9 : 0.0;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return stats;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,71 @@
+/*!
+  * \defgroup multi_device_gemm Умножение матриц на нескольких устройствах
+  *
+  * Матрица C делится на панели столбцов, которые устройства забирают из общей очереди:
+  * более быстрые устройства успевают обработать больше панелей. Для каждого устройства создаются
+  * свои контекст, пул буферов и Gemm, работа с устройством ведется из отдельного потока.
+  * Контексты и пулы создаются один раз, поэтому повторные вызовы multiply берут буферы из пула.
+  * Панели устройства чередуются между двумя наборами буферов и очередей, поэтому передача одной панели
+  * идет одновременно с вычислением другой.
+  * @{
+  */
+
+#pragma once
+
+#include "gemm.hpp"
+#include "gemm_tuner.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief DeviceThroughput Доля работы и производительность одного устройства
+ */
+struct DeviceThroughput {
+    std::string device;
+    int panels = 0;         //< обработано панелей
+    int columns = 0;        //< обработано столбцов C
+    double seconds = 0.0;   //< время работы потока устройства, включая передачу данных
+    double gflops = 0.0;
+};
+
+/*!
+ * \brief MultiDeviceGemm Умножение матриц, распределенное между устройствами
+ *
+ * Результат совпадает с результатом Gemm на одном устройстве побитово: порядок суммирования
+ * каждого элемента C не зависит от конфигурации kernel'я и разбиения на панели.
+ */
+class MultiDeviceGemm {
+public:
+    /*!
+     * \param [in] devices Устройства (могут принадлежать разным платформам)
+     * \param [in] tuner База подобранных конфигураций (может быть nullptr - тогда используются значения по умолчанию)
+     * \throws cl::Error Если для устройства не создается контекст
+     */
+    explicit MultiDeviceGemm(const std::vector<cl::Device>& devices, const GemmTuner* tuner = nullptr);
+
+    /*!
+     * \brief multiply Вычисляет C = A * B для матриц в памяти хоста (column-major)
+     *
+     * \param [in] panelWidth Ширина панели в столбцах; 0 - выбрать автоматически
+     * \return Статистика по каждому устройству в порядке devices
+     */
+    std::vector<DeviceThroughput> multiply(int M, int N, int K, const float* a, const float* b, float* c,
+                                           int panelWidth = 0);
+
+    /*!
+     * \brief bufferPoolStats Статистика пула буферов устройства с индексом device
+     */
+    BufferPoolStats bufferPoolStats(size_t device) const;
+
+private:
+    std::vector<cl::Device> devices;
+    const GemmTuner* tuner;
+    std::vector<cl::Context> contexts;
+    std::vector<std::unique_ptr<BufferPool>> pools;
+};
+
+/*!
+ * @}
+ */
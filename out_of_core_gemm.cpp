@@ -0,0 +1,147 @@
+/*!
+  * \addtogroup out_of_core_gemm
+  * @{
+  */
+
+#include "out_of_core_gemm.hpp"
+#include "device_vector.hpp"
+#include "host_memory.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr int TILE_STEP = 16;
+constexpr size_t WINDOW_PAGE = 4096;
+
+/*!
+ * \brief hostBytes Память хоста при квадратном блоке tile: по два буфера панелей A и B, буфер блока C
+ *                  и окно файла (блок плюс неполные страницы по краям каждой строки или столбца)
+ */
+size_t hostBytes(size_t tile) {
+    return sizeof(float) * tile * tile * 5 + sizeof(float) * tile * tile + WINDOW_PAGE * tile;
+}
+
+} // namespace
+
+int OutOfCoreGemm::tileSize(size_t tileBudget) {
+    if (hostBytes(TILE_STEP) > tileBudget) {
+        throw std::invalid_argument { "memory budget of " + std::to_string(tileBudget) +
+                                      " bytes cannot hold the smallest tile of " + std::to_string(TILE_STEP) };
+    }
+    size_t tile = TILE_STEP;
+    while (hostBytes(tile + TILE_STEP) <= tileBudget) {
+        tile += TILE_STEP;
+    }
+    return static_cast<int>(tile);
+}
+
+OutOfCoreGemm::OutOfCoreGemm(const cl::Context& context, const cl::Device& device, size_t tileBudget,
+                             const GemmConfig& config)
+    : context { context }, queue { context, device, traceQueueProperties() }, budget { tileBudget },
+      pool { context }, gemm { context, device, config, &pool } {
+    tileSize(budget);
+}
+
+OutOfCoreStats OutOfCoreGemm::multiply(const MatrixFile& a, const MatrixFile& b, MatrixFile& c) {
+    if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+        throw std::invalid_argument { "matrix dimensions do not match" };
+    }
+    const uint64_t M = a.rows();
+    const uint64_t N = b.cols();
+    const uint64_t K = a.cols();
+
+    OutOfCoreStats stats;
+    if (M == 0 || N == 0 || K == 0) {
+        // Файл C создается заполненным нулями
+        return stats;
+    }
+    const int tile = tileSize(budget);
+    stats.tileM = static_cast<int>(std::min<uint64_t>(tile, M));
+    stats.tileN = static_cast<int>(std::min<uint64_t>(tile, N));
+    stats.tileK = static_cast<int>(std::min<uint64_t>(tile, K));
+    const size_t panelA = static_cast<size_t>(stats.tileM) * stats.tileK;
+    const size_t panelB = static_cast<size_t>(stats.tileK) * stats.tileN;
+    const size_t block = static_cast<size_t>(stats.tileM) * stats.tileN;
+
+    // Два набора панелей: хост заполняет один, пока запись из другого еще не завершена
+    std::array<HostVector<float>, 2> stageA { HostVector<float> ( panelA ), HostVector<float> ( panelA ) };
+    std::array<HostVector<float>, 2> stageB { HostVector<float> ( panelB ), HostVector<float> ( panelB ) };
+    HostVector<float> stageC ( block );
+    std::array<cl::Buffer, 2> deviceA { pool.acquire(sizeof(float) * panelA, CL_MEM_READ_ONLY),
+                                        pool.acquire(sizeof(float) * panelA, CL_MEM_READ_ONLY) };
+    std::array<cl::Buffer, 2> deviceB { pool.acquire(sizeof(float) * panelB, CL_MEM_READ_ONLY),
+                                        pool.acquire(sizeof(float) * panelB, CL_MEM_READ_ONLY) };
+    cl::Buffer deviceC = pool.acquire(sizeof(float) * block);
+    cl::Buffer partial = pool.acquire(sizeof(float) * block);
+    std::array<std::vector<cl::Event>, 2> written;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t j0 = 0; j0 < N; j0 += stats.tileN) {
+        const int n = static_cast<int>(std::min<uint64_t>(stats.tileN, N - j0));
+        for (uint64_t i0 = 0; i0 < M; i0 += stats.tileM) {
+            const int m = static_cast<int>(std::min<uint64_t>(stats.tileM, M - i0));
+            bool first = true;
+            for (uint64_t k0 = 0; k0 < K; k0 += stats.tileK, ++stats.steps) {
+                const int k = static_cast<int>(std::min<uint64_t>(stats.tileK, K - k0));
+                const size_t slot = stats.steps % 2;
+                if (!written[slot].empty()) {
+                    cl::Event::waitForEvents(written[slot]);
+                }
+                {
+                    TraceScope scope { "read panels" };
+                    a.readBlock(i0, k0, m, k, stageA[slot].data(), m);
+                    b.readBlock(k0, j0, k, n, stageB[slot].data(), k);
+                }
+                stats.bytesRead += sizeof(float) * (static_cast<uint64_t>(m) * k + static_cast<uint64_t>(k) * n);
+
+                written[slot].assign(2, cl::Event {});
+                queue.enqueueWriteBuffer(deviceA[slot], CL_FALSE, 0, sizeof(float) * m * k, stageA[slot].data(),
+                                         nullptr, &written[slot][0]);
+                queue.enqueueWriteBuffer(deviceB[slot], CL_FALSE, 0, sizeof(float) * k * n, stageB[slot].data(),
+                                         nullptr, &written[slot][1]);
+                traceCommand(written[slot][0], "write A panel");
+                traceCommand(written[slot][1], "write B panel");
+                // Очередь выполняет команды по порядку, поэтому умножение и сложение ждут записи без событий
+                gemm.enqueue(queue, m, n, k, deviceA[slot], deviceB[slot], first ? deviceC : partial);
+                if (!first) {
+                    enqueueFused(queue, "float", nullptr, 4, ", const global TYPE* c, const global TYPE* p",
+                                 "AT(c) + AT(p)", static_cast<size_t>(m) * n, [&](cl::Kernel& kernel) {
+                                     kernel.setArg(1, deviceC);
+                                     kernel.setArg(2, partial);
+                                     kernel.setArg(3, deviceC);
+                                 });
+                }
+                queue.flush();
+                first = false;
+            }
+            cl::Event read;
+            queue.enqueueReadBuffer(deviceC, CL_TRUE, 0, sizeof(float) * m * n, stageC.data(), nullptr, &read);
+            traceCommand(read, "read C tile");
+            TraceScope scope { "write C tile" };
+            c.writeBlock(i0, j0, m, n, stageC.data(), m);
+            stats.bytesWritten += sizeof(float) * static_cast<uint64_t>(m) * n;
+            ++stats.tiles;
+        }
+    }
+    queue.finish();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats.seconds = elapsed.count();
+
+    for (size_t slot = 0; slot < 2; ++slot) {
+        pool.release(deviceA[slot]);
+        pool.release(deviceB[slot]);
+    }
+    pool.release(deviceC);
+    pool.release(partial);
+    return stats;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,76 @@
+/*!
+  * \defgroup out_of_core_gemm Умножение матриц, не помещающихся в память
+  *
+  * C = A * B для матриц в файлах (см. matrix_file). C делится на блоки tileM x tileN, для каждого блока
+  * панели A (tileM x tileK) и B (tileK x tileN) по очереди копируются из отображенных файлов в буферы хоста,
+  * передаются на устройство и накапливаются в блоке C на устройстве. Готовый блок записывается в файл C.
+  * Пока устройство умножает одну пару панелей, хост копирует следующую (по два буфера на каждую панель).
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include "buffer_pool.hpp"
+#include "gemm.hpp"
+#include "matrix_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief OutOfCoreStats Размеры блоков и объем переданных данных
+ */
+struct OutOfCoreStats {
+    int tileM = 0;
+    int tileN = 0;
+    int tileK = 0;
+    uint64_t tiles = 0;         //< блоков C
+    uint64_t steps = 0;         //< умноженных пар панелей
+    uint64_t bytesRead = 0;     //< прочитано из файлов A и B
+    uint64_t bytesWritten = 0;  //< записано в файл C
+    double seconds = 0.0;
+};
+
+/*!
+ * \brief OutOfCoreGemm Умножение матриц из файлов блоками с ограниченным объемом памяти хоста
+ *
+ * Память хоста, занятая буферами панелей и отображенными окнами файлов, не превышает tileBudget
+ * независимо от размеров матриц.
+ */
+class OutOfCoreGemm {
+public:
+    /*!
+     * \param [in] tileBudget Ограничение памяти хоста на блоки в байтах
+     * \throws std::invalid_argument Если в tileBudget не помещается минимальный блок 16 x 16 x 16
+     */
+    OutOfCoreGemm(const cl::Context& context, const cl::Device& device, size_t tileBudget,
+                  const GemmConfig& config = GemmConfig {});
+
+    /*!
+     * \brief multiply Вычисляет C = A * B
+     *
+     * \param [out] c Файл, открытый для записи, размером a.rows() x b.cols()
+     * \throws std::invalid_argument Если размеры матриц не согласованы
+     */
+    OutOfCoreStats multiply(const MatrixFile& a, const MatrixFile& b, MatrixFile& c);
+
+    /*!
+     * \brief tileSize Наибольший размер блока (кратный 16), при котором буферы и окна укладываются в tileBudget
+     * \throws std::invalid_argument Если не укладывается даже блок 16
+     */
+    static int tileSize(size_t tileBudget);
+
+private:
+    cl::Context context;
+    cl::CommandQueue queue;
+    size_t budget;
+    BufferPool pool;
+    Gemm gemm;
+};
+
+/*!
+ * @}
+ */
@@ -0,0 +1,296 @@
+/*!
+  * \addtogroup program_cache
+  * @{
+  */
+
+#include "program_cache.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char cacheMagic[8] = { 'C', 'L', 'P', 'C', 'A', 'C', 'H', '1' };
+
+static atomic_size_t cacheHits;
+static atomic_size_t cacheMisses;
+static atomic_size_t cacheInvalidated;
+
+/*!
+ * \brief fnv1a Хэш FNV-1a (64 бита), продолжающий хэш hash
+ */
+static uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/*!
+ * \brief getDeviceString Возвращает строковый параметр устройства (память выделяется через malloc)
+ */
+static char* getDeviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, param, 0, NULL, &size) != CL_SUCCESS) {
+        size = 0;
+    }
+    char* value = (char*) malloc(size + 1);
+    if (size > 0) {
+        clGetDeviceInfo(device, param, size, value, NULL);
+    }
+    value[size] = '\0';
+    return value;
+}
+
+/*!
+ * \brief makeKey Составляет ключ записи: параметры устройства и драйвера, хэш исходного кода, опции
+ */
+static char* makeKey(cl_device_id device, const char* source, const char* options) {
+    char* name = getDeviceString(device, CL_DEVICE_NAME);
+    char* vendor = getDeviceString(device, CL_DEVICE_VENDOR);
+    char* version = getDeviceString(device, CL_DEVICE_VERSION);
+    char* driver = getDeviceString(device, CL_DRIVER_VERSION);
+    const uint64_t sourceHash = fnv1a(14695981039346656037ull, source, strlen(source));
+
+    const char* format = "device=%s\nvendor=%s\nversion=%s\ndriver=%s\nsource=%016llx\noptions=%s\n";
+    const int size = snprintf(NULL, 0, format, name, vendor, version, driver,
+                              (unsigned long long) sourceHash, options);
+    char* key = (char*) malloc((size_t) size + 1);
+    snprintf(key, (size_t) size + 1, format, name, vendor, version, driver,
+             (unsigned long long) sourceHash, options);
+
+    free(name);
+    free(vendor);
+    free(version);
+    free(driver);
+    return key;
+}
+
+/*!
+ * \brief makeDirectories Создает каталог path вместе с родительскими каталогами
+ */
+static int makeDirectories(const char* path) {
+    char* copy = strdup(path);
+    for (char* p = copy + 1; *p != '\0'; ++p) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(copy, 0755) != 0 && errno != EEXIST) {
+                free(copy);
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    const int result = mkdir(copy, 0755) != 0 && errno != EEXIST ? -1 : 0;
+    free(copy);
+    return result;
+}
+
+/*!
+ * \brief getCacheDirectory Каталог кэша или NULL, если кэш отключен (память выделяется через malloc)
+ */
+static char* getCacheDirectory(void) {
+    const char* mode = getenv("OCL_PROGRAM_CACHE");
+    if (mode != NULL && strcmp(mode, "off") == 0) {
+        return NULL;
+    }
+    const char* dir = getenv("OCL_PROGRAM_CACHE_DIR");
+    if (dir != NULL && *dir != '\0') {
+        return strdup(dir);
+    }
+    const char* base = getenv("XDG_CACHE_HOME");
+    const char* suffix = "/ProgrammingTechnologiesOpenCL";
+    if (base == NULL || *base == '\0') {
+        base = getenv("HOME");
+        suffix = "/.cache/ProgrammingTechnologiesOpenCL";
+    }
+    if (base == NULL || *base == '\0') {
+        return NULL;
+    }
+    char* path = (char*) malloc(strlen(base) + strlen(suffix) + 1);
+    strcpy(path, base);
+    strcat(path, suffix);
+    return path;
+}
+
+/*!
+ * \brief readEntry Читает бинарный образ из файла, если ключ записи совпадает с key
+ * \return Образ (память выделяется через malloc) или NULL. *corrupted выставляется, если файл существует, но не подходит
+ */
+static unsigned char* readEntry(const char* path, const char* key, size_t* binarySize, int* corrupted) {
+    *corrupted = 0;
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    *corrupted = 1;
+    struct stat info;
+    const uint64_t fileSize = fstat(fileno(file), &info) == 0 ? (uint64_t) info.st_size : 0;
+    unsigned char* binary = NULL;
+    char magic[sizeof(cacheMagic)];
+    uint64_t keySize, size;
+    char* storedKey = NULL;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, cacheMagic, sizeof(magic)) != 0
+            || fread(&keySize, sizeof(keySize), 1, file) != 1 || keySize != strlen(key)) {
+        goto done;
+    }
+    storedKey = (char*) malloc(keySize);
+    if (fread(storedKey, 1, keySize, file) != keySize || memcmp(storedKey, key, keySize) != 0
+            || fread(&size, sizeof(size), 1, file) != 1 || size == 0 || size > fileSize) {
+        goto done;
+    }
+    binary = (unsigned char*) malloc(size);
+    // Лишние байты в конце файла также означают повреждение
+    if (fread(binary, 1, size, file) != size || fgetc(file) != EOF) {
+        free(binary);
+        binary = NULL;
+        goto done;
+    }
+    *binarySize = size;
+    *corrupted = 0;
+done:
+    free(storedKey);
+    fclose(file);
+    return binary;
+}
+
+/*!
+ * \brief writeEntry Записывает образ во временный файл и атомарно переименовывает его в path
+ */
+static void writeEntry(const char* path, const char* key, const unsigned char* binary, size_t binarySize) {
+    char tmp[strlen(path) + 32];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long) getpid());
+    FILE* file = fopen(tmp, "wb");
+    if (file == NULL) {
+        return;
+    }
+    const uint64_t keySize = strlen(key);
+    const uint64_t size = binarySize;
+    int ok = fwrite(cacheMagic, 1, sizeof(cacheMagic), file) == sizeof(cacheMagic)
+            && fwrite(&keySize, sizeof(keySize), 1, file) == 1
+            && fwrite(key, 1, keySize, file) == keySize
+            && fwrite(&size, sizeof(size), 1, file) == 1
+            && fwrite(binary, 1, binarySize, file) == binarySize;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+    }
+}
+
+/*!
+ * \brief loadFromBinary Создает и собирает программу из бинарного образа
+ * \return Программа или NULL, если драйвер отказался ее загрузить
+ */
+static cl_program loadFromBinary(cl_context context, cl_device_id device, const unsigned char* binary,
+                                 size_t binarySize, const char* options) {
+    cl_int status, err;
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &binarySize, &binary, &status, &err);
+    if (err != CL_SUCCESS || status != CL_SUCCESS) {
+        if (program != NULL) {
+            clReleaseProgram(program);
+        }
+        return NULL;
+    }
+    if (clBuildProgram(program, 1, &device, options, NULL, NULL) != CL_SUCCESS) {
+        clReleaseProgram(program);
+        return NULL;
+    }
+    return program;
+}
+
+/*!
+ * \brief storeBinary Получает образ собранной программы и сохраняет его в кэш
+ */
+static void storeBinary(cl_program program, const char* path, const char* key) {
+    size_t binarySize = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, NULL) != CL_SUCCESS
+            || binarySize == 0) {
+        return;
+    }
+    unsigned char* binary = (unsigned char*) malloc(binarySize);
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binary, NULL) == CL_SUCCESS) {
+        writeEntry(path, key, binary, binarySize);
+    }
+    free(binary);
+}
+
+cl_program buildProgramCached(cl_context context, cl_device_id device,
+                              const char* source, const char* options, cl_int* err) {
+    cl_int localErr;
+    if (err == NULL) {
+        err = &localErr;
+    }
+    if (options == NULL) {
+        options = "";
+    }
+
+    char* dir = getCacheDirectory();
+    char* key = NULL;
+    char* path = NULL;
+    if (dir != NULL && makeDirectories(dir) == 0) {
+        key = makeKey(device, source, options);
+        const uint64_t hash = fnv1a(14695981039346656037ull, key, strlen(key));
+        path = (char*) malloc(strlen(dir) + 32);
+        sprintf(path, "%s/%016llx.clbin", dir, (unsigned long long) hash);
+
+        size_t binarySize = 0;
+        int corrupted = 0;
+        unsigned char* binary = readEntry(path, key, &binarySize, &corrupted);
+        cl_program program = NULL;
+        if (binary != NULL) {
+            program = loadFromBinary(context, device, binary, binarySize, options);
+            corrupted = program == NULL;
+            free(binary);
+        }
+        if (corrupted) {
+            // Запись повреждена, принадлежит другому ключу или не принимается драйвером
+            remove(path);
+            atomic_fetch_add(&cacheInvalidated, 1);
+        }
+        if (program != NULL) {
+            atomic_fetch_add(&cacheHits, 1);
+            free(dir);
+            free(key);
+            free(path);
+            *err = CL_SUCCESS;
+            return program;
+        }
+    }
+    atomic_fetch_add(&cacheMisses, 1);
+
+    const size_t length = strlen(source);
+    cl_program program = clCreateProgramWithSource(context, 1, &source, &length, err);
+    if (*err == CL_SUCCESS) {
+        *err = clBuildProgram(program, 1, &device, options, NULL, NULL);
+        if (*err == CL_SUCCESS && path != NULL) {
+            storeBinary(program, path, key);
+        }
+    }
+    free(dir);
+    free(key);
+    free(path);
+    return program;
+}
+
+ProgramCacheStats getProgramCacheStats(void) {
+    ProgramCacheStats stats = {
+        atomic_load(&cacheHits),
+        atomic_load(&cacheMisses),
+        atomic_load(&cacheInvalidated),
+    };
+    return stats;
+}
+
+void printProgramCacheStats(void) {
+    const ProgramCacheStats stats = getProgramCacheStats();
+    printf("Program cache: %zu hits, %zu misses, %zu invalidated\n", stats.hits, stats.misses, stats.invalidated);
+}
+
+/*!
+ * @}
+ */
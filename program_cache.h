@@ -0,0 +1,68 @@
+/*!
+  * \defgroup program_cache Кэш скомпилированных программ
+  *
+  * Хранит на диске бинарные образы программ (CL_PROGRAM_BINARIES), чтобы не компилировать
+  * kernel'ы из исходного кода при каждом запуске.
+  *
+  * Ключ записи составляется из имени, производителя и версии устройства, версии драйвера,
+  * хэша исходного кода и опций компиляции. Ключ целиком хранится в файле записи и сверяется при чтении,
+  * поэтому совпадение хэшей имен файлов не приводит к загрузке чужой программы.
+  * Поврежденные записи и записи, которые драйвер отказался загрузить, удаляются и пересобираются из исходного кода.
+  * Запись выполняется во временный файл с последующим переименованием.
+  *
+  * Переменные окружения:
+  *  - OCL_PROGRAM_CACHE_DIR - каталог кэша (по умолчанию $XDG_CACHE_HOME/ProgrammingTechnologiesOpenCL
+  *    или ~/.cache/ProgrammingTechnologiesOpenCL);
+  *  - OCL_PROGRAM_CACHE=off - отключить кэш.
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief ProgramCacheStats Статистика обращений к кэшу с начала работы процесса
+ */
+typedef struct ProgramCacheStats {
+    size_t hits;            //< программа загружена из кэша
+    size_t misses;          //< программа скомпилирована из исходного кода
+    size_t invalidated;     //< записи, удаленные как поврежденные или несовместимые
+} ProgramCacheStats;
+
+/*!
+ * \brief buildProgramCached Создает и компилирует программу для одного устройства, используя кэш
+ *
+ * \param [in] context Контекст
+ * \param [in] device Устройство, для которого компилируется программа
+ * \param [in] source Исходный код программы
+ * \param [in] options Опции компиляции (может быть NULL)
+ * \param [out] err Код ошибки (может быть NULL). При ошибке компиляции программа все равно возвращается,
+ *                  чтобы можно было получить лог компилятора через clGetProgramBuildInfo
+ * \return Программа или NULL, если ее не удалось создать
+ */
+cl_program buildProgramCached(cl_context context, cl_device_id device,
+                              const char* source, const char* options, cl_int* err);
+
+/*!
+ * \brief getProgramCacheStats Возвращает статистику обращений к кэшу
+ */
+ProgramCacheStats getProgramCacheStats(void);
+
+/*!
+ * \brief printProgramCacheStats Выводит статистику обращений к кэшу
+ */
+void printProgramCacheStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
@@ -0,0 +1,38 @@
+/*!
+  * \addtogroup program_cache
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <iostream>
+#include <string>
+
+#include "program_cache.h"
+
+/*!
+ * \brief buildProgramCached Обертка над buildProgramCached для C++ оберток openCL
+ *
+ * \throws cl::Error Если программу не удалось создать или скомпилировать (лог компиляции выводится в std::cerr)
+ */
+inline cl::Program buildProgramCached(const cl::Context& context, const cl::Device& device,
+                                      const std::string& source, const std::string& options = {}) {
+    cl_int err;
+    cl_program program = buildProgramCached(context(), device(), source.c_str(), options.c_str(), &err);
+    if (program == nullptr) {
+        throw cl::Error { err, "clCreateProgramWithSource" };
+    }
+    cl::Program result { program };
+    if (err != CL_SUCCESS) {
+        std::cerr << result.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
+        throw cl::Error { err, "clBuildProgram" };
+    }
+    return result;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,277 @@
+/*!
+  * \addtogroup quantized_gemm
+  * @{
+  */
+
+#include "quantized_gemm.hpp"
+#include "program_cache.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view kernelQuantizedSrc { R"CLC(
+// -D TS= -D TK= и одно из -D INPUT_FLOAT, INPUT_HALF, INPUT_INT8; -D USE_FP16, -D USE_DOT при наличии расширений
+#if defined(INPUT_INT8)
+typedef char QTYPE;             // тип в глобальной памяти
+typedef char LTYPE;             // тип в локальной памяти
+typedef int ACC;
+#define LOAD(p, i) (p)[i]
+#if defined(USE_DOT) && defined(__opencl_c_integer_dot_product_input_4x8bit)
+#define DOT4(x, y) dot(x, y)
+#else
+inline int dot4(char4 x, char4 y) {
+    const int4 p = convert_int4(x) * convert_int4(y);
+    return p.x + p.y + p.z + p.w;
+}
+#define DOT4(x, y) dot4(x, y)
+#endif
+#elif defined(INPUT_HALF)
+#ifdef USE_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#define LOAD(p, i) ((float) (p)[i])
+#else
+#define LOAD(p, i) vload_half(i, p)
+#endif
+typedef half QTYPE;
+typedef float LTYPE;
+typedef float ACC;
+#define DOT4(x, y) dot(x, y)
+#else
+typedef float QTYPE;
+typedef float LTYPE;
+typedef float ACC;
+#define LOAD(p, i) (p)[i]
+#define DOT4(x, y) dot(x, y)
+#endif
+
+// Work-item вычисляет один элемент C. Блоки A и Bt по TS строк и TK элементов K проходят через локальную память
+// (строки дополнены 4 элементами против конфликтов банков), произведения считаются по 4 элемента K
+kernel void quantizedGemm(const int M, const int N, const int K,
+                          const global QTYPE* A, const global float* scaleA,
+                          const global QTYPE* Bt, const global float* scaleB,
+                          global float* C) {
+    local LTYPE As[TS][TK + 4];
+    local LTYPE Bs[TS][TK + 4];
+    const int lc = get_local_id(0);
+    const int lr = get_local_id(1);
+    const int rowBase = get_group_id(1) * TS;
+    const int colBase = get_group_id(0) * TS;
+
+    ACC acc = 0;
+    for (int k0 = 0; k0 < K; k0 += TK) {
+        // Соседние work-item'ы загружают соседние элементы строки, за границами матриц - нули
+        for (int index = lr * TS + lc; index < TS * TK; index += TS * TS) {
+            const int r = index / TK;
+            const int k = index % TK;
+            const bool inK = k0 + k < K;
+            As[r][k] = rowBase + r < M && inK ? LOAD(A, (size_t) (rowBase + r) * K + k0 + k) : 0;
+            Bs[r][k] = colBase + r < N && inK ? LOAD(Bt, (size_t) (colBase + r) * K + k0 + k) : 0;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int k = 0; k < TK; k += 4) {
+            acc += DOT4(vload4(0, &As[lr][k]), vload4(0, &Bs[lc][k]));
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    const int row = rowBase + lr;
+    const int col = colBase + lc;
+    if (row < M && col < N) {
+#if defined(INPUT_INT8)
+        C[(size_t) row * N + col] = (float) acc * scaleA[row] * scaleB[col];
+#else
+        C[(size_t) row * N + col] = acc;
+#endif
+    }
+}
+)CLC"sv };
+
+constexpr const char* INPUT_DEFINES[] = { "INPUT_FLOAT", "INPUT_HALF", "INPUT_INT8" };
+
+/*!
+ * \brief quantize Переводит rows векторов по cols элементов в тип type; элемент j вектора i - x[i * rowStep + j * colStep]
+ */
+QuantizedMatrix quantize(const float* x, int rows, int cols, size_t rowStep, size_t colStep, QuantizedType type) {
+    if (rows <= 0 || cols <= 0) {
+        throw std::invalid_argument { "matrix dimensions must be positive" };
+    }
+    QuantizedMatrix matrix;
+    matrix.type = type;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    const size_t count = static_cast<size_t>(rows) * cols;
+    switch (type) {
+    case QuantizedType::Float:
+        matrix.real.resize(count);
+        break;
+    case QuantizedType::Half:
+        matrix.half.resize(count);
+        break;
+    case QuantizedType::Int8:
+        matrix.int8.resize(count);
+        matrix.scales.resize(rows);
+        break;
+    }
+    for (int i = 0; i < rows; ++i) {
+        const float* row = x + i * rowStep;
+        const size_t out = static_cast<size_t>(i) * cols;
+        if (type == QuantizedType::Int8) {
+            // Симметричное квантование: наибольший по модулю элемент строки переходит в 127
+            float max = 0.0f;
+            for (int j = 0; j < cols; ++j) {
+                max = std::max(max, std::fabs(row[j * colStep]));
+            }
+            const float scale = max > 0.0f ? max / 127.0f : 1.0f;
+            matrix.scales[i] = scale;
+            for (int j = 0; j < cols; ++j) {
+                const float q = std::nearbyint(row[j * colStep] / scale);
+                matrix.int8[out + j] = static_cast<cl_char>(std::clamp(q, -127.0f, 127.0f));
+            }
+        } else {
+            for (int j = 0; j < cols; ++j) {
+                if (type == QuantizedType::Half) {
+                    matrix.half[out + j] = HalfFloat { row[j * colStep] };
+                } else {
+                    matrix.real[out + j] = row[j * colStep];
+                }
+            }
+        }
+    }
+    return matrix;
+}
+
+} // namespace
+
+const void* QuantizedMatrix::data() const {
+    switch (type) {
+    case QuantizedType::Half:
+        return half.data();
+    case QuantizedType::Int8:
+        return int8.data();
+    default:
+        return real.data();
+    }
+}
+
+size_t QuantizedMatrix::bytes() const {
+    return real.size() * sizeof(cl_float) + half.size() * sizeof(HalfFloat) + int8.size() * sizeof(cl_char);
+}
+
+QuantizedMatrix quantizeRows(const float* x, int rows, int cols, QuantizedType type) {
+    return quantize(x, rows, cols, static_cast<size_t>(cols), 1, type);
+}
+
+QuantizedMatrix quantizeColumns(const float* x, int rows, int cols, QuantizedType type) {
+    return quantize(x, cols, rows, 1, static_cast<size_t>(cols), type);
+}
+
+void cpuQuantizedGemm(const QuantizedMatrix& a, const QuantizedMatrix& bt, float* c) {
+    if (a.type != bt.type || a.cols != bt.cols) {
+        throw std::invalid_argument { "operands must have the same type and K" };
+    }
+    const int M = a.rows, N = bt.rows, K = a.cols;
+    ThreadPool::shared().parallelFor(static_cast<size_t>(M), [&](size_t task) {
+        const int i = static_cast<int>(task);
+        const size_t rowA = static_cast<size_t>(i) * K;
+        for (int j = 0; j < N; ++j) {
+            const size_t rowB = static_cast<size_t>(j) * K;
+            if (a.type == QuantizedType::Int8) {
+                int acc = 0;
+                for (int k = 0; k < K; ++k) {
+                    acc += a.int8[rowA + k] * bt.int8[rowB + k];
+                }
+                c[static_cast<size_t>(i) * N + j] = static_cast<float>(acc) * a.scales[i] * bt.scales[j];
+            } else {
+                float acc = 0.0f;
+                for (int k = 0; k < K; ++k) {
+                    acc += a.type == QuantizedType::Half
+                            ? static_cast<float>(a.half[rowA + k]) * static_cast<float>(bt.half[rowB + k])
+                            : a.real[rowA + k] * bt.real[rowB + k];
+                }
+                c[static_cast<size_t>(i) * N + j] = acc;
+            }
+        }
+    });
+}
+
+const char* quantizedTypeName(QuantizedType type) {
+    switch (type) {
+    case QuantizedType::Float:
+        return "float";
+    case QuantizedType::Half:
+        return "half";
+    case QuantizedType::Int8:
+        return "int8";
+    }
+    return "unknown";
+}
+
+QuantizedGemm::QuantizedGemm(const cl::Context& context, const cl::Device& device, QuantizedType type)
+    : inputType { type } {
+    std::string options = " -D TK=" + std::to_string(TILE_K) + " -D " + INPUT_DEFINES[static_cast<int>(type)];
+    if (type == QuantizedType::Int8 && deviceHasExtension(device, "cl_khr_integer_dot_product")) {
+        dotProduct = true;
+        options += " -D USE_DOT";
+    }
+    if (type == QuantizedType::Half && deviceHasExtension(device, "cl_khr_fp16")) {
+        fp16 = true;
+        options += " -D USE_FP16";
+    }
+    // Блок tile x tile должен помещаться в work-group kernel'я: при нехватке регистров или локальной памяти
+    // CL_KERNEL_WORK_GROUP_SIZE бывает меньше TILE * TILE, тогда программа пересобирается с меньшим блоком
+    while (kernel() == nullptr) {
+        cl::Program program = buildProgramCached(context, device, std::string { kernelQuantizedSrc },
+                                                 "-D TS=" + std::to_string(tile) + options);
+        cl::Kernel built { program, "quantizedGemm" };
+        const size_t limit = built.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+        if (static_cast<size_t>(tile) * tile > limit && tile > 1) {
+            tile /= 2;
+            continue;
+        }
+        kernel = built;
+    }
+}
+
+cl::Event QuantizedGemm::enqueue(cl::CommandQueue& queue, int M, int N, int K,
+                                 const cl::Buffer& a, const cl::Buffer* scaleA,
+                                 const cl::Buffer& bt, const cl::Buffer* scaleB,
+                                 const cl::Buffer& c, const std::vector<cl::Event>* events) {
+    if (M <= 0 || N <= 0 || K <= 0) {
+        throw std::invalid_argument { "matrix dimensions must be positive" };
+    }
+    if (inputType == QuantizedType::Int8 && (scaleA == nullptr || scaleB == nullptr)) {
+        throw std::invalid_argument { "int8 inputs need row and column scales" };
+    }
+    if (inputType == QuantizedType::Int8 && K > MAX_INT8_K) {
+        throw std::invalid_argument { "K is too large for int32 accumulation of int8 products" };
+    }
+    kernel.setArg(0, M);
+    kernel.setArg(1, N);
+    kernel.setArg(2, K);
+    kernel.setArg(3, a);
+    // Масштабы не используются для float и half, на их место передаются входы
+    kernel.setArg(4, scaleA != nullptr ? *scaleA : a);
+    kernel.setArg(5, bt);
+    kernel.setArg(6, scaleB != nullptr ? *scaleB : bt);
+    kernel.setArg(7, c);
+    const size_t groupsN = (N + tile - 1) / tile;
+    const size_t groupsM = (M + tile - 1) / tile;
+    cl::Event event;
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange (groupsN * tile, groupsM * tile),
+                               cl::NDRange (tile, tile), events, &event);
+    traceCommand(event, "quantizedGemm");
+    return event;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,145 @@
+/*!
+  * \defgroup quantized_gemm Умножение матриц с пониженной точностью входов
+  *
+  * C = A (M x K) * B (K x N) с входами int8 или half и накоплением в int32 (int8) или float (half), результат - float.
+  * Входы в 2-4 раза меньше float, поэтому в столько же раз меньше памяти устройства и объема чтения.
+  *
+  * int8 - симметричное квантование с масштабом на строку A и на столбец B:
+  * A[i][k] ~ scaleA[i] * qa[i][k], B[k][j] ~ scaleB[j] * qb[k][j], C[i][j] = scaleA[i] * scaleB[j] * sum(qa * qb).
+  * Сумма целая и точная, ошибка результата - только ошибка квантования входов.
+  *
+  * Матрицы хранятся по строкам (row-major), B - транспонированной (N x K), чтобы обе матрицы читались по K
+  * подряд векторами по 4 элемента. Если устройство поддерживает cl_khr_integer_dot_product, произведение
+  * 4 пар int8 считается встроенной функцией dot; при наличии cl_khr_fp16 half читается напрямую как half,
+  * без него - через vload_half (умножение в обоих случаях во float).
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include "device_vector.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * \brief QuantizedType Тип входов
+ */
+enum class QuantizedType { Float, Half, Int8 };
+
+/*!
+ * \brief QuantizedMatrix Матрица rows x cols (по строкам) в одном из типов входа
+ *
+ * Заполнен только вектор, соответствующий type. scales (только Int8) - масштаб каждой строки.
+ */
+struct QuantizedMatrix {
+    QuantizedType type = QuantizedType::Float;
+    int rows = 0;
+    int cols = 0;
+    std::vector<cl_float> real;
+    std::vector<HalfFloat> half;
+    std::vector<cl_char> int8;
+    std::vector<cl_float> scales;
+
+    /*!
+     * \brief data Начало элементов
+     */
+    const void* data() const;
+
+    /*!
+     * \brief bytes Размер элементов в байтах (без масштабов)
+     */
+    size_t bytes() const;
+};
+
+/*!
+ * \brief quantizeRows Переводит матрицу rows x cols (по строкам) в тип type, масштаб int8 - на строку
+ */
+QuantizedMatrix quantizeRows(const float* x, int rows, int cols, QuantizedType type);
+
+/*!
+ * \brief quantizeColumns Переводит матрицу rows x cols (по строкам) в тип type с транспонированием
+ *
+ * Результат - матрица cols x rows, масштаб int8 - на столбец исходной матрицы.
+ */
+QuantizedMatrix quantizeColumns(const float* x, int rows, int cols, QuantizedType type);
+
+/*!
+ * \brief cpuQuantizedGemm Эталон на CPU: C (M x N) = A (M x K) * Bt^T с теми же входами, что на устройстве
+ *
+ * Для int8 результат совпадает с устройством точно (целая сумма, затем те же умножения на масштабы).
+ * Для float и half суммы накапливаются последовательно, а на устройстве - группами по 4 в порядке блоков,
+ * поэтому результаты совпадают только с точностью до округления.
+ *
+ * \param [in] bt Транспонированная B (N x K) из quantizeColumns
+ */
+void cpuQuantizedGemm(const QuantizedMatrix& a, const QuantizedMatrix& bt, float* c);
+
+/*!
+ * \brief QuantizedGemm Kernel умножения для одного типа входов на одном устройстве
+ *
+ * Объект не потокобезопасен: аргументы kernel'я общие.
+ */
+class QuantizedGemm {
+public:
+    static constexpr int TILE = 16;             //< наибольший блок C на work-group (TILE x TILE work-item'ов)
+    static constexpr int TILE_K = 32;           //< порция K в локальной памяти
+    static constexpr int MAX_INT8_K = 131072;   //< при большем K сумма int8 произведений может переполнить int32
+
+    /*!
+     * \throws cl::Error Если программа не компилируется
+     */
+    QuantizedGemm(const cl::Context& context, const cl::Device& device, QuantizedType type);
+
+    /*!
+     * \brief enqueue Добавляет в очередь C = A * Bt^T
+     *
+     * \param [in] a Буфер A (M x K) в типе входа
+     * \param [in] scaleA Масштабы строк A (M float, только для Int8, иначе nullptr)
+     * \param [in] bt Буфер транспонированной B (N x K) в типе входа
+     * \param [in] scaleB Масштабы столбцов B (N float, только для Int8, иначе nullptr)
+     * \param [out] c Буфер C (M x N float, по строкам)
+     * \throws std::invalid_argument Если размеры не положительны, для Int8 нет масштабов или K больше MAX_INT8_K
+     * \return Событие завершения kernel'я
+     */
+    cl::Event enqueue(cl::CommandQueue& queue, int M, int N, int K,
+                      const cl::Buffer& a, const cl::Buffer* scaleA,
+                      const cl::Buffer& bt, const cl::Buffer* scaleB,
+                      const cl::Buffer& c, const std::vector<cl::Event>* events = nullptr);
+
+    QuantizedType type() const { return inputType; }
+
+    /*!
+     * \brief usesDotProduct true, если int8 умножается встроенной dot (cl_khr_integer_dot_product)
+     */
+    bool usesDotProduct() const { return dotProduct; }
+
+    /*!
+     * \brief usesFp16 true, если half читается как half (cl_khr_fp16)
+     */
+    bool usesFp16() const { return fp16; }
+
+    /*!
+     * \brief tileSize Сторона блока C на work-group (TILE или меньше, если kernel не допускает TILE x TILE)
+     */
+    int tileSize() const { return tile; }
+
+private:
+    QuantizedType inputType;
+    int tile = TILE;
+    bool dotProduct = false;
+    bool fp16 = false;
+    cl::Kernel kernel;
+};
+
+/*!
+ * \brief quantizedTypeName Название типа входов для вывода
+ */
+const char* quantizedTypeName(QuantizedType type);
+
+/*!
+ * @}
+ */
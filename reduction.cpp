@@ -0,0 +1,319 @@
+/*!
+  * \addtogroup reduction
+  * @{
+  */
+
+#include "reduction.hpp"
+#include "device_vector.hpp"
+#include "program_cache.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view kernelReduceSrc { R"CLC(
+// -D TYPE= -D ACC= -D WG= -D LOWEST= -D HIGHEST= и одно из -D OP_SUM, OP_MIN, OP_MAX, OP_DOT
+#ifdef ENABLE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+#define CAT_(a, b) a ## b
+#define CAT(a, b) CAT_(a, b)
+#define ACC4 CAT(ACC, 4)
+#define CONVERT4 CAT(convert_, ACC4)
+
+#if defined(OP_MIN)
+#define IDENTITY HIGHEST
+#define COMBINE(x, y) min(x, y)
+#elif defined(OP_MAX)
+#define IDENTITY LOWEST
+#define COMBINE(x, y) max(x, y)
+#else
+#define IDENTITY 0
+#define COMBINE(x, y) ((x) + (y))
+#endif
+
+#ifdef OP_DOT
+#define MAP(i) ((ACC) a[i] * (ACC) b[i])
+#define MAP4(i) (CONVERT4(vload4(0, a + (i))) * CONVERT4(vload4(0, b + (i))))
+#else
+#define MAP(i) ((ACC) a[i])
+#define MAP4(i) CONVERT4(vload4(0, a + (i)))
+#endif
+
+// Дерево в локальной памяти, WG - степень двойки
+ACC reduceGroup(ACC value, local ACC* scratch) {
+    const int lid = get_local_id(0);
+    scratch[lid] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int s = WG / 2; s > 0; s >>= 1) {
+        if (lid < s) {
+            scratch[lid] = COMBINE(scratch[lid], scratch[lid + s]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    return scratch[0];
+}
+
+// Первый проход: work-item накапливает 4 независимые полосы, проходя вектор с шагом в размер NDRange
+kernel void reducePartial(const ulong n, const global TYPE* a, const global TYPE* b, global ACC* partial) {
+    local ACC scratch[WG];
+    const size_t stride = get_global_size(0) * 4;
+    ACC4 acc = (ACC4) (IDENTITY);
+    size_t i = get_global_id(0) * 4;
+    for (; i + 4 <= n; i += stride) {
+        acc = COMBINE(acc, MAP4(i));
+    }
+    ACC value = COMBINE(COMBINE(acc.s0, acc.s1), COMBINE(acc.s2, acc.s3));
+    // Хвост короче 4 элементов попадает ровно в один блок
+    for (; i < n; ++i) {
+        value = COMBINE(value, MAP(i));
+    }
+    value = reduceGroup(value, scratch);
+    if (get_local_id(0) == 0) {
+        partial[get_group_id(0)] = value;
+    }
+}
+
+// Второй проход: одна work-group сворачивает частичные значения
+kernel void reduceFinal(const uint count, const global ACC* partial, global ACC* result) {
+    local ACC scratch[WG];
+    ACC value = IDENTITY;
+    for (uint i = get_local_id(0); i < count; i += WG) {
+        value = COMBINE(value, partial[i]);
+    }
+    value = reduceGroup(value, scratch);
+    if (get_local_id(0) == 0) {
+        result[0] = value;
+    }
+}
+)CLC"sv };
+
+constexpr const char* OP_DEFINES[] = { "OP_SUM", "OP_MIN", "OP_MAX", "OP_DOT" };
+
+size_t floorPowerOfTwo(size_t value) {
+    size_t power = 1;
+    while (power * 2 <= value) {
+        power *= 2;
+    }
+    return power;
+}
+
+} // namespace
+
+template <typename T>
+Reduction<T>::Reduction(const cl::Context& context, const cl::Device& device)
+    : context { context }, device { device },
+      partial { context, CL_MEM_READ_WRITE, sizeof(Acc) * MAX_GROUPS },
+      value { context, CL_MEM_READ_WRITE, sizeof(Acc) } {
+    if (std::is_same<T, cl_double>::value && !deviceHasExtension(device, "cl_khr_fp64")) {
+        throw std::runtime_error { "double is not supported by the device (cl_khr_fp64)" };
+    }
+    // Наибольшая степень двойки не больше 256 и предела устройства; предел kernel'я проверяется после компиляции
+    groupSizes.fill(floorPowerOfTwo(std::min<size_t>(256, device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>())));
+}
+
+template <typename T>
+cl::Kernel& Reduction<T>::kernel(ReduceOp op, bool final) {
+    const size_t index = static_cast<size_t>(op);
+    size_t& groupSize = groupSizes[index];
+    while (partialKernels[index]() == nullptr) {
+        using Traits = ReductionTraits<T>;
+        std::ostringstream options;
+        options << "-D TYPE=" << Traits::type << " -D ACC=" << Traits::acc << " -D WG=" << groupSize
+                << " -D LOWEST=" << Traits::lowest << " -D HIGHEST=" << Traits::highest
+                << " -D " << OP_DEFINES[index];
+        if (std::is_same<T, cl_double>::value) {
+            options << " -D ENABLE_FP64";
+        }
+        cl::Program program = buildProgramCached(context, device, std::string { kernelReduceSrc }, options.str());
+        cl::Kernel first { program, "reducePartial" };
+        cl::Kernel second { program, "reduceFinal" };
+        // Kernel'ю может не хватить регистров или локальной памяти на группу размера WG:
+        // тогда программа пересобирается с наибольшей степенью двойки, которую допускают оба kernel'я
+        const size_t limit = std::min(first.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device),
+                                      second.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+        if (limit < groupSize) {
+            groupSize = floorPowerOfTwo(limit);
+            continue;
+        }
+        partialKernels[index] = first;
+        finalKernels[index] = second;
+    }
+    return final ? finalKernels[index] : partialKernels[index];
+}
+
+template <typename T>
+cl::Event Reduction<T>::enqueue(cl::CommandQueue& queue, ReduceOp op, size_t count,
+                                const cl::Buffer& a, const cl::Buffer* b, const cl::Buffer& result,
+                                const std::vector<cl::Event>* events) {
+    if (op == ReduceOp::Dot && b == nullptr) {
+        throw std::invalid_argument { "dot product needs the second vector" };
+    }
+    cl::Kernel& first = kernel(op, false);
+    const size_t groupSize = groupSizes[static_cast<size_t>(op)];
+    const size_t perGroup = groupSize * 4;
+    const size_t groups = std::max<size_t>(1, std::min(MAX_GROUPS, (count + perGroup - 1) / perGroup));
+
+    first.setArg(0, static_cast<cl_ulong>(count));
+    first.setArg(1, a);
+    first.setArg(2, b != nullptr ? *b : a);
+    first.setArg(3, partial);
+    cl::Event partialDone;
+    queue.enqueueNDRangeKernel(first, cl::NullRange, cl::NDRange (groups * groupSize), cl::NDRange (groupSize),
+                               events, &partialDone);
+    traceCommand(partialDone, "reducePartial");
+
+    cl::Kernel& second = kernel(op, true);
+    second.setArg(0, static_cast<cl_uint>(groups));
+    second.setArg(1, partial);
+    second.setArg(2, result);
+    const std::vector<cl::Event> wait { partialDone };
+    cl::Event event;
+    queue.enqueueNDRangeKernel(second, cl::NullRange, cl::NDRange (groupSize), cl::NDRange (groupSize),
+                               &wait, &event);
+    traceCommand(event, "reduceFinal");
+    return event;
+}
+
+template <typename T>
+typename Reduction<T>::Acc Reduction<T>::reduce(cl::CommandQueue& queue, ReduceOp op, const cl::Buffer& a, size_t count) {
+    const std::vector<cl::Event> wait { enqueue(queue, op, count, a, nullptr, value) };
+    Acc result;
+    cl::Event read;
+    queue.enqueueReadBuffer(value, CL_TRUE, 0, sizeof(Acc), &result, &wait, &read);
+    traceCommand(read, "read result");
+    return result;
+}
+
+template <typename T>
+typename Reduction<T>::Acc Reduction<T>::dot(cl::CommandQueue& queue, const cl::Buffer& a, const cl::Buffer& b, size_t count) {
+    const std::vector<cl::Event> wait { enqueue(queue, ReduceOp::Dot, count, a, &b, value) };
+    Acc result;
+    cl::Event read;
+    queue.enqueueReadBuffer(value, CL_TRUE, 0, sizeof(Acc), &result, &wait, &read);
+    traceCommand(read, "read result");
+    return result;
+}
+
+template class Reduction<cl_int>;
+template class Reduction<cl_uint>;
+template class Reduction<cl_float>;
+template class Reduction<cl_double>;
+
+namespace {
+
+constexpr size_t LANES = 16;
+constexpr size_t CPU_CHUNK = size_t(1) << 18;
+
+template <typename Acc>
+Acc identity(ReduceOp op) {
+    using Limits = std::numeric_limits<Acc>;
+    switch (op) {
+    case ReduceOp::Min:
+        return Limits::has_infinity ? Limits::infinity() : Limits::max();
+    case ReduceOp::Max:
+        return Limits::has_infinity ? -Limits::infinity() : Limits::lowest();
+    default:
+        return Acc {};
+    }
+}
+
+template <ReduceOp Op, typename Acc>
+inline Acc combine(Acc x, Acc y) {
+    if constexpr (Op == ReduceOp::Min) {
+        return y < x ? y : x;
+    } else if constexpr (Op == ReduceOp::Max) {
+        return x < y ? y : x;
+    } else {
+        return x + y;
+    }
+}
+
+/*!
+ * \brief reduceRange Сворачивает n элементов в LANES независимых полос
+ */
+template <ReduceOp Op, typename T, typename Acc>
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+Acc reduceRange(const T* a, const T* b, size_t n) {
+    Acc lanes[LANES];
+    for (size_t j = 0; j < LANES; ++j) {
+        lanes[j] = identity<Acc>(Op);
+    }
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (size_t j = 0; j < LANES; ++j) {
+            if constexpr (Op == ReduceOp::Dot) {
+                lanes[j] += static_cast<Acc>(a[i + j]) * static_cast<Acc>(b[i + j]);
+            } else {
+                lanes[j] = combine<Op>(lanes[j], static_cast<Acc>(a[i + j]));
+            }
+        }
+    }
+    Acc result = identity<Acc>(Op);
+    for (size_t j = 0; j < LANES; ++j) {
+        result = combine<Op>(result, lanes[j]);
+    }
+    for (; i < n; ++i) {
+        result = combine<Op>(result, Op == ReduceOp::Dot ? static_cast<Acc>(a[i]) * static_cast<Acc>(b[i])
+                                                         : static_cast<Acc>(a[i]));
+    }
+    return result;
+}
+
+template <ReduceOp Op, typename T, typename Acc>
+Acc reduceParallel(const T* a, const T* b, size_t count) {
+    const size_t chunks = (count + CPU_CHUNK - 1) / CPU_CHUNK;
+    std::vector<Acc> partial ( chunks );
+    ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+        const size_t begin = chunk * CPU_CHUNK;
+        partial[chunk] = reduceRange<Op, T, Acc>(a + begin, b != nullptr ? b + begin : nullptr,
+                                                 std::min(CPU_CHUNK, count - begin));
+    });
+    Acc result = identity<Acc>(Op);
+    for (const Acc value : partial) {
+        result = combine<Op>(result, value);
+    }
+    return result;
+}
+
+} // namespace
+
+template <typename T>
+typename ReductionTraits<T>::Acc cpuReduce(ReduceOp op, const T* a, size_t count, const T* b) {
+    using Acc = typename ReductionTraits<T>::Acc;
+    switch (op) {
+    case ReduceOp::Sum:
+        return reduceParallel<ReduceOp::Sum, T, Acc>(a, nullptr, count);
+    case ReduceOp::Min:
+        return reduceParallel<ReduceOp::Min, T, Acc>(a, nullptr, count);
+    case ReduceOp::Max:
+        return reduceParallel<ReduceOp::Max, T, Acc>(a, nullptr, count);
+    case ReduceOp::Dot:
+        if (b == nullptr) {
+            throw std::invalid_argument { "dot product needs the second vector" };
+        }
+        return reduceParallel<ReduceOp::Dot, T, Acc>(a, b, count);
+    }
+    return Acc {};
+}
+
+template cl_long cpuReduce<cl_int>(ReduceOp, const cl_int*, size_t, const cl_int*);
+template cl_ulong cpuReduce<cl_uint>(ReduceOp, const cl_uint*, size_t, const cl_uint*);
+template cl_float cpuReduce<cl_float>(ReduceOp, const cl_float*, size_t, const cl_float*);
+template cl_double cpuReduce<cl_double>(ReduceOp, const cl_double*, size_t, const cl_double*);
+
+/*!
+ * @}
+ */
@@ -0,0 +1,133 @@
+/*!
+  * \defgroup reduction Редукции векторов
+  *
+  * Сумма, минимум, максимум и скалярное произведение векторов на устройстве и на CPU.
+  * На устройстве редукция выполняется в два прохода: каждая work-group сворачивает свою часть вектора
+  * (векторными загрузками по 4 элемента и деревом в локальной памяти) в одно частичное значение,
+  * затем одна work-group сворачивает частичные значения. На хост передается только результат.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+enum class ReduceOp { Sum, Min, Max, Dot };
+
+/*!
+ * \brief ReductionTraits Тип накопления для типа элемента
+ *
+ * Целые суммируются в 64 бита, чтобы сумма 8M элементов не переполнялась.
+ * lowest и highest - нейтральные элементы максимума и минимума в openCL C.
+ */
+template <typename T> struct ReductionTraits;
+template <> struct ReductionTraits<cl_int> {
+    using Acc = cl_long;
+    static constexpr const char* type = "int";
+    static constexpr const char* acc = "long";
+    static constexpr const char* lowest = "LONG_MIN";
+    static constexpr const char* highest = "LONG_MAX";
+};
+template <> struct ReductionTraits<cl_uint> {
+    using Acc = cl_ulong;
+    static constexpr const char* type = "uint";
+    static constexpr const char* acc = "ulong";
+    static constexpr const char* lowest = "0";
+    static constexpr const char* highest = "ULONG_MAX";
+};
+template <> struct ReductionTraits<cl_float> {
+    using Acc = cl_float;
+    static constexpr const char* type = "float";
+    static constexpr const char* acc = "float";
+    static constexpr const char* lowest = "-INFINITY";
+    static constexpr const char* highest = "INFINITY";
+};
+/*!
+ * Требует cl_khr_fp64
+ */
+template <> struct ReductionTraits<cl_double> {
+    using Acc = cl_double;
+    static constexpr const char* type = "double";
+    static constexpr const char* acc = "double";
+    static constexpr const char* lowest = "-INFINITY";
+    static constexpr const char* highest = "INFINITY";
+};
+
+/*!
+ * \brief Reduction Редукции векторов элементов типа T на одном устройстве
+ *
+ * Программы для каждой операции компилируются при первом использовании; если kernel не допускает группу
+ * предела устройства (регистры, локальная память), программа пересобирается с меньшей группой.
+ * Объект не потокобезопасен: аргументы kernel'ей и буфер частичных значений общие.
+ * Определена для cl_int, cl_uint, cl_float и cl_double.
+ */
+template <typename T>
+class Reduction {
+public:
+    using Acc = typename ReductionTraits<T>::Acc;
+
+    /*!
+     * \brief MAX_GROUPS Наибольшее количество work-group первого прохода (и частичных значений)
+     */
+    static constexpr size_t MAX_GROUPS = 256;
+
+    Reduction(const cl::Context& context, const cl::Device& device);
+
+    /*!
+     * \brief enqueue Добавляет в очередь редукцию count элементов a (для Dot - произведений a[i] * b[i])
+     *
+     * \param [in] b Второй вектор для Dot (для остальных операций не используется и может быть nullptr)
+     * \param [out] result Буфер, в начало которого записывается результат типа Acc
+     * \return Событие завершения второго прохода
+     */
+    cl::Event enqueue(cl::CommandQueue& queue, ReduceOp op, size_t count,
+                      const cl::Buffer& a, const cl::Buffer* b, const cl::Buffer& result,
+                      const std::vector<cl::Event>* events = nullptr);
+
+    /*!
+     * \brief reduce Выполняет редукцию и читает результат (блокирующий вызов)
+     */
+    Acc reduce(cl::CommandQueue& queue, ReduceOp op, const cl::Buffer& a, size_t count);
+
+    /*!
+     * \brief dot Скалярное произведение (блокирующий вызов)
+     */
+    Acc dot(cl::CommandQueue& queue, const cl::Buffer& a, const cl::Buffer& b, size_t count);
+
+private:
+    cl::Kernel& kernel(ReduceOp op, bool final);
+
+    cl::Context context;
+    cl::Device device;
+    std::array<size_t, 4> groupSizes;   //< размер work-group для каждой операции (WG в программе)
+    cl::Buffer partial;
+    cl::Buffer value;
+    std::array<cl::Kernel, 4> partialKernels;
+    std::array<cl::Kernel, 4> finalKernels;
+};
+
+extern template class Reduction<cl_int>;
+extern template class Reduction<cl_uint>;
+extern template class Reduction<cl_float>;
+extern template class Reduction<cl_double>;
+
+/*!
+ * \brief cpuReduce Эталонная редукция на CPU: несколько потоков, в каждом - независимые SIMD полосы накопления
+ *
+ * Полосы не зависят друг от друга, поэтому компилятор векторизует цикл без изменения порядка
+ * операций внутри полосы. Для x86 код собирается в вариантах avx512f, avx2 и базовом с выбором при запуске.
+ * Определена для cl_int, cl_uint, cl_float и cl_double.
+ *
+ * \param [in] b Второй вектор для Dot (для остальных операций не используется)
+ */
+template <typename T>
+typename ReductionTraits<T>::Acc cpuReduce(ReduceOp op, const T* a, size_t count, const T* b = nullptr);
+
+/*!
+ * @}
+ */
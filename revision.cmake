@@ -0,0 +1,15 @@
+# Writes the source revision header for benchmark results: cmake -D SOURCE_DIR=<dir> -D OUTPUT=<header> -P revision.cmake
+# Runs on every build; the header is rewritten only when the revision changes, so unchanged builds do not recompile
+execute_process(COMMAND git describe --always --dirty
+                WORKING_DIRECTORY ${SOURCE_DIR}
+                OUTPUT_VARIABLE BENCHMARK_REVISION OUTPUT_STRIP_TRAILING_WHITESPACE ERROR_QUIET)
+if(NOT BENCHMARK_REVISION)
+    set(BENCHMARK_REVISION unknown)
+endif()
+set(CONTENT "#define BENCHMARK_REVISION \"${BENCHMARK_REVISION}\"\n")
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} CURRENT)
+endif()
+if(NOT CURRENT STREQUAL CONTENT)
+    file(WRITE ${OUTPUT} ${CONTENT})
+endif()
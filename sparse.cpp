@@ -0,0 +1,382 @@
+/*!
+  * \addtogroup sparse
+  * @{
+  */
+
+#include "sparse.hpp"
+#include "program_cache.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+constexpr std::string_view kernelSparseSrc { R"CLC(
+// -D WG= -D VW= (VW - work-item'ов на строку в csrVector, степень двойки, делит WG)
+// Задача - один элемент C: строка task / n, столбец task % n. При n = 1 (SpMV) задача - строка
+
+// Work-item на задачу
+kernel void csrScalar(const int rows, const int n, const global int* rowPtr, const global int* colIdx,
+                      const global float* values, const global float* b, global float* c) {
+    const size_t task = get_global_id(0);
+    if (task >= (size_t) rows * n) {
+        return;
+    }
+    const size_t row = task / n;
+    const size_t j = task % n;
+    const int end = rowPtr[row + 1];
+    float sum = 0.0f;
+    for (int k = rowPtr[row]; k < end; ++k) {
+        sum = fma(values[k], b[(size_t) colIdx[k] * n + j], sum);
+    }
+    c[task] = sum;
+}
+
+// VW соседних work-item'ов на задачу: каждый суммирует элементы строки с шагом VW, суммы сворачиваются деревом
+kernel void csrVector(const int rows, const int n, const global int* rowPtr, const global int* colIdx,
+                      const global float* values, const global float* b, global float* c) {
+    local float scratch[WG];
+    const int lid = get_local_id(0);
+    const int lane = lid & (VW - 1);
+    const size_t task = get_global_id(0) / VW;
+    const bool active = task < (size_t) rows * n;
+    float sum = 0.0f;
+    if (active) {
+        const size_t row = task / n;
+        const size_t j = task % n;
+        const int end = rowPtr[row + 1];
+        for (int k = rowPtr[row] + lane; k < end; k += VW) {
+            sum = fma(values[k], b[(size_t) colIdx[k] * n + j], sum);
+        }
+    }
+    // Все work-item'ы группы доходят до барьеров, в том числе за концом матрицы
+    scratch[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int s = VW / 2; s > 0; s >>= 1) {
+        if (lane < s) {
+            scratch[lid] += scratch[lid + s];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (active && lane == 0) {
+        c[task] = scratch[lid];
+    }
+}
+
+// Work-item на строку хранения r и столбец j = task / stored: соседние work-item'ы - соседние строки среза
+kernel void sell(const int stored, const int n, const int slice, const global int* sliceStart,
+                 const global int* rowIndex, const global int* colIdx, const global float* values,
+                 const global float* b, global float* c) {
+    const size_t task = get_global_id(0);
+    if (task >= (size_t) stored * n) {
+        return;
+    }
+    const int r = task % stored;
+    const size_t j = task / stored;
+    const int s = r / slice;
+    const int begin = sliceStart[s] + r % slice;
+    const int width = (sliceStart[s + 1] - sliceStart[s]) / slice;
+    float sum = 0.0f;
+    for (int k = 0; k < width; ++k) {
+        const int index = begin + k * slice;
+        sum = fma(values[index], b[(size_t) colIdx[index] * n + j], sum);
+    }
+    const int row = rowIndex[r];
+    if (row >= 0) {
+        c[(size_t) row * n + j] = sum;
+    }
+}
+)CLC"sv };
+
+constexpr size_t MAX_GROUP = 128;
+constexpr int MAX_VECTOR_WIDTH = 32;
+constexpr size_t CPU_ROWS = 256;    //< строк в задаче пула CPU эталона
+
+size_t floorPowerOfTwo(size_t value) {
+    size_t power = 1;
+    while (power * 2 <= value) {
+        power *= 2;
+    }
+    return power;
+}
+
+/*!
+ * \brief sellOrder Порядок строк SELL-C-σ: сортировка по убыванию длины внутри окон по sigma строк
+ */
+std::vector<int> sellOrder(const CsrMatrix& matrix, int sigma) {
+    std::vector<int> order ( matrix.rows );
+    std::iota(order.begin(), order.end(), 0);
+    const auto length = [&](int row) { return matrix.rowPtr[row + 1] - matrix.rowPtr[row]; };
+    for (int begin = 0; begin < matrix.rows; begin += sigma) {
+        const int end = std::min(matrix.rows, begin + sigma);
+        std::stable_sort(order.begin() + begin, order.begin() + end,
+                         [&](int x, int y) { return length(x) > length(y); });
+    }
+    return order;
+}
+
+template <typename T>
+cl::Buffer upload(const cl::Context& context, cl::CommandQueue& queue, const std::vector<T>& data, size_t& bytes) {
+    // Пустой буфер недопустим, поэтому пустая матрица хранит один элемент
+    const size_t size = std::max<size_t>(1, data.size()) * sizeof(T);
+    cl::Buffer buffer { context, CL_MEM_READ_ONLY, size };
+    if (!data.empty()) {
+        cl::Event event;
+        queue.enqueueWriteBuffer(buffer, CL_TRUE, 0, data.size() * sizeof(T), data.data(), nullptr, &event);
+        traceCommand(event, "write sparse matrix");
+    }
+    bytes += size;
+    return buffer;
+}
+
+} // namespace
+
+CsrMatrix csrFromDense(const std::vector<float>& dense, int rows, int cols) {
+    if (rows < 0 || cols < 0 || dense.size() != static_cast<size_t>(rows) * cols) {
+        throw std::invalid_argument { "dense matrix size does not match rows x cols" };
+    }
+    CsrMatrix matrix;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.rowPtr.reserve(rows + 1);
+    matrix.rowPtr.push_back(0);
+    for (int i = 0; i < rows; ++i) {
+        const float* row = dense.data() + static_cast<size_t>(i) * cols;
+        for (int j = 0; j < cols; ++j) {
+            if (row[j] != 0.0f) {
+                matrix.colIdx.push_back(j);
+                matrix.values.push_back(row[j]);
+            }
+        }
+        if (matrix.values.size() > static_cast<size_t>(INT_MAX)) {
+            throw std::invalid_argument { "sparse matrix has more than INT_MAX non-zeros" };
+        }
+        matrix.rowPtr.push_back(static_cast<cl_int>(matrix.values.size()));
+    }
+    return matrix;
+}
+
+std::vector<float> csrToDense(const CsrMatrix& matrix) {
+    std::vector<float> dense ( static_cast<size_t>(matrix.rows) * matrix.cols, 0.0f );
+    for (int i = 0; i < matrix.rows; ++i) {
+        for (int k = matrix.rowPtr[i]; k < matrix.rowPtr[i + 1]; ++k) {
+            dense[static_cast<size_t>(i) * matrix.cols + matrix.colIdx[k]] = matrix.values[k];
+        }
+    }
+    return dense;
+}
+
+SellMatrix sellFromCsr(const CsrMatrix& matrix, int slice, int sigma) {
+    if (slice <= 0 || sigma <= 0) {
+        throw std::invalid_argument { "slice height and sorting window must be positive" };
+    }
+    SellMatrix sell;
+    sell.rows = matrix.rows;
+    sell.cols = matrix.cols;
+    sell.slice = slice;
+    sell.sigma = sigma;
+    const std::vector<int> order = sellOrder(matrix, sigma);
+    const int slices = (matrix.rows + slice - 1) / slice;
+    sell.rowIndex.assign(static_cast<size_t>(slices) * slice, -1);
+    std::copy(order.begin(), order.end(), sell.rowIndex.begin());
+
+    sell.sliceStart.reserve(slices + 1);
+    sell.sliceStart.push_back(0);
+    size_t stored = 0;
+    for (int s = 0; s < slices; ++s) {
+        int width = 0;
+        for (int r = s * slice; r < std::min(matrix.rows, (s + 1) * slice); ++r) {
+            width = std::max(width, matrix.rowPtr[order[r] + 1] - matrix.rowPtr[order[r]]);
+        }
+        stored += static_cast<size_t>(width) * slice;
+        if (stored > static_cast<size_t>(INT_MAX)) {
+            throw std::invalid_argument { "padded SELL matrix has more than INT_MAX elements" };
+        }
+        sell.sliceStart.push_back(static_cast<cl_int>(stored));
+    }
+
+    sell.colIdx.assign(stored, 0);
+    sell.values.assign(stored, 0.0f);
+    for (int r = 0; r < matrix.rows; ++r) {
+        const int row = order[r];
+        const size_t begin = sell.sliceStart[r / slice] + r % slice;
+        for (int k = matrix.rowPtr[row]; k < matrix.rowPtr[row + 1]; ++k) {
+            const size_t index = begin + static_cast<size_t>(k - matrix.rowPtr[row]) * slice;
+            sell.colIdx[index] = matrix.colIdx[k];
+            sell.values[index] = matrix.values[k];
+        }
+    }
+    return sell;
+}
+
+RowStatistics rowStatistics(const CsrMatrix& matrix) {
+    RowStatistics statistics;
+    if (matrix.rows == 0) {
+        return statistics;
+    }
+    double sum = 0.0, squares = 0.0;
+    for (int i = 0; i < matrix.rows; ++i) {
+        const int length = matrix.rowPtr[i + 1] - matrix.rowPtr[i];
+        sum += length;
+        squares += static_cast<double>(length) * length;
+        statistics.max = std::max(statistics.max, length);
+    }
+    statistics.mean = sum / matrix.rows;
+    statistics.deviation = std::sqrt(std::max(0.0, squares / matrix.rows - statistics.mean * statistics.mean));
+
+    // Объем SELL-C-σ считается по длинам строк, без построения матрицы: срезы не пересекают окна сортировки,
+    // поэтому первая строка среза - самая длинная
+    static_assert(SELL_SIGMA % SELL_SLICE == 0, "sorting window must consist of whole slices");
+    const std::vector<int> order = sellOrder(matrix, SELL_SIGMA);
+    size_t stored = 0;
+    for (int r = 0; r < matrix.rows; r += SELL_SLICE) {
+        stored += static_cast<size_t>(matrix.rowPtr[order[r] + 1] - matrix.rowPtr[order[r]]) * SELL_SLICE;
+    }
+    statistics.sellFill = matrix.nnz() > 0 ? static_cast<double>(stored) / matrix.nnz() : 1.0;
+    return statistics;
+}
+
+SparseKernel chooseSparseKernel(const RowStatistics& statistics, cl_device_type type) {
+    if (statistics.sellFill <= 1.5) {
+        return SparseKernel::Sell;
+    }
+    // Редукция в локальной памяти окупается только на GPU и только когда группе work-item'ов есть что делить
+    if ((type & CL_DEVICE_TYPE_GPU) != 0 && statistics.mean >= 32.0) {
+        return SparseKernel::CsrVector;
+    }
+    return SparseKernel::CsrScalar;
+}
+
+const char* sparseKernelName(SparseKernel kernel) {
+    switch (kernel) {
+    case SparseKernel::Auto:
+        return "auto";
+    case SparseKernel::CsrScalar:
+        return "csr scalar";
+    case SparseKernel::CsrVector:
+        return "csr vector";
+    case SparseKernel::Sell:
+        return "sell";
+    case SparseKernel::Ell:
+        return "ell";
+    }
+    return "unknown";
+}
+
+void cpuSpmm(const CsrMatrix& a, const float* b, int n, float* c) {
+    const size_t tasks = (static_cast<size_t>(a.rows) + CPU_ROWS - 1) / CPU_ROWS;
+    ThreadPool::shared().parallelFor(tasks, [&](size_t task) {
+        const int end = static_cast<int>(std::min<size_t>(a.rows, (task + 1) * CPU_ROWS));
+        for (int i = static_cast<int>(task * CPU_ROWS); i < end; ++i) {
+            float* out = c + static_cast<size_t>(i) * n;
+            std::fill(out, out + n, 0.0f);
+            for (int k = a.rowPtr[i]; k < a.rowPtr[i + 1]; ++k) {
+                const float value = a.values[k];
+                const float* row = b + static_cast<size_t>(a.colIdx[k]) * n;
+                for (int j = 0; j < n; ++j) {
+                    out[j] = std::fma(value, row[j], out[j]);
+                }
+            }
+        }
+    });
+}
+
+SparseMatrix::SparseMatrix(const cl::Context& context, const cl::Device& device, cl::CommandQueue& queue,
+                           const CsrMatrix& matrix, SparseKernel kernel)
+    : rowCount { matrix.rows }, colCount { matrix.cols }, nonZeros { matrix.nnz() },
+      rowStats { rowStatistics(matrix) } {
+    if (matrix.rows <= 0 || matrix.cols <= 0) {
+        throw std::invalid_argument { "sparse matrix must have positive dimensions" };
+    }
+    selected = kernel == SparseKernel::Auto ? chooseSparseKernel(rowStats, device.getInfo<CL_DEVICE_TYPE>()) : kernel;
+    const char* name = selected == SparseKernel::Sell || selected == SparseKernel::Ell ? "sell"
+                       : selected == SparseKernel::CsrVector ? "csrVector" : "csrScalar";
+
+    // Наибольшая степень двойки не больше MAX_GROUP и предела устройства
+    groupSize = floorPowerOfTwo(std::min(MAX_GROUP, device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()));
+    while (multiply() == nullptr) {
+        if (selected == SparseKernel::CsrVector) {
+            // Наименьшая степень двойки не меньше средней длины строки
+            const int maxWidth = std::min<int>(MAX_VECTOR_WIDTH, static_cast<int>(groupSize));
+            width = 2;
+            while (width < maxWidth && width < rowStats.mean) {
+                width *= 2;
+            }
+            width = std::min(width, maxWidth);
+        }
+        std::string options = "-D WG=" + std::to_string(groupSize) + " -D VW=" + std::to_string(width);
+        cl::Program program = buildProgramCached(context, device, std::string { kernelSparseSrc }, options);
+        cl::Kernel built { program, name };
+        // Kernel'ю может не хватить регистров или локальной памяти на группу: пересобираем с меньшей
+        const size_t limit = built.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+        if (limit < groupSize) {
+            groupSize = floorPowerOfTwo(limit);
+            continue;
+        }
+        multiply = built;
+    }
+
+    if (selected == SparseKernel::Sell || selected == SparseKernel::Ell) {
+        const SellMatrix sell = selected == SparseKernel::Sell ? sellFromCsr(matrix)
+                                                               : sellFromCsr(matrix, matrix.rows, 1);
+        slice = sell.slice;
+        storedRows = sell.rowIndex.size();
+        rowPtr = upload(context, queue, sell.sliceStart, bytes);
+        rowIndex = upload(context, queue, sell.rowIndex, bytes);
+        colIdx = upload(context, queue, sell.colIdx, bytes);
+        values = upload(context, queue, sell.values, bytes);
+    } else {
+        storedRows = matrix.rows;
+        rowPtr = upload(context, queue, matrix.rowPtr, bytes);
+        colIdx = upload(context, queue, matrix.colIdx, bytes);
+        values = upload(context, queue, matrix.values, bytes);
+    }
+}
+
+cl::Event SparseMatrix::enqueueSpmv(cl::CommandQueue& queue, const cl::Buffer& x, const cl::Buffer& y,
+                                    const std::vector<cl::Event>* events) {
+    return enqueueSpmm(queue, 1, x, y, events);
+}
+
+cl::Event SparseMatrix::enqueueSpmm(cl::CommandQueue& queue, int n, const cl::Buffer& b, const cl::Buffer& c,
+                                    const std::vector<cl::Event>* events) {
+    if (n <= 0) {
+        throw std::invalid_argument { "number of columns must be positive" };
+    }
+    const size_t tasks = storedRows * n * width;
+    const size_t global = (tasks + groupSize - 1) / groupSize * groupSize;
+    cl_uint arg = 0;
+    if (selected == SparseKernel::Sell || selected == SparseKernel::Ell) {
+        multiply.setArg(arg++, static_cast<cl_int>(storedRows));
+        multiply.setArg(arg++, static_cast<cl_int>(n));
+        multiply.setArg(arg++, static_cast<cl_int>(slice));
+        multiply.setArg(arg++, rowPtr);
+        multiply.setArg(arg++, rowIndex);
+    } else {
+        multiply.setArg(arg++, static_cast<cl_int>(rowCount));
+        multiply.setArg(arg++, static_cast<cl_int>(n));
+        multiply.setArg(arg++, rowPtr);
+    }
+    multiply.setArg(arg++, colIdx);
+    multiply.setArg(arg++, values);
+    multiply.setArg(arg++, b);
+    multiply.setArg(arg++, c);
+    cl::Event event;
+    queue.enqueueNDRangeKernel(multiply, cl::NullRange, cl::NDRange (global), cl::NDRange (groupSize),
+                               events, &event);
+    traceCommand(event, n == 1 ? "spmv" : "spmm");
+    return event;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,206 @@
+/*!
+  * \defgroup sparse Разреженные матрицы
+  *
+  * Умножение разреженной матрицы на вектор (SpMV) и на плотную матрицу (SpMM) на openCL устройстве.
+  * Форматы хранения:
+  *  - CSR: ненулевые элементы по строкам, rowPtr[i]..rowPtr[i + 1] - диапазон строки i;
+  *  - SELL-C-σ: строки сортируются по убыванию длины в окнах по σ строк, группируются в срезы по C строк
+  *    и дополняются нулями до длины самой длинной строки среза; внутри среза элементы хранятся по столбцам,
+  *    поэтому соседние work-item'ы читают соседние адреса. ELLPACK - частный случай: один срез на всю матрицу.
+  *
+  * Плотные матрицы и векторы хранятся по строкам (row-major), как в multiplyMatrices:
+  * C (rows x n) = A (rows x cols) * B (cols x n), SpMV - случай n = 1.
+  *
+  * Kernel выбирается по статистике длин строк и типу устройства (chooseSparseKernel):
+  *  - строки почти одинаковой длины: SELL-C-σ (дополнение нулями мало, чтение объединяется);
+  *  - длинные строки разной длины на GPU: группа из нескольких work-item'ов на строку (vector CSR)
+  *    с редукцией в локальной памяти;
+  *  - остальные: work-item на строку (scalar CSR).
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <cstddef>
+#include <vector>
+
+constexpr int SELL_SLICE = 32;      //< высота среза SELL-C-σ по умолчанию
+constexpr int SELL_SIGMA = 256;     //< окно сортировки строк SELL-C-σ по умолчанию
+
+/*!
+ * \brief SparseKernel Формат на устройстве и kernel умножения
+ */
+enum class SparseKernel { Auto, CsrScalar, CsrVector, Sell, Ell };
+
+/*!
+ * \brief CsrMatrix Разреженная матрица в формате CSR на хосте
+ */
+struct CsrMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<cl_int> rowPtr;     //< rows + 1 смещений начала строк в colIdx и values
+    std::vector<cl_int> colIdx;     //< столбцы ненулевых элементов по возрастанию внутри строки
+    std::vector<cl_float> values;
+
+    size_t nnz() const { return values.size(); }
+};
+
+/*!
+ * \brief SellMatrix Разреженная матрица в формате SELL-C-σ на хосте
+ *
+ * Строки дополнены до кратности slice строкам-заглушками (rowIndex = -1) с пустыми элементами.
+ * Элемент k строки r среза s хранится по индексу sliceStart[s] + k * slice + r % slice.
+ * Дополняющие элементы имеют значение 0 и столбец 0.
+ */
+struct SellMatrix {
+    int rows = 0;
+    int cols = 0;
+    int slice = SELL_SLICE;
+    int sigma = SELL_SIGMA;
+    std::vector<cl_int> sliceStart; //< количество срезов + 1 смещений
+    std::vector<cl_int> rowIndex;   //< исходная строка для каждой строки в порядке хранения (-1 - заглушка)
+    std::vector<cl_int> colIdx;
+    std::vector<cl_float> values;
+};
+
+/*!
+ * \brief RowStatistics Статистика длин строк, по которой выбирается kernel
+ */
+struct RowStatistics {
+    double mean = 0.0;              //< средняя длина строки
+    double deviation = 0.0;         //< стандартное отклонение длины строки
+    int max = 0;                    //< наибольшая длина строки
+    double sellFill = 1.0;          //< отношение хранимых элементов SELL-C-σ (по умолчанию) к ненулевым
+};
+
+/*!
+ * \brief csrFromDense Строит CSR матрицу из плотной матрицы rows x cols в row-major формате
+ * \throws std::invalid_argument Если размер dense не равен rows * cols или ненулевых элементов больше INT_MAX
+ */
+CsrMatrix csrFromDense(const std::vector<float>& dense, int rows, int cols);
+
+/*!
+ * \brief csrToDense Восстанавливает плотную матрицу в row-major формате
+ */
+std::vector<float> csrToDense(const CsrMatrix& matrix);
+
+/*!
+ * \brief sellFromCsr Переупаковывает CSR матрицу в SELL-C-σ
+ *
+ * sellFromCsr(matrix, matrix.rows, 1) дает ELLPACK.
+ * \param [in] slice Высота среза C
+ * \param [in] sigma Окно сортировки σ (1 - без сортировки)
+ */
+SellMatrix sellFromCsr(const CsrMatrix& matrix, int slice = SELL_SLICE, int sigma = SELL_SIGMA);
+
+/*!
+ * \brief rowStatistics Считает статистику длин строк
+ */
+RowStatistics rowStatistics(const CsrMatrix& matrix);
+
+/*!
+ * \brief chooseSparseKernel Выбирает kernel по статистике длин строк и типу устройства
+ *
+ * SELL-C-σ - если дополнение нулями увеличивает объем не более чем в 1.5 раза; иначе vector CSR - на GPU
+ * при средней длине строки от 32 (группе work-item'ов есть что делить), в остальных случаях scalar CSR.
+ * На CPU барьеры редукции vector CSR дороже выигрыша, поэтому он не выбирается.
+ */
+SparseKernel chooseSparseKernel(const RowStatistics& statistics, cl_device_type type = CL_DEVICE_TYPE_GPU);
+
+/*!
+ * \brief cpuSpmm Эталонное умножение на CPU: C (rows x n) = A * B (cols x n), все плотные - row-major
+ *
+ * Строки распределяются между потоками общего пула блоками, внутренний цикл по n векторизуется.
+ */
+void cpuSpmm(const CsrMatrix& a, const float* b, int n, float* c);
+
+/*!
+ * \brief cpuSpmv Эталонное умножение на вектор: y = A * x
+ */
+inline void cpuSpmv(const CsrMatrix& a, const float* x, float* y) {
+    cpuSpmm(a, x, 1, y);
+}
+
+/*!
+ * \brief SparseMatrix Разреженная матрица на устройстве вместе с kernel'ем умножения
+ *
+ * Формат на устройстве определяется kernel'ем: CSR для CsrScalar и CsrVector, SELL-C-σ для Sell,
+ * ELLPACK для Ell. Программы берутся из кэша скомпилированных программ.
+ * Объект не потокобезопасен: аргументы kernel'я общие.
+ */
+class SparseMatrix {
+public:
+    /*!
+     * \param [in] queue Очередь, через которую матрица копируется на устройство (копирование блокирующее)
+     * \param [in] kernel Kernel умножения (Auto - выбор по chooseSparseKernel)
+     * \throws std::invalid_argument Если матрица пустая
+     */
+    SparseMatrix(const cl::Context& context, const cl::Device& device, cl::CommandQueue& queue,
+                 const CsrMatrix& matrix, SparseKernel kernel = SparseKernel::Auto);
+
+    /*!
+     * \brief enqueueSpmv Добавляет в очередь y = A * x
+     *
+     * \param [in] x Вектор из cols элементов
+     * \param [out] y Вектор из rows элементов
+     * \return Событие завершения kernel'я
+     */
+    cl::Event enqueueSpmv(cl::CommandQueue& queue, const cl::Buffer& x, const cl::Buffer& y,
+                          const std::vector<cl::Event>* events = nullptr);
+
+    /*!
+     * \brief enqueueSpmm Добавляет в очередь C = A * B
+     *
+     * \param [in] n Количество столбцов B и C
+     * \param [in] b Матрица cols x n, row-major
+     * \param [out] c Матрица rows x n, row-major
+     * \return Событие завершения kernel'я
+     */
+    cl::Event enqueueSpmm(cl::CommandQueue& queue, int n, const cl::Buffer& b, const cl::Buffer& c,
+                          const std::vector<cl::Event>* events = nullptr);
+
+    SparseKernel kernel() const { return selected; }
+    int rows() const { return rowCount; }
+    int cols() const { return colCount; }
+    size_t nnz() const { return nonZeros; }
+    const RowStatistics& statistics() const { return rowStats; }
+
+    /*!
+     * \brief vectorWidth Количество work-item'ов на строку для CsrVector (иначе 1)
+     */
+    int vectorWidth() const { return width; }
+
+    /*!
+     * \brief deviceBytes Объем буферов матрицы на устройстве
+     */
+    size_t deviceBytes() const { return bytes; }
+
+private:
+    SparseKernel selected;
+    int rowCount;
+    int colCount;
+    size_t nonZeros;
+    RowStatistics rowStats;
+    int width = 1;
+    size_t groupSize;
+    size_t storedRows;              //< строк в порядке хранения (SELL дополняется до кратности срезу)
+    int slice = 0;
+    size_t bytes = 0;
+    cl::Buffer rowPtr;              //< CSR: смещения строк, SELL: смещения срезов
+    cl::Buffer rowIndex;            //< SELL: исходные строки
+    cl::Buffer colIdx;
+    cl::Buffer values;
+    cl::Kernel multiply;
+};
+
+/*!
+ * \brief sparseKernelName Название kernel'я для вывода
+ */
+const char* sparseKernelName(SparseKernel kernel);
+
+/*!
+ * @}
+ */
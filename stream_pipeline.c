@@ -0,0 +1,200 @@
+/*!
+  * \addtogroup stream_pipeline
+  * @{
+  */
+
+#include "stream_pipeline.h"
+#include "launch_geometry.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/*!
+ * \brief nowSeconds Монотонное время в секундах
+ */
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*!
+ * \brief replaceEvent Освобождает старое событие в слоте и записывает новое
+ */
+static void replaceEvent(cl_event* slot, cl_event event) {
+    if (*slot != NULL) {
+        clReleaseEvent(*slot);
+    }
+    *slot = event;
+}
+
+size_t chooseStreamChunk(cl_device_id device, size_t elementSize, int depth) {
+    cl_ulong globalMem = 0, maxAlloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMem, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAlloc, NULL);
+    // Большие порции почти не ускоряют передачу, но увеличивают время заполнения конвейера
+    size_t chunk = (size_t) 1 << 22;
+    const size_t budget = (size_t) (globalMem / 4 / (3 * (cl_ulong) depth) / elementSize);
+    if (budget < chunk) {
+        chunk = budget;
+    }
+    if (maxAlloc / elementSize < chunk) {
+        chunk = (size_t) (maxAlloc / elementSize);
+    }
+    return chunk > 0 ? chunk : 1;
+}
+
+cl_int streamBinaryKernel(cl_context context, cl_device_id device, cl_kernel kernel, size_t elementSize,
+                          const void* a, const void* b, void* c, size_t count,
+                          size_t chunkElements, int depth, StreamStats* stats) {
+    if (depth < 1) {
+        depth = 1;
+    }
+    if (chunkElements == 0) {
+        chunkElements = chooseStreamChunk(device, elementSize, depth);
+    }
+    // Порция не больше данных: иначе буферы выделяются с запасом, а статистика сообщает лишние элементы
+    if (count > 0 && chunkElements > count) {
+        chunkElements = count;
+    }
+    const size_t chunks = (count + chunkElements - 1) / chunkElements;
+    const size_t chunkBytes = chunkElements * elementSize;
+
+    cl_int err = CL_SUCCESS;
+    // Отдельные очереди для загрузки, вычислений и выгрузки, чтобы команды разных порций шли параллельно
+    const cl_queue_properties properties[] = { CL_QUEUE_PROPERTIES, traceQueueProperties(), 0 };
+    cl_command_queue upload = clCreateCommandQueueWithProperties(context, device, properties, &err);
+    cl_command_queue compute = err == CL_SUCCESS
+            ? clCreateCommandQueueWithProperties(context, device, properties, &err) : NULL;
+    cl_command_queue download = err == CL_SUCCESS
+            ? clCreateCommandQueueWithProperties(context, device, properties, &err) : NULL;
+
+    cl_mem bufferA[depth], bufferB[depth], bufferC[depth];
+    cl_event uploaded[depth], computed[depth], downloaded[depth];
+    for (int s = 0; s < depth; ++s) {
+        bufferA[s] = bufferB[s] = bufferC[s] = NULL;
+        uploaded[s] = computed[s] = downloaded[s] = NULL;
+    }
+    for (int s = 0; s < depth && err == CL_SUCCESS; ++s) {
+        bufferA[s] = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &err);
+        if (err == CL_SUCCESS) {
+            bufferB[s] = clCreateBuffer(context, CL_MEM_READ_ONLY, chunkBytes, NULL, &err);
+        }
+        if (err == CL_SUCCESS) {
+            bufferC[s] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, chunkBytes, NULL, &err);
+        }
+    }
+
+    const double start = nowSeconds();
+    for (size_t i = 0; i < chunks && err == CL_SUCCESS; ++i) {
+        const int s = (int) (i % depth);
+        const size_t offset = i * chunkBytes;
+        const size_t elements = i + 1 < chunks ? chunkElements : count - i * chunkElements;
+        const size_t bytes = elements * elementSize;
+
+        // Загрузка в слот возможна, когда kernel предыдущей порции этого слота прочитал входы
+        cl_event event;
+        cl_uint waitCount = computed[s] != NULL ? 1 : 0;
+        err = clEnqueueWriteBuffer(upload, bufferA[s], CL_FALSE, 0, bytes, (const char*) a + offset,
+                                   waitCount, waitCount ? &computed[s] : NULL, &event);
+        if (err != CL_SUCCESS) {
+            break;
+        }
+        traceCommand(event, "write A");
+        clReleaseEvent(event);
+        err = clEnqueueWriteBuffer(upload, bufferB[s], CL_FALSE, 0, bytes, (const char*) b + offset,
+                                   0, NULL, &event);
+        if (err != CL_SUCCESS) {
+            break;
+        }
+        traceCommand(event, "write B");
+        replaceEvent(&uploaded[s], event);
+        clFlush(upload);
+
+        // Kernel ждет загрузки своих входов и выгрузки предыдущего результата из этого слота
+        cl_event wait[2] = { uploaded[s], downloaded[s] };
+        waitCount = downloaded[s] != NULL ? 2 : 1;
+        LaunchGeometry geometry;
+        err = chooseLaunchGeometry(device, kernel, elements, &geometry);
+        if (err != CL_SUCCESS) {
+            break;
+        }
+        const cl_ulong n = elements;
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufferA[s]);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufferB[s]);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufferC[s]);
+        clSetKernelArg(kernel, 3, sizeof(cl_ulong), &n);
+        err = clEnqueueNDRangeKernel(compute, kernel, 1, NULL, &geometry.global, &geometry.local,
+                                     waitCount, wait, &event);
+        if (err != CL_SUCCESS) {
+            break;
+        }
+        traceCommand(event, "add");
+        replaceEvent(&computed[s], event);
+        clFlush(compute);
+
+        err = clEnqueueReadBuffer(download, bufferC[s], CL_FALSE, 0, bytes, (char*) c + offset,
+                                  1, &computed[s], &event);
+        if (err != CL_SUCCESS) {
+            break;
+        }
+        traceCommand(event, "read C");
+        replaceEvent(&downloaded[s], event);
+        clFlush(download);
+    }
+    if (download != NULL) {
+        const cl_int finished = clFinish(download);
+        err = err == CL_SUCCESS ? finished : err;
+    }
+    const double seconds = nowSeconds() - start;
+
+    if (stats != NULL) {
+        stats->chunks = chunks;
+        stats->chunkElements = chunkElements;
+        stats->depth = depth;
+        stats->seconds = seconds;
+        stats->gigabytesPerSecond = seconds > 0.0 ? 3.0 * count * elementSize / seconds / 1e9 : 0.0;
+    }
+
+    // Перед освобождением буферов дожидаемся всех очередей (в том числе после ошибки)
+    if (upload != NULL) {
+        clFinish(upload);
+    }
+    if (compute != NULL) {
+        clFinish(compute);
+    }
+    for (int s = 0; s < depth; ++s) {
+        replaceEvent(&uploaded[s], NULL);
+        replaceEvent(&computed[s], NULL);
+        replaceEvent(&downloaded[s], NULL);
+        if (bufferA[s] != NULL) {
+            clReleaseMemObject(bufferA[s]);
+        }
+        if (bufferB[s] != NULL) {
+            clReleaseMemObject(bufferB[s]);
+        }
+        if (bufferC[s] != NULL) {
+            clReleaseMemObject(bufferC[s]);
+        }
+    }
+    if (download != NULL) {
+        clReleaseCommandQueue(download);
+    }
+    if (compute != NULL) {
+        clReleaseCommandQueue(compute);
+    }
+    if (upload != NULL) {
+        clReleaseCommandQueue(upload);
+    }
+    return err;
+}
+
+void printStreamStats(const StreamStats* stats) {
+    printf("Streamed %zu chunks of %zu elements through %d buffer sets in %f ms: %f GB/s\n",
+           stats->chunks, stats->chunkElements, stats->depth, stats->seconds * 1000.0, stats->gigabytesPerSecond);
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,76 @@
+/*!
+  * \defgroup stream_pipeline Потоковая обработка векторов
+  *
+  * Поэлементная обработка векторов, которые не помещаются в память устройства целиком.
+  * Вход делится на порции, которые проходят через depth наборов буферов на устройстве.
+  * Загрузка, вычисление и выгрузка выполняются в трех разных очередях и связаны событиями,
+  * поэтому загрузка порции i+1, kernel над порцией i и выгрузка порции i-1 выполняются одновременно.
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief StreamStats Результаты потоковой обработки
+ */
+typedef struct StreamStats {
+    size_t chunks;              //< количество порций
+    size_t chunkElements;       //< элементов в порции
+    int depth;                  //< количество наборов буферов в работе одновременно
+    double seconds;             //< полное время от первой загрузки до последней выгрузки
+    double gigabytesPerSecond;  //< (два входа + выход) / время
+} StreamStats;
+
+/*!
+ * \brief chooseStreamChunk Выбирает размер порции так, чтобы depth наборов из трех буферов
+ *                          занимали не больше четверти памяти устройства
+ *
+ * \param [in] device Устройство
+ * \param [in] elementSize Размер элемента в байтах
+ * \param [in] depth Количество наборов буферов
+ * \return Количество элементов в порции (не больше 4M)
+ */
+size_t chooseStreamChunk(cl_device_id device, size_t elementSize, int depth);
+
+/*!
+ * \brief streamBinaryKernel Выполняет kernel(a, b, c) над векторами произвольной длины порциями
+ *
+ * kernel должен принимать три буфера (два входных и выходной) и количество элементов порции (ulong)
+ * и проходить порцию циклом с шагом в размер NDRange; размеры запуска выбирает chooseLaunchGeometry.
+ *
+ * \param [in] context Контекст
+ * \param [in] device Устройство
+ * \param [in] kernel Kernel с тремя аргументами-буферами и длиной
+ * \param [in] elementSize Размер элемента в байтах
+ * \param [in] a Первый вход (count элементов в памяти хоста)
+ * \param [in] b Второй вход
+ * \param [out] c Выход
+ * \param [in] count Количество элементов
+ * \param [in] chunkElements Элементов в порции (0 - выбрать через chooseStreamChunk), не больше count
+ * \param [in] depth Количество наборов буферов (2 - двойная, 3 - тройная буферизация)
+ * \param [out] stats Статистика (может быть NULL)
+ * \return CL_SUCCESS или код первой ошибки openCL
+ */
+cl_int streamBinaryKernel(cl_context context, cl_device_id device, cl_kernel kernel, size_t elementSize,
+                          const void* a, const void* b, void* c, size_t count,
+                          size_t chunkElements, int depth, StreamStats* stats);
+
+/*!
+ * \brief printStreamStats Выводит статистику потоковой обработки
+ */
+void printStreamStats(const StreamStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
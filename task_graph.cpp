@@ -0,0 +1,111 @@
+/*!
+  * \addtogroup task_graph
+  * @{
+  */
+
+#include "task_graph.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+namespace {
+
+void CL_CALLBACK onEventComplete(cl_event, cl_int status, void* userData) {
+    // Обработчик вызывается ровно один раз, состояние принадлежит ему
+    std::unique_ptr<std::function<void(cl_int)>> hook { static_cast<std::function<void(cl_int)>*>(userData) };
+    (*hook)(status);
+}
+
+} // namespace
+
+TaskGraph::TaskGraph(const cl::Context& context, const cl::Device& device, int queueCount) {
+    const cl_command_queue_properties supported = device.getInfo<CL_DEVICE_QUEUE_PROPERTIES>();
+    if ((supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0) {
+        ordered = false;
+        queues.emplace_back(context, device, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | traceQueueProperties());
+    } else {
+        for (int i = 0; i < std::max(1, queueCount); ++i) {
+            queues.emplace_back(context, device, traceQueueProperties());
+        }
+    }
+}
+
+cl::CommandQueue& TaskGraph::nextQueue() {
+    cl::CommandQueue& queue = queues[next];
+    next = (next + 1) % queues.size();
+    return queue;
+}
+
+std::vector<cl::Event> TaskGraph::events(const Dependencies& after) {
+    std::vector<cl::Event> wait;
+    wait.reserve(after.size());
+    for (const Task& task : after) {
+        wait.push_back(task.event());
+    }
+    return wait;
+}
+
+Task TaskGraph::track(const cl::Event& event) {
+    Task task;
+    task.completion = event;
+    auto promise = std::make_shared<std::promise<void>>();
+    task.done = promise->get_future().share();
+    whenComplete(task, [promise](cl_int status) {
+        if (status < 0) {
+            promise->set_exception(std::make_exception_ptr(cl::Error { status, "task execution" }));
+        } else {
+            promise->set_value();
+        }
+    });
+    return task;
+}
+
+void TaskGraph::whenComplete(const Task& task, std::function<void(cl_int)> hook) {
+    auto state = std::make_unique<std::function<void(cl_int)>>(std::move(hook));
+    const cl_int status = clSetEventCallback(task.event()(), CL_COMPLETE, onEventComplete, state.get());
+    if (status != CL_SUCCESS) {
+        throw cl::Error { status, "clSetEventCallback" };
+    }
+    state.release();
+}
+
+Task TaskGraph::write(const cl::Buffer& buffer, const void* host, size_t bytes, const Dependencies& after) {
+    return enqueue([&](cl::CommandQueue& queue, const std::vector<cl::Event>* wait) {
+        cl::Event event;
+        queue.enqueueWriteBuffer(buffer, CL_FALSE, 0, bytes, host, wait, &event);
+        traceCommand(event);
+        return event;
+    }, after);
+}
+
+Task TaskGraph::kernel(const cl::Kernel& kernel, const cl::NDRange& global, const cl::NDRange& local,
+                       const Dependencies& after) {
+    return enqueue([&](cl::CommandQueue& queue, const std::vector<cl::Event>* wait) {
+        cl::Event event;
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, wait, &event);
+        traceCommand(event);
+        return event;
+    }, after);
+}
+
+Task TaskGraph::read(const cl::Buffer& buffer, void* host, size_t bytes, const Dependencies& after) {
+    return enqueue([&](cl::CommandQueue& queue, const std::vector<cl::Event>* wait) {
+        cl::Event event;
+        queue.enqueueReadBuffer(buffer, CL_FALSE, 0, bytes, host, wait, &event);
+        traceCommand(event);
+        return event;
+    }, after);
+}
+
+Task TaskGraph::enqueue(const Enqueue& commands, const Dependencies& after) {
+    const std::vector<cl::Event> wait = events(after);
+    cl::CommandQueue& queue = nextQueue();
+    const cl::Event event = commands(queue, wait.empty() ? nullptr : &wait);
+    // Без flush команда может остаться в очереди хоста, и зависящие от нее задачи других очередей не начнутся
+    queue.flush();
+    return track(event);
+}
+
+/*!
+ * @}
+ */
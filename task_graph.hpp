@@ -0,0 +1,152 @@
+/*!
+  * \defgroup task_graph Асинхронный граф задач
+  *
+  * Запись, запуск kernel'ей и чтение ставятся в очередь без блокировки потока хоста и возвращают задачи.
+  * Зависимости между задачами передаются списками ожидания cl::Event, о завершении сообщает
+  * clSetEventCallback, который выполняет обещание (std::promise) задачи. Хост ждет только тогда,
+  * когда явно запрашивает результат через future.
+  *
+  * Если устройство поддерживает очереди с внеочередным выполнением, все команды идут в одну такую очередь
+  * и порядок задается только зависимостями. Иначе команды распределяются по нескольким обычным очередям,
+  * поэтому независимые задачи тоже могут выполняться одновременно.
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+/*!
+ * \brief Task Задача графа: событие последней команды и future ее завершения
+ */
+class Task {
+public:
+    Task() = default;
+
+    const cl::Event& event() const { return completion; }
+
+    /*!
+     * \brief future Завершается после выполнения команды; при ошибке выполнения содержит cl::Error
+     */
+    const std::shared_future<void>& future() const { return done; }
+
+    /*!
+     * \brief wait Явное ожидание завершения (единственное место, где блокируется хост)
+     */
+    void wait() const { done.get(); }
+
+private:
+    friend class TaskGraph;
+
+    cl::Event completion;
+    std::shared_future<void> done;
+};
+
+/*!
+ * \brief TaskGraph Постановка зависимых команд в очереди устройства без блокировки хоста
+ *
+ * Методы не потокобезопасны: граф строится из одного потока.
+ * Память хоста, переданная по указателю, должна оставаться доступной до завершения задачи.
+ */
+class TaskGraph {
+public:
+    using Dependencies = std::vector<Task>;
+    using Enqueue = std::function<cl::Event(cl::CommandQueue& queue, const std::vector<cl::Event>* events)>;
+
+    /*!
+     * \param [in] queueCount Количество обычных очередей, если внеочередное выполнение не поддерживается
+     */
+    TaskGraph(const cl::Context& context, const cl::Device& device, int queueCount = 2);
+
+    /*!
+     * \brief write Асинхронная запись bytes байт из host в буфер
+     */
+    Task write(const cl::Buffer& buffer, const void* host, size_t bytes, const Dependencies& after = {});
+
+    /*!
+     * \brief write Асинхронная запись вектора; граф хранит данные до завершения записи
+     */
+    template <typename T>
+    Task write(const cl::Buffer& buffer, std::vector<T> data, const Dependencies& after = {}) {
+        auto owned = std::make_shared<std::vector<T>>(std::move(data));
+        Task task = write(buffer, owned->data(), sizeof(T) * owned->size(), after);
+        whenComplete(task, [owned](cl_int) {});
+        return task;
+    }
+
+    /*!
+     * \brief kernel Асинхронный запуск kernel'я с уже установленными аргументами
+     *
+     * Аргументы захватываются в момент постановки в очередь, поэтому kernel можно сразу перенастроить.
+     */
+    Task kernel(const cl::Kernel& kernel, const cl::NDRange& global, const cl::NDRange& local = cl::NullRange,
+                const Dependencies& after = {});
+
+    /*!
+     * \brief enqueue Произвольная последовательность команд (например, Gemm::enqueue)
+     *
+     * commands вызывается сразу, в потоке хоста: все, что он делает синхронно (например, компиляция программы
+     * при первом enqueueFused), блокирует хост. Такие программы нужно подготовить до построения графа.
+     *
+     * \param [in] commands Ставит команды в переданную очередь с ожиданием событий и возвращает событие последней
+     */
+    Task enqueue(const Enqueue& commands, const Dependencies& after = {});
+
+    /*!
+     * \brief read Асинхронное чтение bytes байт буфера в host
+     */
+    Task read(const cl::Buffer& buffer, void* host, size_t bytes, const Dependencies& after = {});
+
+    /*!
+     * \brief read Асинхронное чтение count элементов в новый вектор
+     */
+    template <typename T>
+    std::shared_future<std::vector<T>> read(const cl::Buffer& buffer, size_t count, const Dependencies& after = {}) {
+        auto data = std::make_shared<std::vector<T>>(count);
+        auto promise = std::make_shared<std::promise<std::vector<T>>>();
+        std::shared_future<std::vector<T>> result = promise->get_future().share();
+        Task task = read(buffer, data->data(), sizeof(T) * count, after);
+        whenComplete(task, [data, promise](cl_int status) {
+            if (status < 0) {
+                promise->set_exception(std::make_exception_ptr(cl::Error { status, "clEnqueueReadBuffer" }));
+            } else {
+                promise->set_value(std::move(*data));
+            }
+        });
+        return result;
+    }
+
+    /*!
+     * \brief whenComplete Вызывает hook(status) из потока openCL после завершения задачи
+     *
+     * status - CL_COMPLETE или отрицательный код ошибки. hook не должен вызывать блокирующие функции openCL.
+     */
+    void whenComplete(const Task& task, std::function<void(cl_int)> hook);
+
+    /*!
+     * \brief outOfOrder true, если используется очередь с внеочередным выполнением
+     */
+    bool outOfOrder() const { return !ordered; }
+
+    size_t queueCount() const { return queues.size(); }
+
+private:
+    cl::CommandQueue& nextQueue();
+    Task track(const cl::Event& event);
+    static std::vector<cl::Event> events(const Dependencies& after);
+
+    std::vector<cl::CommandQueue> queues;
+    size_t next = 0;
+    bool ordered = true;
+};
+
+/*!
+ * @}
+ */
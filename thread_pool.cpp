@@ -0,0 +1,117 @@
+/*!
+  * \addtogroup thread_pool
+  * @{
+  */
+
+#include "thread_pool.hpp"
+
+namespace {
+    thread_local bool insidePool = false;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock { mutex };
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::runTasks(const std::function<void(size_t)>& body, size_t count) {
+    size_t completed = 0;
+    for (size_t i = next++; i < count; i = next++) {
+        body(i);
+        ++completed;
+    }
+    std::lock_guard<std::mutex> lock { mutex };
+    finished += completed;
+    if (finished == count) {
+        done.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    insidePool = true;
+    size_t seen = 0;
+    for (;;) {
+        // Задание копируется под блокировкой: после выхода вызывающего потока job и jobCount
+        // перезаписывает следующий parallelFor
+        const std::function<void(size_t)>* body = nullptr;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock { mutex };
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (job == nullptr) {
+                // Поток проснулся, когда задание уже выполнено и вызывающий поток вышел
+                continue;
+            }
+            body = job;
+            count = jobCount;
+            ++busy;
+        }
+        runTasks(*body, count);
+        {
+            std::lock_guard<std::mutex> lock { mutex };
+            --busy;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    // Вложенные вызовы и пул из одного потока выполняем на месте
+    if (insidePool || workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> call { callMutex };
+    {
+        std::lock_guard<std::mutex> lock { mutex };
+        job = &body;
+        jobCount = count;
+        next = 0;
+        finished = 0;
+        ++generation;
+    }
+    wake.notify_all();
+
+    insidePool = true;
+    runTasks(body, count);
+    insidePool = false;
+
+    // Ждем не только выполнения всех индексов, но и выхода воркеров из runTasks,
+    // чтобы следующий вызов не застал их со старым заданием
+    std::unique_lock<std::mutex> lock { mutex };
+    done.wait(lock, [&] { return finished == jobCount && busy == 0; });
+    job = nullptr;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,72 @@
+/*!
+  * \defgroup thread_pool Пул потоков
+  *
+  * Простой пул потоков для распараллеливания CPU - частей примеров (умножение матриц, проверка результатов и т.д.)
+  * @{
+  */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief ThreadPool Пул потоков с операцией parallelFor
+ *
+ * Потоки создаются один раз и переиспользуются между вызовами. Вызывающий поток тоже участвует в работе.
+ * Вложенный вызов parallelFor из задачи пула выполняется последовательно в текущем потоке.
+ */
+class ThreadPool {
+public:
+    /*!
+     * \param [in] threads Общее количество потоков, включая вызывающий
+     */
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /*!
+     * \brief size Количество потоков, выполняющих задачи (включая вызывающий)
+     */
+    size_t size() const { return workers.size() + 1; }
+
+    /*!
+     * \brief parallelFor Выполняет body(i) для всех i из [0, count) и дожидается завершения
+     *
+     * Индексы раздаются динамически, поэтому задачи могут иметь разную длительность.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    /*!
+     * \brief shared Общий пул на все ядра машины
+     */
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+    void runTasks(const std::function<void(size_t)>& body, size_t count);
+
+    std::vector<std::thread> workers;
+    std::mutex callMutex;           //< сериализует вызовы parallelFor из разных потоков
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next { 0 };
+    size_t finished = 0;
+    size_t generation = 0;
+    size_t busy = 0;
+    bool stopping = false;
+};
+
+/*!
+ * @}
+ */
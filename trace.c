@@ -0,0 +1,356 @@
+/*!
+  * \addtogroup trace
+  * @{
+  */
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*!
+ * \brief TraceCommand Записанная команда; отметки времени читаются при записи файла
+ */
+typedef struct TraceCommand {
+    cl_event event;
+    char* name;                     //< NULL - имя по типу команды
+    unsigned long long recorded;    //< время хоста сразу после постановки команды в очередь
+} TraceCommand;
+
+/*!
+ * \brief HostSpan Интервал работы потока хоста
+ */
+typedef struct HostSpan {
+    char* name;
+    int thread;
+    unsigned long long begin;
+    unsigned long long end;
+} HostSpan;
+
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t traceOnce = PTHREAD_ONCE_INIT;
+static atomic_int traceOn;
+static char* tracePath;
+static unsigned long long traceOrigin;
+
+static TraceCommand* commands;
+static size_t commandCount, commandCapacity;
+static HostSpan* spans;
+static size_t spanCount, spanCapacity;
+
+static atomic_int threadCounter;
+static _Thread_local int threadIndex = -1;
+
+unsigned long long traceHostNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ull + (unsigned long long) now.tv_nsec;
+}
+
+/*!
+ * \brief enable Включает трассировку в файл path (вызывается под traceMutex или из pthread_once)
+ */
+static void enable(const char* path) {
+    if (atomic_load(&traceOn)) {
+        return;
+    }
+    tracePath = strdup(path);
+    traceOrigin = traceHostNow();
+    atomic_store(&traceOn, 1);
+}
+
+static void initFromEnvironment(void) {
+    const char* path = getenv("OCL_TRACE");
+    if (path != NULL && *path != '\0') {
+        enable(path);
+    }
+}
+
+int traceEnabled(void) {
+    pthread_once(&traceOnce, initFromEnvironment);
+    return atomic_load(&traceOn);
+}
+
+void traceStart(const char* path) {
+    pthread_once(&traceOnce, initFromEnvironment);
+    pthread_mutex_lock(&traceMutex);
+    enable(path);
+    pthread_mutex_unlock(&traceMutex);
+}
+
+cl_command_queue_properties traceQueueProperties(void) {
+    return traceEnabled() ? CL_QUEUE_PROFILING_ENABLE : 0;
+}
+
+/*!
+ * \brief grow Увеличивает массив *items до размещения еще одного элемента
+ */
+static int grow(void** items, size_t* capacity, size_t count, size_t itemSize) {
+    if (count < *capacity) {
+        return 0;
+    }
+    const size_t newCapacity = *capacity == 0 ? 256 : *capacity * 2;
+    void* resized = realloc(*items, newCapacity * itemSize);
+    if (resized == NULL) {
+        return -1;
+    }
+    *items = resized;
+    *capacity = newCapacity;
+    return 0;
+}
+
+void traceCommand(cl_event event, const char* name) {
+    if (!traceEnabled() || event == NULL) {
+        return;
+    }
+    const unsigned long long recorded = traceHostNow();
+    pthread_mutex_lock(&traceMutex);
+    if (grow((void**) &commands, &commandCapacity, commandCount, sizeof(TraceCommand)) == 0) {
+        clRetainEvent(event);
+        commands[commandCount].event = event;
+        commands[commandCount].name = name != NULL ? strdup(name) : NULL;
+        commands[commandCount].recorded = recorded;
+        ++commandCount;
+    }
+    pthread_mutex_unlock(&traceMutex);
+}
+
+void traceHostSpan(const char* name, unsigned long long begin, unsigned long long end) {
+    if (!traceEnabled()) {
+        return;
+    }
+    if (threadIndex < 0) {
+        threadIndex = atomic_fetch_add(&threadCounter, 1);
+    }
+    pthread_mutex_lock(&traceMutex);
+    if (grow((void**) &spans, &spanCapacity, spanCount, sizeof(HostSpan)) == 0) {
+        spans[spanCount].name = strdup(name);
+        spans[spanCount].thread = threadIndex;
+        spans[spanCount].begin = begin;
+        spans[spanCount].end = end;
+        ++spanCount;
+    }
+    pthread_mutex_unlock(&traceMutex);
+}
+
+/*!
+ * \brief commandTypeName Имя команды по ее типу
+ */
+static const char* commandTypeName(cl_command_type type) {
+    switch (type) {
+    case CL_COMMAND_NDRANGE_KERNEL: return "kernel";
+    case CL_COMMAND_WRITE_BUFFER: return "write";
+    case CL_COMMAND_READ_BUFFER: return "read";
+    case CL_COMMAND_COPY_BUFFER: return "copy";
+    case CL_COMMAND_MAP_BUFFER: return "map";
+    case CL_COMMAND_UNMAP_MEM_OBJECT: return "unmap";
+    case CL_COMMAND_FILL_BUFFER: return "fill";
+    case CL_COMMAND_MARKER: return "marker";
+    default: return "command";
+    }
+}
+
+/*!
+ * \brief commandCategory Категория команды: передача данных или вычисления
+ */
+static const char* commandCategory(cl_command_type type) {
+    return type == CL_COMMAND_NDRANGE_KERNEL || type == CL_COMMAND_TASK ? "compute" : "transfer";
+}
+
+/*!
+ * \brief writeJsonString Записывает строку в кавычках, экранируя специальные символы
+ */
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* p = text; *p != '\0'; ++p) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', file);
+            fputc(*p, file);
+        } else if ((unsigned char) *p < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned) (unsigned char) *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/*!
+ * \brief TraceQueue Очередь, встреченная в трассе, и смещение ее часов относительно часов хоста
+ */
+typedef struct TraceQueue {
+    cl_command_queue queue;
+    long long offset;
+    int known;
+} TraceQueue;
+
+/*!
+ * \brief TraceTiming Отметки профилирования команды (время устройства, нс)
+ */
+typedef struct TraceTiming {
+    cl_ulong queued, submit, start, end;
+    cl_command_type type;
+    size_t queue;
+    int valid;
+} TraceTiming;
+
+static double toMicroseconds(long long ns) {
+    return ns / 1000.0;
+}
+
+/*!
+ * \brief writeTrace Записывает трассу в файл (вызывается под traceMutex)
+ */
+static int writeTrace(void) {
+    FILE* file = fopen(tracePath, "w");
+    if (file == NULL) {
+        fprintf(stderr, "cannot write trace to %s\n", tracePath);
+        return -1;
+    }
+
+    // Отметки всех команд и смещения часов каждой очереди
+    TraceTiming* timings = (TraceTiming*) calloc(commandCount > 0 ? commandCount : 1, sizeof(TraceTiming));
+    TraceQueue* queues = (TraceQueue*) calloc(commandCount > 0 ? commandCount : 1, sizeof(TraceQueue));
+    size_t queueCount = 0;
+    for (size_t i = 0; i < commandCount; ++i) {
+        TraceTiming* timing = &timings[i];
+        cl_command_queue queue = NULL;
+        clWaitForEvents(1, &commands[i].event);
+        clGetEventInfo(commands[i].event, CL_EVENT_COMMAND_TYPE, sizeof(timing->type), &timing->type, NULL);
+        clGetEventInfo(commands[i].event, CL_EVENT_COMMAND_QUEUE, sizeof(queue), &queue, NULL);
+        // Очередь без CL_QUEUE_PROFILING_ENABLE отметок не дает, такие команды пропускаются
+        const cl_profiling_info params[4] = { CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT,
+                                              CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END };
+        cl_ulong* values[4] = { &timing->queued, &timing->submit, &timing->start, &timing->end };
+        timing->valid = 1;
+        for (int p = 0; p < 4 && timing->valid; ++p) {
+            timing->valid = clGetEventProfilingInfo(commands[i].event, params[p], sizeof(cl_ulong),
+                                                    values[p], NULL) == CL_SUCCESS;
+        }
+        if (!timing->valid) {
+            continue;
+        }
+        size_t q = 0;
+        while (q < queueCount && queues[q].queue != queue) {
+            ++q;
+        }
+        if (q == queueCount) {
+            queues[queueCount++].queue = queue;
+        }
+        timing->queue = q;
+        const long long offset = (long long) commands[i].recorded - (long long) timing->queued;
+        if (!queues[q].known || offset < queues[q].offset) {
+            queues[q].offset = offset;
+            queues[q].known = 1;
+        }
+    }
+
+    // Интервал хоста мог начаться до включения трассировки (traceHostNow вызван раньше первой проверки)
+    unsigned long long origin = traceOrigin;
+    for (size_t i = 0; i < spanCount; ++i) {
+        origin = spans[i].begin < origin ? spans[i].begin : origin;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"host\"}},\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"device queues\"}}");
+    for (size_t q = 0; q < queueCount; ++q) {
+        cl_device_id device = NULL;
+        char deviceName[256] = "unknown device";
+        if (clGetCommandQueueInfo(queues[q].queue, CL_QUEUE_DEVICE, sizeof(device), &device, NULL) == CL_SUCCESS) {
+            clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+            deviceName[sizeof(deviceName) - 1] = '\0';
+        }
+        // Дорожка 2q - выполнение команд, 2q + 1 - ожидание от постановки в очередь до начала выполнения
+        char threadName[320];
+        snprintf(threadName, sizeof(threadName), "queue %zu (%s)", q, deviceName);
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", 2 * q);
+        writeJsonString(file, threadName);
+        fprintf(file, "}}");
+        snprintf(threadName, sizeof(threadName), "queue %zu pending", q);
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", 2 * q + 1);
+        writeJsonString(file, threadName);
+        fprintf(file, "}}");
+    }
+
+    size_t skipped = 0;
+    for (size_t i = 0; i < commandCount; ++i) {
+        const TraceTiming* timing = &timings[i];
+        if (!timing->valid) {
+            ++skipped;
+            continue;
+        }
+        const char* name = commands[i].name != NULL ? commands[i].name : commandTypeName(timing->type);
+        const long long shift = queues[timing->queue].offset - (long long) origin;
+        fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,"
+                      "\"args\":{\"type\":\"%s\",\"queued_to_submit_us\":%.3f,\"submit_to_start_us\":%.3f}}",
+                commandCategory(timing->type), 2 * timing->queue,
+                toMicroseconds((long long) timing->start + shift),
+                toMicroseconds((long long) (timing->end - timing->start)),
+                commandTypeName(timing->type),
+                toMicroseconds((long long) (timing->submit - timing->queued)),
+                toMicroseconds((long long) (timing->start - timing->submit)));
+        if (timing->start > timing->queued) {
+            fprintf(file, ",\n{\"name\":");
+            writeJsonString(file, name);
+            fprintf(file, ",\"cat\":\"pending\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                    2 * timing->queue + 1, toMicroseconds((long long) timing->queued + shift),
+                    toMicroseconds((long long) (timing->start - timing->queued)));
+        }
+    }
+    for (size_t i = 0; i < spanCount; ++i) {
+        fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, spans[i].name);
+        fprintf(file, ",\"cat\":\"host\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                spans[i].thread, toMicroseconds((long long) (spans[i].begin - origin)),
+                toMicroseconds((long long) (spans[i].end - spans[i].begin)));
+    }
+    fprintf(file, "\n]}\n");
+    const int failed = fclose(file) != 0;
+
+    fprintf(stderr, "trace: %zu commands (%zu without profiling info), %zu host spans written to %s\n",
+            commandCount - skipped, skipped, spanCount, tracePath);
+    free(timings);
+    free(queues);
+    return failed ? -1 : 0;
+}
+
+int traceWrite(void) {
+    if (!traceEnabled()) {
+        return -1;
+    }
+    pthread_mutex_lock(&traceMutex);
+    const int result = writeTrace();
+    pthread_mutex_unlock(&traceMutex);
+    return result;
+}
+
+int traceFlush(void) {
+    if (!traceEnabled()) {
+        return -1;
+    }
+    pthread_mutex_lock(&traceMutex);
+    const int result = writeTrace();
+    for (size_t i = 0; i < commandCount; ++i) {
+        clReleaseEvent(commands[i].event);
+        free(commands[i].name);
+    }
+    commandCount = 0;
+    for (size_t i = 0; i < spanCount; ++i) {
+        free(spans[i].name);
+    }
+    spanCount = 0;
+    pthread_mutex_unlock(&traceMutex);
+    return result;
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,87 @@
+/*!
+  * \defgroup trace Трассировка команд openCL
+  *
+  * Записывает команды очередей (запись, чтение, отображение буферов и запуск kernel'ей) с отметками времени
+  * профилирования QUEUED, SUBMIT, START и END, а также интервалы работы хоста, и сохраняет их
+  * в формате Chrome trace-event JSON (chrome://tracing, https://ui.perfetto.dev).
+  *
+  * Трассировка включается переменной окружения OCL_TRACE=<файл> или вызовом traceStart.
+  * Файл записывается вызовом traceFlush в конце main (в C++ - объектом TraceFlush), пока среда openCL
+  * еще загружена. Если трассировка выключена, функции записи ничего не делают.
+  *
+  * Время устройства переводится во время хоста для каждой очереди отдельно: смещение между часами оценивается
+  * по разнице между моментом записи команды на хосте и ее отметкой QUEUED (команда записывается после постановки
+  * в очередь, поэтому наименьшая разница - наиболее точная оценка).
+  * Для получения отметок очереди должны создаваться со свойствами traceQueueProperties().
+  * @{
+  */
+
+#pragma once
+
+#include <CL/cl.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief traceEnabled Проверяет, включена ли трассировка (при первом вызове читает OCL_TRACE)
+ */
+int traceEnabled(void);
+
+/*!
+ * \brief traceStart Включает трассировку с записью в файл path
+ */
+void traceStart(const char* path);
+
+/*!
+ * \brief traceQueueProperties Свойства очереди, необходимые для трассировки
+ * \return CL_QUEUE_PROFILING_ENABLE, если трассировка включена, иначе 0
+ */
+cl_command_queue_properties traceQueueProperties(void);
+
+/*!
+ * \brief traceCommand Записывает команду, завершение которой отмечает event
+ *
+ * Событие захватывается (clRetainEvent) до записи файла; отметки времени читаются при записи файла.
+ * \param [in] event Событие команды
+ * \param [in] name Имя команды (копируется); NULL - по типу команды ("write", "read", "map", "kernel", ...)
+ */
+void traceCommand(cl_event event, const char* name);
+
+/*!
+ * \brief traceHostNow Текущее время хоста в наносекундах (монотонные часы)
+ */
+unsigned long long traceHostNow(void);
+
+/*!
+ * \brief traceHostSpan Записывает интервал работы текущего потока хоста
+ * \param [in] begin Начало интервала, полученное из traceHostNow
+ * \param [in] end Конец интервала
+ */
+void traceHostSpan(const char* name, unsigned long long begin, unsigned long long end);
+
+/*!
+ * \brief traceWrite Записывает накопленную трассу в файл
+ *
+ * Дожидается завершения записанных команд. Повторный вызов перезаписывает файл всеми командами с начала работы.
+ * \return 0 при успехе, -1 если трассировка выключена или файл не записан
+ */
+int traceWrite(void);
+
+/*!
+ * \brief traceFlush Записывает трассу в файл и освобождает записанные события (clReleaseEvent)
+ *
+ * Вызывается в конце работы с openCL; следующий вызов записывает только команды, записанные после этого.
+ * \return Как у traceWrite
+ */
+int traceFlush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
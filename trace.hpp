@@ -0,0 +1,60 @@
+/*!
+  * \addtogroup trace
+  * @{
+  */
+
+#pragma once
+
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+
+#include <string>
+
+#include "trace.h"
+
+/*!
+ * \brief traceCommand Обертка над traceCommand для C++ оберток openCL
+ */
+inline void traceCommand(const cl::Event& event, const char* name = nullptr) {
+    traceCommand(event(), name);
+}
+
+/*!
+ * \brief TraceFlush Записывает трассу (traceFlush) при уничтожении; объявляется первым в main
+ */
+class TraceFlush {
+public:
+    TraceFlush() = default;
+    TraceFlush(const TraceFlush&) = delete;
+    TraceFlush& operator=(const TraceFlush&) = delete;
+
+    ~TraceFlush() {
+        traceFlush();
+    }
+};
+
+/*!
+ * \brief TraceScope Записывает интервал работы хоста от создания до уничтожения объекта
+ */
+class TraceScope {
+public:
+    explicit TraceScope(std::string name)
+        : name { std::move(name) }, begin { traceEnabled() ? traceHostNow() : 0 } {
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope() {
+        if (begin != 0) {
+            traceHostSpan(name.c_str(), begin, traceHostNow());
+        }
+    }
+
+private:
+    std::string name;
+    unsigned long long begin;
+};
+
+/*!
+ * @}
+ */
@@ -10,8 +10,17 @@
 
 #include <CL/cl.h>
 #include <assert.h>
+#include <string.h>
 #include <time.h>
 
+#include "device_profile.h"
+#include "host_memory.h"
+#include "launch_geometry.h"
+#include "program_cache.h"
+#include "stream_pipeline.h"
+#include "trace.h"
+#include "validate.h"
+
 /*!
  * \brief printPlatform Печатает информацию о платформе, указанной в plid
  * \param [in] plid Платформа для которой необходимо вывести информацию
@@ -80,11 +89,19 @@ void printDevice(cl_device_id did) {
     const char* strtype = type == CL_DEVICE_TYPE_GPU ? "GPU" : "CPU or other";
 
     // Выводим информацию на экран
-    printf("%s / %dbit, type: %s;\n\t%lld virtual processors X %d physical processors X %d MHz = %lld GFLOPS\n\t"
+    printf("%s / %dbit, type: %s;\n\t%lld virtual processors X %d physical processors X %d MHz\n\t"
            "memory:\n\t\t%lld bytes global (cache is %lld bytes, cacheline is %d bytes)\n\t\t%lld bytes local\n",
-           name, bits, strtype, virtualProcessors, units, clock, virtualProcessors * clock * units / 1000, globalMem, globalCache,
+           name, bits, strtype, virtualProcessors, units, clock, globalMem, globalCache,
            globalCacheLine, localMemSize
     );
+    // Производительность нельзя вычислить по паспортным данным, поэтому выводятся только измеренные значения
+    DeviceProfile profile;
+    if (loadDeviceProfile(deviceProfilePath(), did, &profile) == 0) {
+        printf("\tmeasured: float %.1f GFLOPS, global memory %.2f GB/s, launch latency %.1f us\n",
+               profile.gflopsFloat, profile.globalBandwidth, profile.launchLatency);
+    } else {
+        printf("\tmeasured: not profiled (run with \"profile\")\n");
+    }
 
     free( orig );
 }
@@ -121,6 +138,50 @@ void printConfiguration() {
     }
 }
 
+/*!
+ * \brief profileDevices Измеряет характеристики устройств, выводит roofline и сохраняет профили
+ *
+ * \param [in] platformId Номер платформы (-1 - все платформы)
+ * \param [in] deviceId Номер устройства на платформе (-1 - все устройства)
+ * \return 0 при успехе, 1 если хотя бы одно устройство не удалось измерить или сохранить
+ */
+int profileDevices(int platformId, int deviceId) {
+    cl_uint count;
+    clGetPlatformIDs(0, NULL, &count);
+    cl_platform_id platforms[count];
+    clGetPlatformIDs(count, platforms, NULL);
+
+    int result = 0;
+    for (cl_uint i = 0; i < count; ++i) {
+        if (platformId >= 0 && (cl_uint) platformId != i) {
+            continue;
+        }
+        cl_uint deviceCount;
+        clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 0, NULL, &deviceCount);
+        cl_device_id devices[deviceCount];
+        clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, deviceCount, devices, NULL);
+        for (cl_uint j = 0; j < deviceCount; ++j) {
+            if (deviceId >= 0 && (cl_uint) deviceId != j) {
+                continue;
+            }
+            DeviceProfile profile;
+            const cl_int err = profileDevice(devices[j], &profile);
+            if (err != CL_SUCCESS) {
+                printf("%s: profiling failed with error %d\n", profile.device, err);
+                result = 1;
+                continue;
+            }
+            printRoofline(&profile);
+            if (saveDeviceProfile(deviceProfilePath(), &profile) != 0) {
+                printf("cannot save device profile to %s\n", deviceProfilePath());
+                result = 1;
+            }
+        }
+    }
+    printf("Device profiles: %s\n", deviceProfilePath());
+    return result;
+}
+
 /*!
  * \brief selectPlatformDevice Находит и возвращает платформу и устройство openCL
  *
@@ -166,15 +227,96 @@ double getEventTimingMs(cl_event* event) {
     return (end - start) / 1e6;
 }
 
+/*!
+ * \brief runStreaming Складывает векторы длины count порциями через depth наборов буферов
+ *
+ * Размер векторов ограничен только памятью хоста: на устройстве одновременно находятся лишь depth порций.
+ * \param [in] context Контекст
+ * \param [in] device Устройство
+ * \param [in] kernel Kernel сложения
+ * \param [in] count Длина векторов
+ * \param [in] depth Количество наборов буферов (2 - двойная, 3 - тройная буферизация)
+ * \return Код возврата программы
+ */
+int runStreaming(cl_context context, cl_device_id device, cl_kernel kernel, size_t count, int depth) {
+    float* vector_a = malloc(sizeof(float) * count);
+    float* vector_b = malloc(sizeof(float) * count);
+    float* vector_c = malloc(sizeof(float) * count);
+    if (vector_a == NULL || vector_b == NULL || vector_c == NULL) {
+        printf("Not enough host memory for %zu elements\n", count);
+        free(vector_a);
+        free(vector_b);
+        free(vector_c);
+        return 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        vector_a[i] = (rand() % 100) / 100.0f;
+        vector_b[i] = (rand() % 100) / 100.0f;
+    }
+
+    cl_ulong globalMem;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMem, NULL);
+    printf("Streaming %zu bytes per vector (device global memory is %llu bytes)\n",
+           count * sizeof(float), (unsigned long long) globalMem);
+
+    StreamStats stats;
+    cl_int err = streamBinaryKernel(context, device, kernel, sizeof(float), vector_a, vector_b, vector_c, count,
+                                    0, depth, &stats);
+    if (err != CL_SUCCESS) {
+        // Результат неполный, проверять его нет смысла
+        printf("Streaming failed with error %d\n", err);
+        free(vector_a);
+        free(vector_b);
+        free(vector_c);
+        return 1;
+    }
+    printStreamStats(&stats);
+
+    // Проверка данных: эталон записывается на место входа a, который больше не нужен
+    for (size_t i = 0; i < count; ++i) {
+        vector_a[i] += vector_b[i];
+    }
+    ValidationReport report;
+    const int valid = validateFloats(vector_c, vector_a, count, (Tolerance) { 0 }, &report);
+    if (valid) {
+        printf("Success!\n");
+    } else {
+        printValidationReport("stream", &report);
+    }
+
+    free(vector_a);
+    free(vector_b);
+    free(vector_c);
+    return valid ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     // Проверяем параметры и при отсутствии необходимых параметров
     // выводим список доступных устройств и
     // информацию о запуске
+    if (argc > 1 && strcmp(argv[1], "profile") == 0) {
+        const int result = profileDevices(-1, -1);
+        traceFlush();
+        return result;
+    }
+    if (argc > 3 && strcmp(argv[3], "profile") == 0) {
+        const int result = profileDevices(atoi(argv[1]), atoi(argv[2]));
+        traceFlush();
+        return result;
+    }
+    static const char* usage =
+            "usage: <platformId> <deviceId> [copy | zerocopy | stream [elements] [depth] | profile] | profile\n";
     if (argc < 3) {
         printConfiguration();
-        printf("usage: <platformId> <deviceId>\n");
+        printf("%s", usage);
         return 0;
     }
+    // Неизвестный режим - ошибка, а не молчаливый переход к копированию с результатами под чужим названием
+    if (argc > 3 && strcmp(argv[3], "copy") != 0 && strcmp(argv[3], "zerocopy") != 0 &&
+        strcmp(argv[3], "stream") != 0) {
+        printf("unknown mode: %s\n%s", argv[3], usage);
+        return 1;
+    }
 
     cl_platform_id platform;
     cl_device_id device;
@@ -208,20 +350,22 @@ int main(int argc, char* argv[]) {
     // kernel - обособленная специализированная программа на ЯП openCL C
     // предназначенная для компиляции и выполнения на openCL устройстве
     // Содержит все необходимые данные, такие как контекст, для выполнения на конкретном openCL - устройстве
+    // Каждый work-item складывает элементы gid, gid + размер NDRange, ... (grid-stride), поэтому
+    // количество work-item'ов выбирается под устройство, а не равно длине векторов
     static const char* programCode = ""
             "kernel void add(const global TYPE* vector_a,"
             "                const global TYPE* vector_b,"
-            "                global TYPE* vector_c) {"
-            "   int gid = get_global_id(0);"
-            "   vector_c[gid] = vector_a[gid] + vector_b[gid];"
+            "                global TYPE* vector_c,"
+            "                const ulong n) {"
+            "   for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) {"
+            "       vector_c[i] = vector_a[i] + vector_b[i];"
+            "   }"
             "}";
 
-    size_t len = strlen(programCode);
-    // Создаем программу
-    cl_program program = clCreateProgramWithSource(context, 1, &programCode, &len, &err);
-    assert(err == CL_SUCCESS && "Program creation failed");
-    // Компилируем программу
-    err = clBuildProgram(program, 1, &device, "-D TYPE=float", NULL, NULL);
+    // Создаем и компилируем программу
+    // Если программа уже компилировалась для этого устройства и драйвера, ее образ загружается из кэша
+    cl_program program = buildProgramCached(context, device, programCode, "-D TYPE=float", &err);
+    assert(program != NULL && "Program creation failed");
 
     // В случае ошибки выведем лог OpenCL C компилятора
     if (err != CL_SUCCESS) {
@@ -239,12 +383,35 @@ int main(int argc, char* argv[]) {
     cl_kernel kernel = clCreateKernel(program, "add", &err);
     assert(err == CL_SUCCESS && "Kernel creation failed");
 
+    // Потоковый режим: векторы обрабатываются порциями и могут быть больше памяти устройства
+    if (argc > 3 && strcmp(argv[3], "stream") == 0) {
+        srand((unsigned int) time(NULL));
+        const size_t count = argc > 4 ? strtoull(argv[4], NULL, 10) : (size_t) 1 << 26;
+        const int result = runStreaming(context, device, kernel, count, argc > 5 ? atoi(argv[5]) : 3);
+        printProgramCacheStats();
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+        clReleaseCommandQueue(queue);
+        clReleaseContext(context);
+        traceFlush();
+        return result;
+    }
+
+    // Режим без копирования: буферы используют память хоста напрямую, результат читается через map.
+    // Выбирается автоматически для устройств с общей с хостом памятью
+    int zeroCopy = deviceHasUnifiedMemory(device);
+    if (argc > 3) {
+        zeroCopy = strcmp(argv[3], "zerocopy") == 0;
+    }
+    printf("Mode: %s\n", zeroCopy ? "zero-copy (CL_MEM_USE_HOST_PTR + map)" : "copy (CL_MEM_COPY_HOST_PTR + read)");
+
     // Определяем количество итераций
     const size_t N = 1 << 23;
     // Создаем массивы с входящими и выходящими данными
-    float* vector_a = malloc(sizeof(float) * N);
-    float* vector_b = malloc(sizeof(float) * N);
-    float* vector_c = malloc(sizeof(float) * N);
+    // Для режима без копирования память выравнивается по странице
+    float* vector_a = zeroCopy ? allocHostAligned(sizeof(float) * N) : malloc(sizeof(float) * N);
+    float* vector_b = zeroCopy ? allocHostAligned(sizeof(float) * N) : malloc(sizeof(float) * N);
+    float* vector_c = zeroCopy ? allocHostAligned(sizeof(float) * N) : malloc(sizeof(float) * N);
     time_t t;
     time(&t);
     srand((unsigned int) t);
@@ -256,30 +423,53 @@ int main(int argc, char* argv[]) {
     }
 
     clock_t writeT = clock();       //< Замеряем время начала создания буферов
+    const unsigned long long createBegin = traceHostNow();
     // Создаем буферы данных для openCL устройства и связываем их с ранее созданными массивами данных
-    cl_mem vector_a_device = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof( float ),
+    // (в режиме без копирования буферы работают прямо с этими массивами)
+    const cl_mem_flags hostPtrFlag = zeroCopy ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR;
+    cl_mem vector_a_device = clCreateBuffer(context, CL_MEM_READ_ONLY | hostPtrFlag, N * sizeof( float ),
                                             vector_a, &err);
     assert(err == CL_SUCCESS && "Buffer A creation failed");
-    cl_mem vector_b_device = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof( float ),
+    cl_mem vector_b_device = clCreateBuffer(context, CL_MEM_READ_ONLY | hostPtrFlag, N * sizeof( float ),
                                             vector_b, &err);
     assert(err == CL_SUCCESS && "Buffer B creation failed");
-    cl_mem vector_c_device = clCreateBuffer(context, CL_MEM_WRITE_ONLY, N * sizeof(float), NULL, &err);
+    cl_mem vector_c_device = clCreateBuffer(context, CL_MEM_WRITE_ONLY | (zeroCopy ? CL_MEM_USE_HOST_PTR : 0),
+                                            N * sizeof(float), zeroCopy ? vector_c : NULL, &err);
     assert(err == CL_SUCCESS && "Buffer C creation failed");
     writeT = clock() - writeT;      //< Получаем время, затраченое на создание буферов
+    traceHostSpan("create buffers", createBegin, traceHostNow());
 
     // Соединяем аргументы kernel'я с созданными ранее буферами
     clSetKernelArg(kernel, 0, sizeof(cl_mem), &vector_a_device);
     clSetKernelArg(kernel, 1, sizeof(cl_mem), &vector_b_device);
     clSetKernelArg(kernel, 2, sizeof(cl_mem), &vector_c_device);
+    const cl_ulong count = N;
+    clSetKernelArg(kernel, 3, sizeof(cl_ulong), &count);
+
+    // Выбираем количество work-item'ов и размер work-group по устройству и kernel'ю
+    LaunchGeometry geometry;
+    err = chooseLaunchGeometry(device, kernel, N, &geometry);
+    assert(err == CL_SUCCESS && "Launch geometry query failed");
+    printf("Launch: %zu work-items in groups of %zu, up to %zu elements per work-item\n",
+           geometry.global, geometry.local, geometry.perItem);
 
-    size_t globalWorkItems = N;
     // Добавляем в очередь выполнения созданный ранее kernel.
     // После добавления он начинает выполняться.
     cl_event eventKernel;
-    clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &globalWorkItems, NULL, 0, NULL, &eventKernel);
+    clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &geometry.global, &geometry.local, 0, NULL, &eventKernel);
+    traceCommand(eventKernel, "add");
     // Добавляем в очередь выполнения задание на считывание данных буфера vector_c_device
+    // В режиме без копирования буфер отображается в память хоста вместо чтения
     cl_event eventRead;
-    clEnqueueReadBuffer(queue, vector_c_device, CL_TRUE, 0, sizeof(float)*N, vector_c, 0, NULL, &eventRead);
+    float* result = vector_c;
+    if (zeroCopy) {
+        result = clEnqueueMapBuffer(queue, vector_c_device, CL_TRUE, CL_MAP_READ, 0, sizeof(float)*N,
+                                    0, NULL, &eventRead, &err);
+        assert(err == CL_SUCCESS && "Buffer C mapping failed");
+    } else {
+        clEnqueueReadBuffer(queue, vector_c_device, CL_TRUE, 0, sizeof(float)*N, vector_c, 0, NULL, &eventRead);
+    }
+    traceCommand(eventRead, zeroCopy ? "map C" : "read C");
     // Завершаем очередь выполнения
     clFinish(queue);
 
@@ -291,28 +481,55 @@ int main(int argc, char* argv[]) {
     printf( "Total time to add two vectors of length %lld: %f ms\n", N, writeTime + executeTime + readTime);
     printf( "\twrite:\t\t%f ms\n", writeTime);
     printf( "\texecute:\t%f ms\n", executeTime);
-    printf( "\tread back:\t%f ms\n", readTime);
+    printf( "\t%s\t%f ms\n", zeroCopy ? "map:\t" : "read back:", readTime);
 
-    // Проверка данных
+    // Проверка данных: сравнение с эталоном на всех ядрах (не отключается NDEBUG)
+    const unsigned long long verifyBegin = traceHostNow();
+    float* expected = malloc(sizeof(float) * N);
     for (size_t i = 0; i < N; ++i) {
-        assert( vector_c[i] == (vector_a[i] + vector_b[i]));
+        expected[i] = vector_a[i] + vector_b[i];
+    }
+    ValidationReport report;
+    const int valid = validateFloats(result, expected, N, (Tolerance) { 0 }, &report);
+    free(expected);
+    traceHostSpan("verify", verifyBegin, traceHostNow());
+    if (zeroCopy) {
+        cl_event eventUnmap;
+        clEnqueueUnmapMemObject(queue, vector_c_device, result, 0, NULL, &eventUnmap);
+        traceCommand(eventUnmap, "unmap C");
+        clReleaseEvent(eventUnmap);
+        clFinish(queue);
     }
 
-    printf("Success!\n");
+    if (valid) {
+        printf("Success!\n");
+    } else {
+        printValidationReport("add", &report);
+    }
+    printProgramCacheStats();
 
     // Освобождение памяти
     clReleaseMemObject(vector_a_device);
     clReleaseMemObject(vector_b_device);
     clReleaseMemObject(vector_c_device);
 
-    free(vector_a);
-    free(vector_b);
-    free(vector_c);
+    if (zeroCopy) {
+        freeHostAligned(vector_a);
+        freeHostAligned(vector_b);
+        freeHostAligned(vector_c);
+    } else {
+        free(vector_a);
+        free(vector_b);
+        free(vector_c);
+    }
 
     clReleaseKernel(kernel);
     clReleaseProgram(program);
     clReleaseCommandQueue(queue);
     clReleaseContext(context);
+    // Трасса записывается до выхода из main, пока среда openCL еще загружена
+    traceFlush();
+    return valid ? 0 : 1;
 }
 
 /*!
@@ -12,11 +12,82 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
-#include <cassert>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include "device_vector.hpp"
+#include "launch_geometry.h"
+#include "program_cache.hpp"
+#include "reduction.hpp"
+#include "stream_pipeline.h"
+#include "trace.hpp"
+#include "validate.hpp"
+
+/*!
+ * \brief measureVectorType Измеряет скорость c = a + b для DeviceVector<T, Width> и проверяет результат
+ */
+template <typename T, int Width>
+void measureVectorType(const cl::Context& context, cl::CommandQueue& queue, BufferPool& pool, size_t count,
+                       const char* name) {
+    // Малые целые значения точно представимы во всех типах, включая char и half
+    std::vector<T> hA (count), hB (count);
+    for (size_t i = 0; i < count; ++i) {
+        hA[i] = static_cast<T>(static_cast<float>(i % 50));
+        hB[i] = static_cast<T>(static_cast<float>(i % 7));
+    }
+    DeviceVector<T, Width> a { context, queue, hA, &pool }, b { context, queue, hB, &pool },
+                           c { context, queue, count, &pool };
+
+    const int repetitions = 5;
+    c = a + b;
+    queue.finish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i) {
+        c = a + b;
+    }
+    queue.finish();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double seconds = elapsed.count() / repetitions;
+    std::cout << "\t" << name << " x" << Width << ":\t" << 3.0 * count * sizeof(T) / seconds / 1e9 << " GB/s, "
+              << count / seconds / 1e9 << " Gelements/s" << std::endl;
+
+    auto hC = c.read();
+    std::vector<float> actual (count), expected (count);
+    for (size_t i = 0; i < count; ++i) {
+        actual[i] = static_cast<float>(hC[i]);
+        expected[i] = static_cast<float>(i % 50 + i % 7);
+    }
+    requireValid(name, actual, expected);
+}
+
+/*!
+ * \brief measureType Измеряет скорость сложения векторов типа T для всех ширин обработки
+ */
+template <typename T>
+void measureType(const cl::Context& context, cl::CommandQueue& queue, BufferPool& pool, const cl::Device& device,
+                 size_t count, const char* name) {
+    if (!deviceSupportsType<T>(device)) {
+        std::cout << name << ": not supported (" << OpenclType<T>::extension << ")" << std::endl;
+        return;
+    }
+    std::cout << name;
+    if (OpenclType<T>::extension != nullptr && !deviceHasExtension(device, OpenclType<T>::extension)) {
+        std::cout << " (storage only, computed in float)";
+    }
+    std::cout << ":" << std::endl;
+    measureVectorType<T, 1>(context, queue, pool, count, name);
+    measureVectorType<T, 4>(context, queue, pool, count, name);
+    measureVectorType<T, 8>(context, queue, pool, count, name);
+    measureVectorType<T, 16>(context, queue, pool, count, name);
+}
 
 int main(int argc, char* argv[]) {
+    // Трасса записывается при выходе из main, пока среда openCL еще загружена
+    TraceFlush trace;
     if (argc < 3) {
-        std::cout << "usage: <platformId> <deviceId>";
+        std::cout << "usage: <platformId> <deviceId> [stream [elements] [depth] | fused [elements] | types [elements] | reduce [elements]]";
         return 0;
     }
     std::vector<cl::Platform> platforms;
@@ -27,30 +98,181 @@ int main(int argc, char* argv[]) {
 
     std::vector<cl::Device> devices;
     // Получаем список устройств на платформе
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
     // Получаем устройство
     auto device = devices[atoi(argv[2])];
 
     // Создаем контекст
     cl::Context context { device };
-    // Создаем очередь выполнения
-    cl::CommandQueue queue { context, device };
+    // Создаем очередь выполнения (с профилированием, если включена трассировка OCL_TRACE)
+    cl::CommandQueue queue { context, device, traceQueueProperties() };
+    // Создаем пул буферов: буферы векторов переиспользуются между запусками
+    BufferPool pool { context };
 
-    // Создаем программу для kernel'я
-    cl::Program add { context,
+    // Создаем программу для kernel'я (или загружаем скомпилированную ранее из кэша)
+    cl::Program add = buildProgramCached(context, device,
                 R"CLC(
+                // Grid-stride: work-item складывает элементы id, id + размер NDRange, ...
                 kernel void add( const global int *vector_a,
                                  const global int *vector_b,
-                                 global int *vector_c ) {
-                    const int id = get_global_id(0);
-                    vector_c[ id ] = vector_a[ id ] + vector_b[ id ];
+                                 global int *vector_c,
+                                 const ulong n ) {
+                    for (size_t id = get_global_id(0); id < n; id += get_global_size(0)) {
+                        vector_c[ id ] = vector_a[ id ] + vector_b[ id ];
+                    }
                 }
-                )CLC", true};
+                )CLC");
 
     // Создаем kernel
-    auto addKernel = cl::make_kernel<cl::Buffer&, cl::Buffer&, cl::Buffer&>{ add, "add" };
+    auto addKernel = cl::make_kernel<cl::Buffer&, cl::Buffer&, cl::Buffer&, cl_ulong>{ add, "add" };
 
     typedef int Type;
+
+    // Потоковый режим: векторы обрабатываются порциями и могут быть больше памяти устройства
+    if (argc > 3 && std::string(argv[3]) == "stream") {
+        const size_t count = argc > 4 ? std::stoull(argv[4]) : size_t(1) << 26;
+        const int depth = argc > 5 ? atoi(argv[5]) : 3;
+        std::vector<Type> sA (count);
+        for (size_t i = 0; i < count; ++i) {
+            sA[i] = static_cast<Type>(i & 0x3fffffff);
+        }
+        std::vector<Type> sB (count, 1);
+        std::vector<Type> sC (count);
+
+        cl::Kernel kernel { add, "add" };
+        StreamStats stats;
+        cl_int err = streamBinaryKernel(context(), device(), kernel(), sizeof(Type),
+                                        sA.data(), sB.data(), sC.data(), count, 0, depth, &stats);
+        if (err != CL_SUCCESS) {
+            throw cl::Error { err, "streamBinaryKernel" };
+        }
+        printStreamStats(&stats);
+
+        std::vector<Type> expected (count);
+        for (size_t i = 0; i < count; ++i) {
+            expected[i] = sA[i] + sB[i];
+        }
+        requireValid("stream", sC, expected);
+        printProgramCacheStats();
+        return 0;
+    }
+
+    // Слияние операций: d = a + b * c - e одним kernel'ем против трех отдельных запусков с временными векторами
+    if (argc > 3 && std::string(argv[3]) == "fused") {
+        const size_t count = argc > 4 ? std::stoull(argv[4]) : size_t(1) << 23;
+        std::vector<Type> hA (count), hB (count), hC (count, 3), hE (count, 2);
+        std::iota(hA.begin(), hA.end(), 0);
+        std::iota(hB.begin(), hB.end(), 1);
+        DeviceVector<Type> a { context, queue, hA, &pool }, b { context, queue, hB, &pool },
+                           c { context, queue, hC, &pool }, e { context, queue, hE, &pool };
+
+        auto fused = [&]() {
+            DeviceVector<Type> d = a + b * c - e;
+            return d;
+        };
+        auto separate = [&]() {
+            DeviceVector<Type> t1 = b * c;
+            DeviceVector<Type> t2 = a + t1;
+            DeviceVector<Type> d = t2 - e;
+            return d;
+        };
+        auto measure = [&](auto run, const char* name, int accesses) {
+            // Первый запуск компилирует kernel'и, измеряется второй
+            run();
+            queue.finish();
+            auto start = std::chrono::steady_clock::now();
+            auto d = run();
+            queue.finish();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << name << ": " << elapsed.count() * 1000.0 << " ms, "
+                      << static_cast<double>(accesses) * count * sizeof(Type) / elapsed.count() / 1e9
+                      << " GB/s (" << accesses << " global accesses per element)" << std::endl;
+            return d.read();
+        };
+        auto fusedResult = measure(fused, "fused", 5);
+        auto separateResult = measure(separate, "separate", 9);
+
+        std::vector<Type> expected (count);
+        for (size_t i = 0; i < count; ++i) {
+            expected[i] = hA[i] + hB[i] * hC[i] - hE[i];
+        }
+        requireValid("fused", fusedResult, expected);
+        requireValid("separate", separateResult, fusedResult);
+        const FusionStats stats = fusionStats();
+        std::cout << "Fused kernels: " << stats.compiled << " compiled, " << stats.reused << " reused" << std::endl;
+        printProgramCacheStats();
+        printBufferPoolStats(pool.stats());
+        return 0;
+    }
+
+    // Скорость поэлементного сложения для разных типов элемента и ширины обработки
+    if (argc > 3 && std::string(argv[3]) == "types") {
+        const size_t count = argc > 4 ? std::stoull(argv[4]) : size_t(1) << 24;
+        measureType<cl_char>(context, queue, pool, device, count, "char");
+        measureType<HalfFloat>(context, queue, pool, device, count, "half");
+        measureType<cl_float>(context, queue, pool, device, count, "float");
+        measureType<cl_int>(context, queue, pool, device, count, "int");
+        measureType<cl_double>(context, queue, pool, device, count, "double");
+        printProgramCacheStats();
+        printBufferPoolStats(pool.stats());
+        return 0;
+    }
+
+    // Редукции на устройстве: на хост передается только результат
+    if (argc > 3 && std::string(argv[3]) == "reduce") {
+        const size_t count = argc > 4 ? std::stoull(argv[4]) : size_t(1) << 23;
+        std::vector<Type> hA (count);
+        std::iota(hA.begin(), hA.end(), 0);
+        std::vector<Type> hB (count, 1);
+        DeviceVector<Type, 4> a { context, queue, hA, &pool }, b { context, queue, hB, &pool };
+        DeviceVector<Type, 4> c = a + b;
+
+        using Clock = std::chrono::steady_clock;
+        Reduction<Type> reduction { context, device };
+        const std::pair<ReduceOp, const char*> ops[] = {
+            { ReduceOp::Sum, "sum" }, { ReduceOp::Min, "min" }, { ReduceOp::Max, "max" }, { ReduceOp::Dot, "dot" },
+        };
+        // Первый запуск каждой операции компилирует ее программу
+        for (const auto& [op, name] : ops) {
+            op == ReduceOp::Dot ? reduction.dot(queue, c.buffer(), b.buffer(), count)
+                                : reduction.reduce(queue, op, c.buffer(), count);
+        }
+        // Для сравнения CPU получает вектор так же, как при проверке на хосте: чтением всего буфера
+        auto start = Clock::now();
+        std::vector<Type> hC = c.read();
+        std::chrono::duration<double, std::milli> readTime = Clock::now() - start;
+        std::cout << "read back " << count * sizeof(Type) / 1e6 << " MB: " << readTime.count() << " ms" << std::endl;
+        for (const auto& [op, name] : ops) {
+            start = Clock::now();
+            const auto device = op == ReduceOp::Dot ? reduction.dot(queue, c.buffer(), b.buffer(), count)
+                                                    : reduction.reduce(queue, op, c.buffer(), count);
+            std::chrono::duration<double, std::milli> deviceTime = Clock::now() - start;
+            start = Clock::now();
+            const auto host = cpuReduce(op, hC.data(), count, hB.data());
+            std::chrono::duration<double, std::milli> cpuTime = Clock::now() - start;
+            std::cout << name << " = " << device << ": device " << deviceTime.count() << " ms, CPU "
+                      << cpuTime.count() << " ms" << std::endl;
+            if (device != host) {
+                throw std::runtime_error { std::string { "validation failed: " } + name };
+            }
+        }
+
+        // Норма вектора с плавающей точкой: порядок суммирования разный, сравниваем с допуском
+        std::vector<cl_float> hF (count);
+        for (size_t i = 0; i < count; ++i) {
+            hF[i] = static_cast<cl_float>(i % 1000) * 0.001f;
+        }
+        DeviceVector<cl_float> f { context, queue, hF, &pool };
+        Reduction<cl_float> floatReduction { context, device };
+        const float norm = std::sqrt(floatReduction.dot(queue, f.buffer(), f.buffer(), count));
+        const float cpuNorm = std::sqrt(cpuReduce(ReduceOp::Dot, hF.data(), count, hF.data()));
+        std::cout << "norm = " << norm << " (CPU " << cpuNorm << ")" << std::endl;
+        requireValid("norm", &norm, &cpuNorm, 1, Tolerance { 0.0, 1e-4, 0 });
+        printProgramCacheStats();
+        printBufferPoolStats(pool.stats());
+        return 0;
+    }
+
     // Определяем количество итераций
     const int N = 1 << 23;
 
@@ -60,24 +282,55 @@ int main(int argc, char* argv[]) {
     std::vector<Type> vB (N, 1);
     std::vector<Type> vC (N);
 
-    // Создаем и ассоциируем openCL буферы с созданными массивами данных
-    cl::Buffer vADevice { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(Type) * vA.size(), vA.data() };
-    cl::Buffer vBDevice { context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(Type) * vB.size(), vB.data() };
-    cl::Buffer vCDevice { context, CL_MEM_WRITE_ONLY, sizeof(Type) * vC.size(), nullptr };
+    // Берем openCL буферы из пула и копируем в них созданные массивы данных
+    cl::Buffer vADevice = pool.acquire(sizeof(Type) * vA.size(), CL_MEM_READ_ONLY);
+    cl::Buffer vBDevice = pool.acquire(sizeof(Type) * vB.size(), CL_MEM_READ_ONLY);
+    cl::Buffer vCDevice = pool.acquire(sizeof(Type) * vC.size(), CL_MEM_WRITE_ONLY);
+    cl::Event writtenA, writtenB;
+    queue.enqueueWriteBuffer(vADevice, CL_FALSE, 0, sizeof(Type) * vA.size(), vA.data(), nullptr, &writtenA);
+    traceCommand(writtenA, "write A");
+    queue.enqueueWriteBuffer(vBDevice, CL_FALSE, 0, sizeof(Type) * vB.size(), vB.data(), nullptr, &writtenB);
+    traceCommand(writtenB, "write B");
+
+    // Выбираем количество work-item'ов и размер work-group по устройству и kernel'ю
+    // (свойства kernel'я одинаковы для всех объектов kernel'я "add" этой программы)
+    LaunchGeometry geometry;
+    cl_int err = chooseLaunchGeometry(device(), cl::Kernel { add, "add" }(), N, &geometry);
+    if (err != CL_SUCCESS) {
+        throw cl::Error { err, "chooseLaunchGeometry" };
+    }
+    std::cout << "Launch: " << geometry.global << " work-items in groups of " << geometry.local << ", up to "
+              << geometry.perItem << " elements per work-item" << std::endl;
 
     // Добавляем kernel в очередь выполнения
-    addKernel(
-            cl::EnqueueArgs( queue, cl::NDRange(N) ),
-            vADevice, vBDevice, vCDevice
+    cl::Event added = addKernel(
+            cl::EnqueueArgs( queue, cl::NDRange(geometry.global), cl::NDRange(geometry.local) ),
+            vADevice, vBDevice, vCDevice, N
     );
+    traceCommand(added, "add");
 
     // Добавляем в очередь выполнения задание на считывание данных буфера vC
-    queue.enqueueReadBuffer(vCDevice, CL_TRUE, 0, vC.size() * sizeof(Type), vC.data());
+    cl::Event read;
+    queue.enqueueReadBuffer(vCDevice, CL_TRUE, 0, vC.size() * sizeof(Type), vC.data(), nullptr, &read);
+    traceCommand(read, "read C");
+
+    // Возвращаем буферы в пул: повторно они будут выданы после завершения использующих их команд
+    pool.release(vADevice, { added });
+    pool.release(vBDevice, { added });
+    pool.release(vCDevice, { read });
 
     // Проверка правильности выполнения
-    for( int i = 0; i < N; ++i ) {
-        assert( vC[i] == vA[i] + vB[i] );
+    {
+        TraceScope scope { "verify" };
+        std::vector<Type> expected (N);
+        for( int i = 0; i < N; ++i ) {
+            expected[i] = vA[i] + vB[i];
+        }
+        requireValid("add", vC, expected);
     }
+
+    printProgramCacheStats();
+    printBufferPoolStats(pool.stats());
 }
 
 /*!
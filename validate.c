@@ -0,0 +1,239 @@
+/*!
+  * \addtogroup validate
+  * @{
+  */
+
+#include "validate.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VALIDATE_BLOCK 1024                     //< элементов в блоке первого прохода
+#define VALIDATE_MIN_PART ((size_t) 1 << 18)    //< меньшие части не окупают создание потока
+
+typedef enum ElementType { ELEMENT_FLOAT, ELEMENT_DOUBLE, ELEMENT_INT } ElementType;
+
+/*!
+ * \brief ValidationPart Часть массива, проверяемая одним потоком
+ */
+typedef struct ValidationPart {
+    ElementType type;
+    const void* actual;
+    const void* expected;
+    size_t begin;
+    size_t end;
+    Tolerance tolerance;
+    ValidationReport report;
+} ValidationPart;
+
+/*!
+ * \brief orderedFloat Отображает float в беззнаковое целое с тем же порядком, что у чисел
+ *
+ * Разность отображений соседних представимых чисел равна 1, поэтому разность дает расстояние в ULP.
+ */
+static inline uint32_t orderedFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+
+static inline uint64_t orderedDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x8000000000000000ull) != 0 ? ~bits : bits | 0x8000000000000000ull;
+}
+
+static inline uint64_t floatUlps(float a, float b) {
+    const uint32_t x = orderedFloat(a), y = orderedFloat(b);
+    return x > y ? x - y : y - x;
+}
+
+static inline uint64_t doubleUlps(double a, double b) {
+    const uint64_t x = orderedDouble(a), y = orderedDouble(b);
+    return x > y ? x - y : y - x;
+}
+
+static inline uint64_t intUlps(int a, int b) {
+    (void) a;
+    (void) b;
+    return 0;
+}
+
+/*!
+ * \brief matches Проверяет элемент: NaN совпадает только с NaN, иначе достаточно одного из условий допуска
+ *
+ * Вычисляется без ветвлений, чтобы первый проход по блоку не прерывался переходами.
+ */
+static inline int matches(double actual, double expected, uint64_t ulps, const Tolerance* tolerance, int integer) {
+    const int nanActual = actual != actual, nanExpected = expected != expected;
+    const double error = fabs(actual - expected);
+    const int within = (error <= tolerance->absolute) | (error <= tolerance->relative * fabs(expected))
+            | (!integer & (ulps <= tolerance->ulps));
+    return (nanActual & nanExpected) | (!(nanActual | nanExpected) & within);
+}
+
+/*!
+ * \brief CHECK_PART Определяет функцию проверки части массива элементов типа T
+ *
+ * Первый проход по блоку без ветвлений считает несовпадения и наибольшие ошибки; индексы ищутся вторым
+ * проходом только в блоках, где нужно сохранить несовпадения или обновилась наибольшая ошибка.
+ */
+#define CHECK_PART(name, T, ulpsOf, integer)                                                                    \
+static void name(ValidationPart* part) {                                                                        \
+    const T* actual = (const T*) part->actual;                                                                  \
+    const T* expected = (const T*) part->expected;                                                              \
+    const Tolerance* tolerance = &part->tolerance;                                                              \
+    ValidationReport* report = &part->report;                                                                   \
+    for (size_t block = part->begin; block < part->end; block += VALIDATE_BLOCK) {                              \
+        const size_t end = block + VALIDATE_BLOCK < part->end ? block + VALIDATE_BLOCK : part->end;             \
+        size_t bad = 0;                                                                                         \
+        double maxAbsolute = 0.0, maxRelative = 0.0;                                                            \
+        uint64_t maxUlps = 0;                                                                                   \
+        for (size_t i = block; i < end; ++i) {                                                                  \
+            const double a = (double) actual[i], e = (double) expected[i];                                      \
+            const uint64_t ulps = ulpsOf(actual[i], expected[i]);                                               \
+            const double error = fabs(a - e);                                                                   \
+            bad += !matches(a, e, ulps, tolerance, integer);                                                    \
+            /* сравнения с NaN ложны, поэтому NaN не попадает в максимумы */                                    \
+            maxAbsolute = error > maxAbsolute ? error : maxAbsolute;                                            \
+            maxRelative = (error > maxRelative * fabs(e)) & (e != 0.0) ? error / fabs(e) : maxRelative;       \
+            maxUlps = (error == error) & (ulps > maxUlps) ? ulps : maxUlps;                                     \
+        }                                                                                                       \
+        report->mismatches += bad;                                                                              \
+        report->maxRelative = maxRelative > report->maxRelative ? maxRelative : report->maxRelative;            \
+        report->maxUlps = maxUlps > report->maxUlps ? maxUlps : report->maxUlps;                               \
+        const int newMax = maxAbsolute > report->maxAbsolute;                                                   \
+        if (newMax) {                                                                                           \
+            report->maxAbsolute = maxAbsolute;                                                                  \
+        }                                                                                                       \
+        if (!newMax && (bad == 0 || report->reported == VALIDATE_REPORTED)) {                                   \
+            continue;                                                                                           \
+        }                                                                                                       \
+        for (size_t i = block; i < end; ++i) {                                                                  \
+            const double a = (double) actual[i], e = (double) expected[i];                                      \
+            if (newMax && fabs(a - e) == report->maxAbsolute) {                                                 \
+                report->maxIndex = i;                                                                           \
+            }                                                                                                   \
+            if (report->reported < VALIDATE_REPORTED                                                            \
+                    && !matches(a, e, ulpsOf(actual[i], expected[i]), tolerance, integer)) {                    \
+                report->firstBad[report->reported++] = i;                                                       \
+            }                                                                                                   \
+        }                                                                                                       \
+    }                                                                                                           \
+}
+
+CHECK_PART(checkFloats, float, floatUlps, 0)
+CHECK_PART(checkDoubles, double, doubleUlps, 0)
+CHECK_PART(checkInts, int, intUlps, 1)
+
+static void* checkPart(void* data) {
+    ValidationPart* part = (ValidationPart*) data;
+    switch (part->type) {
+    case ELEMENT_FLOAT:
+        checkFloats(part);
+        break;
+    case ELEMENT_DOUBLE:
+        checkDoubles(part);
+        break;
+    case ELEMENT_INT:
+        checkInts(part);
+        break;
+    }
+    return NULL;
+}
+
+/*!
+ * \brief validate Делит массив на части по потокам, проверяет их параллельно и объединяет отчеты
+ */
+static int validate(ElementType type, const void* actual, const void* expected, size_t count,
+                    Tolerance tolerance, ValidationReport* report) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t parts = (count + VALIDATE_MIN_PART - 1) / VALIDATE_MIN_PART;
+    if (parts > (size_t) (cores > 0 ? cores : 1)) {
+        parts = (size_t) (cores > 0 ? cores : 1);
+    }
+    if (parts == 0) {
+        parts = 1;
+    }
+
+    ValidationPart part[parts];
+    pthread_t threads[parts];
+    int started[parts];
+    // Границы частей кратны блоку, чтобы блоки не пересекали границы
+    const size_t blocks = (count + VALIDATE_BLOCK - 1) / VALIDATE_BLOCK;
+    for (size_t p = 0; p < parts; ++p) {
+        memset(&part[p], 0, sizeof(part[p]));
+        part[p].type = type;
+        part[p].actual = actual;
+        part[p].expected = expected;
+        part[p].tolerance = tolerance;
+        part[p].begin = blocks * p / parts * VALIDATE_BLOCK;
+        part[p].end = p + 1 < parts ? blocks * (p + 1) / parts * VALIDATE_BLOCK : count;
+        part[p].begin = part[p].begin < count ? part[p].begin : count;
+        part[p].end = part[p].end < count ? part[p].end : count;
+        // Первая часть проверяется в вызывающем потоке; если поток не создался, часть проверяется позже здесь же
+        started[p] = p > 0 && pthread_create(&threads[p], NULL, checkPart, &part[p]) == 0;
+    }
+    checkPart(&part[0]);
+    for (size_t p = 1; p < parts; ++p) {
+        if (started[p]) {
+            pthread_join(threads[p], NULL);
+        } else {
+            checkPart(&part[p]);
+        }
+    }
+
+    // Части упорядочены по индексам, поэтому первые несовпадения собираются по порядку частей
+    memset(report, 0, sizeof(*report));
+    report->count = count;
+    for (size_t p = 0; p < parts; ++p) {
+        const ValidationReport* r = &part[p].report;
+        report->mismatches += r->mismatches;
+        if (r->maxAbsolute > report->maxAbsolute) {
+            report->maxAbsolute = r->maxAbsolute;
+            report->maxIndex = r->maxIndex;
+        }
+        report->maxRelative = r->maxRelative > report->maxRelative ? r->maxRelative : report->maxRelative;
+        report->maxUlps = r->maxUlps > report->maxUlps ? r->maxUlps : report->maxUlps;
+        for (size_t i = 0; i < r->reported && report->reported < VALIDATE_REPORTED; ++i) {
+            report->firstBad[report->reported++] = r->firstBad[i];
+        }
+    }
+    return report->mismatches == 0;
+}
+
+int validateFloats(const float* actual, const float* expected, size_t count, Tolerance tolerance,
+                   ValidationReport* report) {
+    return validate(ELEMENT_FLOAT, actual, expected, count, tolerance, report);
+}
+
+int validateDoubles(const double* actual, const double* expected, size_t count, Tolerance tolerance,
+                    ValidationReport* report) {
+    return validate(ELEMENT_DOUBLE, actual, expected, count, tolerance, report);
+}
+
+int validateInts(const int* actual, const int* expected, size_t count, Tolerance tolerance,
+                 ValidationReport* report) {
+    return validate(ELEMENT_INT, actual, expected, count, tolerance, report);
+}
+
+void printValidationReport(const char* name, const ValidationReport* report) {
+    printf("%s: %zu of %zu elements out of tolerance, max error %g (at %zu), max relative %g, max %llu ulp",
+           name, report->mismatches, report->count, report->maxAbsolute, report->maxIndex, report->maxRelative,
+           report->maxUlps);
+    if (report->reported > 0) {
+        printf(", first bad:");
+        for (size_t i = 0; i < report->reported; ++i) {
+            printf(" %zu", report->firstBad[i]);
+        }
+    }
+    printf("\n");
+}
+
+/*!
+ * @}
+ */
@@ -0,0 +1,83 @@
+/*!
+  * \defgroup validate Проверка результатов
+  *
+  * Сравнение результата устройства с эталоном на всех ядрах процессора. Массив делится на части по потокам,
+  * каждая часть проверяется блоками: сначала проход без ветвлений считает ошибки и количество
+  * несовпадений блока, и только для блоков с несовпадениями второй проход записывает их индексы.
+  *
+  * Элемент считается совпавшим, если выполняется хотя бы одно из условий допуска:
+  *  - расстояние в ULP (количество представимых чисел между значениями) не больше ulps;
+  *  - абсолютная ошибка не больше absolute;
+  *  - относительная ошибка (относительно эталона) не больше relative.
+  * Нулевой допуск означает точное совпадение (+0 и -0 совпадают). NaN совпадает только с NaN.
+  *
+  * В отличие от assert проверка не отключается NDEBUG.
+  * @{
+  */
+
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VALIDATE_REPORTED 8         //< количество первых несовпадений, индексы которых сохраняются
+
+/*!
+ * \brief Tolerance Допуск сравнения (нулевой - точное совпадение)
+ */
+typedef struct Tolerance {
+    double absolute;                //< допустимая абсолютная ошибка
+    double relative;                //< допустимая ошибка относительно эталона
+    unsigned long long ulps;        //< допустимое расстояние в ULP
+} Tolerance;
+
+/*!
+ * \brief ValidationReport Результат сравнения
+ */
+typedef struct ValidationReport {
+    size_t count;                   //< проверено элементов
+    size_t mismatches;              //< элементов вне допуска
+    double maxAbsolute;             //< наибольшая абсолютная ошибка
+    double maxRelative;             //< наибольшая относительная ошибка (по элементам с ненулевым эталоном)
+    unsigned long long maxUlps;     //< наибольшее расстояние в ULP (для целых - 0)
+    size_t maxIndex;                //< индекс наибольшей абсолютной ошибки
+    size_t reported;                //< количество сохраненных индексов несовпадений
+    size_t firstBad[VALIDATE_REPORTED]; //< первые индексы несовпадений по возрастанию
+} ValidationReport;
+
+/*!
+ * \brief validateFloats Сравнивает actual с эталоном expected
+ * \return 1, если все элементы в допуске, иначе 0
+ */
+int validateFloats(const float* actual, const float* expected, size_t count, Tolerance tolerance,
+                   ValidationReport* report);
+
+/*!
+ * \brief validateDoubles Сравнивает actual с эталоном expected
+ * \return 1, если все элементы в допуске, иначе 0
+ */
+int validateDoubles(const double* actual, const double* expected, size_t count, Tolerance tolerance,
+                    ValidationReport* report);
+
+/*!
+ * \brief validateInts Сравнивает actual с эталоном expected (ulps не используется)
+ * \return 1, если все элементы в допуске, иначе 0
+ */
+int validateInts(const int* actual, const int* expected, size_t count, Tolerance tolerance,
+                 ValidationReport* report);
+
+/*!
+ * \brief printValidationReport Выводит результат сравнения с именем проверки name
+ */
+void printValidationReport(const char* name, const ValidationReport* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * @}
+ */
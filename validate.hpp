@@ -0,0 +1,63 @@
+/*!
+  * \addtogroup validate
+  * @{
+  */
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "validate.h"
+
+/*!
+ * \brief validate Обертки над validateFloats, validateDoubles и validateInts
+ */
+inline ValidationReport validate(const float* actual, const float* expected, size_t count,
+                                 const Tolerance& tolerance = {}) {
+    ValidationReport report;
+    validateFloats(actual, expected, count, tolerance, &report);
+    return report;
+}
+
+inline ValidationReport validate(const double* actual, const double* expected, size_t count,
+                                 const Tolerance& tolerance = {}) {
+    ValidationReport report;
+    validateDoubles(actual, expected, count, tolerance, &report);
+    return report;
+}
+
+inline ValidationReport validate(const int* actual, const int* expected, size_t count,
+                                 const Tolerance& tolerance = {}) {
+    ValidationReport report;
+    validateInts(actual, expected, count, tolerance, &report);
+    return report;
+}
+
+/*!
+ * \brief requireValid Сравнивает actual с эталоном expected и при несовпадении выводит отчет
+ * \throws std::runtime_error Если есть элементы вне допуска
+ */
+template <typename T>
+void requireValid(const char* name, const T* actual, const T* expected, size_t count,
+                  const Tolerance& tolerance = {}) {
+    const ValidationReport report = validate(actual, expected, count, tolerance);
+    if (report.mismatches > 0) {
+        printValidationReport(name, &report);
+        throw std::runtime_error { std::string { "validation failed: " } + name };
+    }
+}
+
+template <typename T>
+void requireValid(const char* name, const std::vector<T>& actual, const std::vector<T>& expected,
+                  const Tolerance& tolerance = {}) {
+    if (actual.size() != expected.size()) {
+        throw std::runtime_error { std::string { "validation failed: " } + name + ": size mismatch" };
+    }
+    requireValid(name, actual.data(), expected.data(), actual.size(), tolerance);
+}
+
+/*!
+ * @}
+ */